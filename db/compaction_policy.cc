@@ -0,0 +1,190 @@
+#include "compaction_policy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "options.h"
+
+namespace mdb {
+
+namespace {
+
+size_t TotalSize(const std::vector<TableSummary>& tables) {
+  size_t total{0};
+  for (const auto& table : tables) {
+    total += table.size;
+  }
+  return total;
+}
+
+// True if no level after "level" holds any tables.
+bool IsLastNonEmptyLevel(const LevelSummary& levels, size_t level) {
+  return std::all_of(levels.upper_bound(level), levels.end(),
+                     [](const auto& level_and_tables) {
+                       return level_and_tables.second.empty();
+                     });
+}
+
+// Merge runs [start, end) of level 0 back into level 0.
+CompactionTask MakeLevelZeroTask(const LevelSummary& levels, size_t start,
+                                 size_t end) {
+  const auto& runs{levels.at(0)};
+  assert(start < end && end <= runs.size());
+
+  CompactionTask task{.level = 0,
+                      .tables = {},
+                      .output_level = 0,
+                      .drop_deletes = end == runs.size() &&
+                                      IsLastNonEmptyLevel(levels, 0)};
+
+  for (size_t i = start; i < end; i++) {
+    task.tables.push_back(runs[i].number);
+  }
+
+  return task;
+}
+
+}  // namespace
+
+std::optional<CompactionTask> LeveledCompactionPolicy::PickCompaction(
+    const LevelSummary& levels, const Options& options) const {
+  for (const auto& [level, tables] : levels) {
+    if (tables.empty()) {
+      continue;
+    }
+
+    bool needs_compaction{
+        level == 0
+            ? tables.size() >= options.trigger_compaction_at
+            : TotalSize(tables) > std::pow(10, level + 1) * 1000 * 1000};
+
+    if (needs_compaction) {
+      CompactionTask task{.level = level,
+                          .tables = {},
+                          .output_level = level + 1,
+                          .drop_deletes = IsLastNonEmptyLevel(levels, level)};
+
+      for (const auto& table : tables) {
+        task.tables.push_back(table.number);
+      }
+
+      return task;
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<CompactionTask> UniversalCompactionPolicy::PickCompaction(
+    const LevelSummary& levels, const Options& options) const {
+  auto it{levels.find(0)};
+  if (it == levels.end() || it->second.size() < 2 ||
+      it->second.size() < options.trigger_compaction_at) {
+    return std::nullopt;
+  }
+
+  if (auto task{PickSizeAmplification(levels)}) {
+    return task;
+  }
+
+  if (auto task{PickSizeRatio(levels)}) {
+    return task;
+  }
+
+  // No runs are similar enough in size, but there are too many of them. Merge
+  // the newest ones regardless of size to get back under the limit.
+  size_t num_runs{it->second.size()};
+  size_t width{
+      std::max<size_t>(2, num_runs - options.trigger_compaction_at + 1)};
+
+  return MakeLevelZeroTask(levels, 0, std::min(width, num_runs));
+}
+
+std::optional<CompactionTask> UniversalCompactionPolicy::PickSizeAmplification(
+    const LevelSummary& levels) const {
+  const auto& runs{levels.at(0)};
+
+  size_t oldest{runs.back().size};
+  size_t newer{TotalSize(runs) - oldest};
+
+  if (newer * 100 >= oldest * options_.max_size_amplification_percent) {
+    return MakeLevelZeroTask(levels, 0, runs.size());
+  }
+
+  return std::nullopt;
+}
+
+std::optional<CompactionTask> UniversalCompactionPolicy::PickSizeRatio(
+    const LevelSummary& levels) const {
+  const auto& runs{levels.at(0)};
+
+  for (size_t start = 0; start + 1 < runs.size(); start++) {
+    // Grow the window with older runs as long as each one is not much bigger
+    // than everything already in the window.
+    double candidate_size(runs[start].size);
+    size_t end{start + 1};
+
+    while (end < runs.size() && end - start < options_.max_merge_width) {
+      if (candidate_size * (100.0 + options_.size_ratio) / 100.0 <
+          runs[end].size) {
+        break;
+      }
+      candidate_size += runs[end].size;
+      ++end;
+    }
+
+    if (end - start >= options_.min_merge_width) {
+      return MakeLevelZeroTask(levels, start, end);
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<CompactionTask> FIFOCompactionPolicy::PickCompaction(
+    const LevelSummary& levels, const Options&) const {
+  auto it{levels.find(0)};
+  if (it == levels.end() || it->second.empty()) {
+    return std::nullopt;
+  }
+
+  const auto& tables{it->second};
+  auto now{std::chrono::system_clock::now()};
+
+  // Drop tables from the oldest end until what's left is small enough and
+  // young enough.
+  size_t total_size{TotalSize(tables)};
+  size_t keep{tables.size()};
+
+  while (keep > 0) {
+    const auto& oldest{tables[keep - 1]};
+    bool expired{options_.ttl.count() > 0 &&
+                 now - oldest.creation_time > options_.ttl};
+
+    if (total_size <= options_.max_table_files_size && !expired) {
+      break;
+    }
+
+    total_size -= oldest.size;
+    --keep;
+  }
+
+  if (keep == tables.size()) {
+    return std::nullopt;
+  }
+
+  CompactionTask task{.level = 0,
+                      .tables = {},
+                      .output_level = 0,
+                      .drop_deletes = false,
+                      .drop_tables = true};
+
+  for (size_t i = keep; i < tables.size(); i++) {
+    task.tables.push_back(tables[i].number);
+  }
+
+  return task;
+}
+
+}  // namespace mdb
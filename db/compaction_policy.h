@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <limits>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace mdb {
+
+struct Options;
+
+// What the compaction policy gets to see about a single table on disk.
+struct TableSummary {
+  size_t number;
+  size_t size;
+  std::chrono::system_clock::time_point creation_time;
+};
+
+// Level number -> tables in that level, newest first.
+using LevelSummary = std::map<size_t, std::vector<TableSummary>>;
+
+// A unit of work picked by a CompactionPolicy. The input tables are merged
+// into a single sorted run which is written to output_level, unless
+// drop_tables is set.
+struct CompactionTask {
+  size_t level;
+
+  // Table numbers of the inputs, newest first. They must form a contiguous
+  // range of the tables in level.
+  std::vector<size_t> tables;
+
+  // If output_level == level, the output takes the place of the inputs.
+  // Otherwise, it becomes the newest run in output_level.
+  size_t output_level;
+
+  // Deleted keys can only be discarded if nothing older than the inputs
+  // could still hold a value for them.
+  bool drop_deletes;
+
+  // If true, the input tables are deleted outright and nothing is written.
+  bool drop_tables{false};
+};
+
+class CompactionPolicy {
+ public:
+  CompactionPolicy() = default;
+
+  CompactionPolicy(const CompactionPolicy&) = delete;
+  CompactionPolicy& operator=(const CompactionPolicy&) = delete;
+
+  CompactionPolicy(CompactionPolicy&&) = delete;
+  CompactionPolicy& operator=(CompactionPolicy&&) = delete;
+
+  virtual ~CompactionPolicy() = default;
+
+  // Return the next compaction to run, or std::nullopt if the tables
+  // are fine as they are.
+  virtual std::optional<CompactionTask> PickCompaction(
+      const LevelSummary& levels, const Options& options) const = 0;
+};
+
+// Level 0 is compacted once it holds Options::trigger_compaction_at tables.
+// Level n > 0 is compacted once it holds more than 10^(n + 1) MB. All tables
+// of the chosen level are merged into level n + 1.
+class LeveledCompactionPolicy : public CompactionPolicy {
+ public:
+  std::optional<CompactionTask> PickCompaction(
+      const LevelSummary& levels, const Options& options) const override;
+};
+
+struct UniversalCompactionOptions {
+  // Percentage flexibility when comparing run sizes. A run is merged with
+  // the newer runs before it if its size is at most
+  // (100 + size_ratio)% of their combined size.
+  size_t size_ratio{1};
+
+  // Bounds on the number of runs merged by a size ratio compaction.
+  size_t min_merge_width{2};
+  size_t max_merge_width{std::numeric_limits<size_t>::max()};
+
+  // If the newer runs take up more than this percentage of the size of the
+  // oldest run, everything is merged into a single run.
+  size_t max_size_amplification_percent{200};
+};
+
+// Size-tiered compaction. Every table in level 0 is a sorted run, and runs
+// of similar size are merged together only when Options::trigger_compaction_at
+// runs have accumulated. Data is rewritten far less often than with leveled
+// compaction at the cost of more runs to search on reads.
+class UniversalCompactionPolicy : public CompactionPolicy {
+ public:
+  UniversalCompactionPolicy() = default;
+
+  explicit UniversalCompactionPolicy(UniversalCompactionOptions options)
+      : options_{options} {}
+
+  std::optional<CompactionTask> PickCompaction(
+      const LevelSummary& levels, const Options& options) const override;
+
+ private:
+  std::optional<CompactionTask> PickSizeAmplification(
+      const LevelSummary& levels) const;
+
+  std::optional<CompactionTask> PickSizeRatio(
+      const LevelSummary& levels) const;
+
+  UniversalCompactionOptions options_;
+};
+
+struct FIFOCompactionOptions {
+  // Once the tables take up more than this many bytes, the oldest ones are
+  // dropped.
+  size_t max_table_files_size{1024 * 1024 * 1024};
+
+  // Tables older than this are dropped. Zero means no limit. Ages are only
+  // checked after a memtable is flushed, so without writes, expired tables
+  // stay readable until the next flush, also across reopens.
+  std::chrono::seconds ttl{0};
+};
+
+// For data that is never updated and expires, like time series. Tables
+// flushed from the memtable stay in level 0 and are never merged. The oldest
+// ones are deleted whole once the size or age limit is hit, so every key is
+// written to a table exactly once.
+class FIFOCompactionPolicy : public CompactionPolicy {
+ public:
+  FIFOCompactionPolicy() = default;
+
+  explicit FIFOCompactionPolicy(FIFOCompactionOptions options)
+      : options_{options} {}
+
+  std::optional<CompactionTask> PickCompaction(
+      const LevelSummary& levels, const Options& options) const override;
+
+ private:
+  FIFOCompactionOptions options_;
+};
+
+}  // namespace mdb
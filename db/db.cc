@@ -1,11 +1,12 @@
 #include "db.h"
 
+#include <algorithm>
 #include <boost/log/trivial.hpp>
 #include <iostream>
-#include <queue>
 
 #include "helpers.h"
 #include "log_reader.h"
+#include "memtable_reader.h"
 
 namespace mdb {
 
@@ -31,76 +32,367 @@ DB::DB(Options opt) : options_{std::move(opt)} {
   } else {
     InitNextLogWriter();
   }
+
+  if (!options_.write_sync && (options_.wal_sync_interval_ms > 0 ||
+                               options_.wal_sync_interval_bytes > 0)) {
+    wal_sync_thread_ = std::thread([this] { SyncWALInBackground(); });
+  }
 }
 
-void DB::Put(std::string_view key, std::string_view value) {
+DB::~DB() {
+  async_pool_.reset();
+
+  if (!wal_sync_thread_.joinable()) {
+    return;
+  }
+
+  {
+    std::scoped_lock lk{wal_sync_mutex_};
+    stop_wal_sync_ = true;
+  }
+  wal_sync_cv_.notify_one();
+  wal_sync_thread_.join();
+
+  try {
+    SyncWAL();
+  } catch (const std::system_error&) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to sync the log when closing the DB.";
+  }
+}
+
+void DB::Put(std::string_view key, std::string_view value,
+             const WriteOptions& write_options) {
   if (key.empty() || value.empty()) {
     throw std::invalid_argument("Key and value must be non-empty.");
   }
 
-  PutOrDelete(key, value);
+  PutOrDelete(key, value, write_options);
 }
 
-std::string DB::Get(std::string_view key) {
-  std::shared_lock lk(memtable_mutex_);
+std::string DB::Get(std::string_view key, const ReadOptions& read_options) {
+  std::string value;
+  Get(key, value, read_options);
+  return value;
+}
 
-  auto value_loc{memtable_.find(key)};
-  if (value_loc != memtable_.end()) {
-    return value_loc->second;
+void DB::Get(std::string_view key, std::string& value,
+             const ReadOptions& read_options) {
+  PinnableValue pinned{&value};
+  Get(key, pinned, read_options);
+  if (pinned.IsPinned()) {
+    value.assign(pinned.View());
   }
+}
 
-  lk.unlock();
+void DB::Get(std::string_view key, PinnableValue& value,
+             const ReadOptions& read_options) {
+  auto snapshot{read_options.snapshot != nullptr
+                    ? read_options.snapshot->Sequence()
+                    : kMaxSequenceNumber};
+
+  // The ticket is taken before the memtable is searched. A write that the
+  // search misses then keeps what is read from the tables out of the cache.
+  auto* row_cache{read_options.snapshot == nullptr ? options_.row_cache.get()
+                                                   : nullptr};
+  std::optional<RowCache::Ticket> ticket;
+  if (row_cache != nullptr) {
+    ticket = row_cache->GetTicket(key);
+  }
+
+  {
+    // The memtable may be cleared once the lock is released.
+    std::shared_lock lk(*memtable_mutex_);
+    if (auto found{memtable_->GetView(key, snapshot)}) {
+      value.PinSelf(*found);
+      return;
+    }
+  }
 
-  return disk_storage_manager_.ValueOf(key);
+  if (row_cache != nullptr) {
+    if (auto cached{row_cache->Get(key)}) {
+      *value.GetSelf() = std::move(*cached);
+      value.PinSelf();
+      return;
+    }
+  }
+
+  disk_storage_manager_.ValueOf(key, snapshot, value);
+  if (row_cache != nullptr) {
+    row_cache->Insert(key, std::string{value.View()}, *ticket);
+  }
+}
+
+std::vector<std::string> DB::MultiGet(const std::vector<std::string_view>& keys,
+                                      const ReadOptions& read_options) {
+  auto snapshot{read_options.snapshot != nullptr
+                    ? read_options.snapshot->Sequence()
+                    : kMaxSequenceNumber};
+
+  // Duplicates are looked up once.
+  std::vector<std::string_view> sorted_keys{keys};
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+  sorted_keys.erase(std::unique(sorted_keys.begin(), sorted_keys.end()),
+                    sorted_keys.end());
+
+  std::vector<std::optional<std::string>> values(sorted_keys.size());
+  {
+    std::shared_lock lk(*memtable_mutex_);
+    for (size_t i = 0; i < sorted_keys.size(); ++i) {
+      values[i] = memtable_->Get(sorted_keys[i], snapshot);
+    }
+  }
+
+  disk_storage_manager_.MultiValueOf(sorted_keys, snapshot, values);
+
+  std::vector<std::string> results;
+  results.reserve(keys.size());
+  for (auto key : keys) {
+    auto i{std::lower_bound(sorted_keys.begin(), sorted_keys.end(), key) -
+           sorted_keys.begin()};
+    results.push_back(values[i].value_or(""));
+  }
+  return results;
 }
 
-void DB::Delete(std::string_view key) {
+void DB::Delete(std::string_view key, const WriteOptions& write_options) {
   if (key.empty()) {
     throw std::invalid_argument("Key must be non-empty.");
   }
 
-  PutOrDelete(key, "");
+  PutOrDelete(key, "", write_options);
 }
 
-void DB::PutOrDelete(std::string_view key, std::string_view value) {
+void DB::DeleteRange(std::string_view begin, std::string_view end,
+                     const WriteOptions& write_options) {
+  if (begin.empty() || begin >= end) {
+    throw std::invalid_argument("Begin must be non-empty and less than end.");
+  }
+
+  if (write_options.low_pri) {
+    ThrottleLowPriWrite();
+  }
+
   std::unique_lock<std::mutex> lk(write_mutex_);
 
-  logger_.Add(key, value);
+  auto seq{last_sequence_ + 1};
+  if (!write_options.disable_wal) {
+    auto logged{logger_.Size()};
+    logger_.AddRangeTombstone(begin, end, seq);
+    SyncWALIfDue(logger_.Size() - logged, write_options);
+  }
 
-  std::unique_lock memtable_lk(memtable_mutex_);
-  UpdateMemtable(key, value);
+  std::unique_lock memtable_lk(*memtable_mutex_);
+  AddRangeTombstoneToMemtable(begin, end, seq);
+  last_sequence_ = seq;
   memtable_lk.unlock();
 
+  // Only after the memtable has the write. See Get().
+  if (options_.row_cache != nullptr) {
+    options_.row_cache->Clear();
+  }
+
+  FlushMemtableIfFull();
+}
+
+void DB::PutOrDelete(std::string_view key, std::string_view value,
+                     const WriteOptions& write_options) {
+  if (write_options.low_pri) {
+    ThrottleLowPriWrite();
+  }
+
+  std::unique_lock<std::mutex> lk(write_mutex_);
+
+  auto seq{last_sequence_ + 1};
+  if (!write_options.disable_wal) {
+    auto logged{logger_.Size()};
+    logger_.Add(key, value, seq);
+    SyncWALIfDue(logger_.Size() - logged, write_options);
+  }
+
+  std::unique_lock memtable_lk(*memtable_mutex_);
+  UpdateMemtable(key, value, seq);
+  last_sequence_ = seq;
+  memtable_lk.unlock();
+
+  // Only after the memtable has the write. See Get().
+  if (options_.row_cache != nullptr) {
+    options_.row_cache->Erase(key);
+  }
+
+  // A synced write stays durable if this retires the log it was synced to,
+  // since the flushed table and its manifest edit are synced first.
+  FlushMemtableIfFull();
+}
+
+std::future<void> DB::PutAsync(std::string key, std::string value,
+                               const WriteOptions& write_options) {
+  return AsyncPool().Submit([this, key = std::move(key),
+                             value = std::move(value), write_options] {
+    Put(key, value, write_options);
+  });
+}
+
+std::future<std::string> DB::GetAsync(std::string key,
+                                      const ReadOptions& read_options) {
+  return AsyncPool().Submit([this, key = std::move(key), read_options] {
+    return Get(key, read_options);
+  });
+}
+
+ThreadPool& DB::AsyncPool() {
+  std::call_once(async_pool_flag_, [this] {
+    auto num_threads{std::max<size_t>(options_.async_threads, 1)};
+    async_pool_ = std::make_unique<ThreadPool>(num_threads);
+  });
+  return *async_pool_;
+}
+
+void DB::SyncWAL() { SyncWAL(/*durable=*/true); }
+
+void DB::SyncWAL(bool durable) {
+  std::unique_lock lk{write_mutex_};
+  auto sync{logger_.FlushForSync(durable)};
+  unsynced_wal_bytes_ = 0;
+  lk.unlock();
+
+  sync();
+}
+
+void DB::SyncWALIfDue(size_t size, const WriteOptions& write_options) {
+  // The log syncs every write by itself.
+  if (options_.write_sync) {
+    return;
+  }
+
+  if (write_options.sync) {
+    logger_.FlushForSync()();
+    unsynced_wal_bytes_ = 0;
+    return;
+  }
+
+  if (options_.wal_sync_interval_bytes == 0) {
+    return;
+  }
+
+  unsynced_wal_bytes_ += size;
+  if (unsynced_wal_bytes_ >= options_.wal_sync_interval_bytes) {
+    unsynced_wal_bytes_ = 0;
+    {
+      std::scoped_lock lk{wal_sync_mutex_};
+      wal_sync_requested_ = true;
+    }
+    wal_sync_cv_.notify_one();
+  }
+}
+
+void DB::SyncWALInBackground() {
+  auto woken{[this] { return stop_wal_sync_ || wal_sync_requested_; }};
+
+  std::unique_lock lk{wal_sync_mutex_};
+  while (true) {
+    if (options_.wal_sync_interval_ms > 0) {
+      wal_sync_cv_.wait_for(
+          lk, std::chrono::milliseconds{options_.wal_sync_interval_ms}, woken);
+    } else {
+      wal_sync_cv_.wait(lk, woken);
+    }
+    if (stop_wal_sync_) {
+      return;
+    }
+    wal_sync_requested_ = false;
+
+    lk.unlock();
+    try {
+      SyncWAL(/*durable=*/false);
+    } catch (const std::system_error& e) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to sync the log: " << e.what();
+    }
+    lk.lock();
+  }
+}
+
+void DB::ThrottleLowPriWrite() {
+  // Compactions run one at a time, so waiting for the ongoing one lets it
+  // work through the backlog it picked up.
+  if (disk_storage_manager_.NumTables(0) >=
+      options_.slowdown_low_pri_writes_at) {
+    disk_storage_manager_.WaitForOngoingCompactions();
+  }
+}
+
+void DB::UpdateMemtable(std::string_view key, std::string_view value,
+                        SequenceNumber seq) {
+  memtable_->Add(key, value, seq);
+  cache_size_ += key.size() + value.size();
+}
+
+void DB::AddRangeTombstoneToMemtable(std::string_view begin,
+                                     std::string_view end,
+                                     SequenceNumber seq) {
+  // The entries it deletes stay around for older snapshots. Versions that
+  // nobody can see are dropped when the memtable is flushed.
+  memtable_->AddRangeTombstone(begin, end, seq);
+  cache_size_ += begin.size() + end.size();
+}
+
+void DB::FlushMemtableIfFull() {
   if (cache_size_ > options_.memtable_max_size) {
     BOOST_LOG_TRIVIAL(info) << "Flushing memtable to disk.";
     // Flush the memtable and create a new reader.
-    disk_storage_manager_.WriteMemtable(options_, memtable_);
+    disk_storage_manager_.WriteMemtable(options_, *memtable_, next_log_);
 
-    memtable_lk.lock();
+    std::unique_lock memtable_lk(*memtable_mutex_);
     ClearMemtable();
   }
 }
 
-void DB::UpdateMemtable(std::string_view key, std::string_view value) {
-  memtable_.insert_or_assign(std::string(key), value);
-  cache_size_ += key.size() + value.size();
-}
-
 void DB::ClearMemtable() {
   cache_size_ = 0;
 
   // Now that the memtable has been written, the logfile can
-  // be removed.
-  try {
-    options_.env->RemoveFile(logger_.GetFileName());
-  } catch (const std::system_error&) {
-    BOOST_LOG_TRIVIAL(error)
-        << "Failed to remove obsolete log file " << logger_.GetFileName();
-  }
+  // be retired. It is closed first.
+  auto fname{logger_.GetFileName()};
+  logger_ = LogWriter{};
+  RetireLog(fname);
 
   InitNextLogWriter();
 
-  memtable_.clear();
+  // Iterators may still hold the old memtable, so it is replaced rather
+  // than cleared.
+  memtable_ = std::make_shared<MemTable>();
+}
+
+DBIterator DB::NewIterator(const ReadOptions& read_options) {
+  // Holding the memtable lock keeps a flush from replacing the memtable in
+  // between. A flushed table may show up in both places, which is harmless
+  // since the memtable is searched first.
+  std::shared_lock lk(*memtable_mutex_);
+
+  // The memtable is read in place while writes go on, so the iterator reads
+  // as of the last write unless it has a snapshot.
+  auto snapshot{read_options.snapshot != nullptr
+                    ? read_options.snapshot->Sequence()
+                    : last_sequence_};
+  auto memtable{memtable_};
+  auto tables{disk_storage_manager_.Tables()};
+  lk.unlock();
+
+  std::vector<std::shared_ptr<TableReader>> sources{
+      std::make_shared<MemTableReader>(std::move(memtable), memtable_mutex_)};
+  sources.insert(sources.end(), tables.begin(), tables.end());
+
+  return DBIterator{std::move(sources), snapshot};
+}
+
+const Snapshot* DB::GetSnapshot() {
+  // Writes and flushes happen under the write mutex, so no compaction can
+  // see data newer than the snapshot before it is registered.
+  std::scoped_lock lk{write_mutex_};
+  return snapshots_.New(last_sequence_);
+}
+
+void DB::ReleaseSnapshot(const Snapshot* snapshot) {
+  snapshots_.Release(snapshot);
 }
 
 void DB::WaitForOngoingCompactions() {
@@ -108,62 +400,75 @@ void DB::WaitForOngoingCompactions() {
 }
 
 void DB::Recover() {
-  // Priority queue since we want to grab the max eventually.
-  std::vector<size_t> log_file_indices;
-  std::priority_queue<size_t> table_file_indices;
-
-  for (const auto& file : std::filesystem::directory_iterator(options_.path)) {
-    auto file_info{util::GetFileInfo(file)};
-    switch (file_info.id) {
-      case util::FileType::LogFile:
-        log_file_indices.push_back(file_info.index);
-        break;
-      case util::FileType::TableFile:
-        table_file_indices.push(file_info.index);
-        break;
-      case util::FileType::Unknown:
-        std::error_code ec;
-        auto success = std::filesystem::remove_all(file, ec);
-        if (!success) {
-          BOOST_LOG_TRIVIAL(warning)
-              << "Could not remove extraneous file " << file.path().string();
-        }
-        break;
-    }
-  }
+  // Everything we need to know about the files on disk is in the manifest,
+  // so the directory is never listed.
+  disk_storage_manager_.LoadIndices(options_);
+  LoadLogFile(disk_storage_manager_.LogNumber());
 
-  LoadLogFile(log_file_indices);
-  disk_storage_manager_.LoadIndices(table_file_indices, options_);
+  last_sequence_ =
+      std::max(last_sequence_, disk_storage_manager_.LastSequence());
 }
 
-void DB::LoadLogFile(const std::vector<size_t>& log_file_indices) {
-  if (log_file_indices.empty()) {
+void DB::LoadLogFile(size_t log_number) {
+  // Only one log is live at a time. The one before it is left behind if we
+  // crashed right after its memtable was flushed.
+  if (log_number > 0) {
+    auto fname{util::LogFileName(options_, log_number - 1)};
+    try {
+      if (options_.env->FileExists(fname)) {
+        options_.env->RemoveFile(fname);
+      }
+    } catch (const std::system_error&) {
+      BOOST_LOG_TRIVIAL(error)
+          << "Failed to remove obsolete log file " << fname;
+    }
+  }
+
+  next_log_ = log_number;
+  auto fname{util::LogFileName(options_, log_number)};
+  if (!options_.env->FileExists(fname)) {
     BOOST_LOG_TRIVIAL(warning)
         << "DB was started in recovery mode, but no log file was found.";
   } else {
-    next_log_ =
-        *std::max_element(log_file_indices.begin(), log_file_indices.end());
-    LogReader reader{next_log_, options_};
-    memtable_ = reader.ReadMemTable();
-
-    for (const auto& idx : log_file_indices) {
-      if (idx != next_log_) {
-        auto fname{util::LogFileName(options_, idx)};
-        try {
-          options_.env->RemoveFile(fname);
-        } catch (const std::system_error&) {
-          BOOST_LOG_TRIVIAL(error)
-              << "Failed to remove obsolete log file " << fname;
-        }
-      }
+    LogReader reader{log_number, options_};
+    *memtable_ = reader.ReadVersions();
+
+    // Appending to the log could leave new records behind a torn one, or
+    // in the middle of a block. The replayed writes are flushed instead,
+    // and a new log is started.
+    if (!memtable_->Empty()) {
+      disk_storage_manager_.WriteMemtable(options_, *memtable_, log_number + 1);
+      next_log_ = log_number + 1;
     }
+    last_sequence_ = memtable_->LastSequence();
+    memtable_->Clear();
+
+    // Never recycled: if nothing was replayed, the next log has the same
+    // number, and the records left in the file would pass for its own.
+    options_.env->RemoveFile(fname);
   }
 
   InitNextLogWriter();
 }
 
+void DB::RetireLog(const std::string& fname) {
+  if (options_.recycle_log_files) {
+    recycled_log_ = fname;
+    return;
+  }
+
+  try {
+    options_.env->RemoveFile(fname);
+  } catch (const std::system_error&) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to remove obsolete log file " << fname;
+  }
+}
+
 void DB::InitNextLogWriter() {
-  logger_ = LogWriter(next_log_, options_);
+  // The next log has a higher number than the recycled one, so the reader
+  // tells its records from the old ones.
+  logger_ = LogWriter(next_log_, options_, recycled_log_);
+  recycled_log_.clear();
   next_log_ += 1;
 }
 
@@ -0,0 +1,145 @@
+#include "db_iterator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "helpers.h"
+
+namespace mdb {
+
+DBIterator::DBIterator(std::vector<std::shared_ptr<TableReader>> sources,
+                       SequenceNumber snapshot)
+    : snapshot_{snapshot} {
+  sources_.reserve(sources.size());
+
+  for (auto& reader : sources) {
+    auto begin{reader->Begin()};
+    auto end{reader->End()};
+    const auto& tombstones{reader->RangeTombstones()};
+
+    sources_.push_back(
+        {std::move(reader), std::move(begin), std::move(end),
+         tombstones_.size()});
+    tombstones_.insert(tombstones_.end(), tombstones.cbegin(),
+                       tombstones.cend());
+  }
+}
+
+void DBIterator::Seek(std::string_view key) {
+  for (auto& source : sources_) {
+    source.cur = source.reader->Seek(key);
+    SkipInvisible(source);
+  }
+
+  Reset();
+}
+
+void DBIterator::SeekToFirst() {
+  for (auto& source : sources_) {
+    source.cur = source.reader->Begin();
+    SkipInvisible(source);
+  }
+
+  Reset();
+}
+
+bool DBIterator::Valid() const noexcept { return valid_; }
+
+void DBIterator::Next() {
+  assert(Valid());
+  FindNextVisible();
+}
+
+std::string_view DBIterator::Key() const noexcept {
+  assert(Valid());
+  return key_;
+}
+
+std::string_view DBIterator::Value() const noexcept {
+  assert(Valid());
+  return value_;
+}
+
+bool DBIterator::HeapGreater(size_t lhs, size_t rhs) {
+  int cmp{sources_[lhs].cur->first.compare(sources_[rhs].cur->first)};
+  if (cmp == 0) {
+    // The newer source has a lower index and has to come out first.
+    return lhs > rhs;
+  }
+  return cmp > 0;
+}
+
+void DBIterator::Reset() {
+  heap_.clear();
+  for (size_t i = 0; i < sources_.size(); i++) {
+    if (sources_[i].cur != sources_[i].end) {
+      heap_.push_back(i);
+    }
+  }
+
+  auto greater{
+      [this](size_t lhs, size_t rhs) { return HeapGreater(lhs, rhs); }};
+  std::make_heap(heap_.begin(), heap_.end(), greater);
+
+  FindNextVisible();
+}
+
+void DBIterator::SkipInvisible(Source& source) {
+  while (source.cur != source.end && source.cur.Sequence() > snapshot_) {
+    ++source.cur;
+  }
+}
+
+void DBIterator::FindNextVisible() {
+  while (!heap_.empty()) {
+    // The top of the heap is the newest version of the smallest key.
+    const auto& source{sources_[heap_.front()]};
+    const auto& [key, value]{*source.cur};
+
+    bool deleted_by_range{
+        std::any_of(tombstones_.cbegin(),
+                    tombstones_.cbegin() + source.num_newer_tombstones,
+                    [&key = key, this](const RangeTombstone& tombstone) {
+                      return tombstone.seq <= snapshot_ &&
+                             tombstone.Covers(key);
+                    }) ||
+        util::IsCovered(key, source.cur.Sequence(),
+                        source.reader->RangeTombstones(), snapshot_)};
+
+    if (!value.empty() && !deleted_by_range) {
+      key_ = key;
+      value_ = value;
+      SkipKey(key_);
+
+      valid_ = true;
+      return;
+    }
+
+    // Skipping moves the source, so the key has to be copied first.
+    SkipKey(std::string(key));
+  }
+
+  valid_ = false;
+}
+
+void DBIterator::SkipKey(std::string_view key) {
+  auto greater{
+      [this](size_t lhs, size_t rhs) { return HeapGreater(lhs, rhs); }};
+
+  while (!heap_.empty() && sources_[heap_.front()].cur->first == key) {
+    std::pop_heap(heap_.begin(), heap_.end(), greater);
+
+    // The older versions of the key in this source are skipped as well.
+    auto& source{sources_[heap_.back()]};
+    ++source.cur;
+    SkipInvisible(source);
+
+    if (source.cur != source.end) {
+      std::push_heap(heap_.begin(), heap_.end(), greater);
+    } else {
+      heap_.pop_back();
+    }
+  }
+}
+
+}  // namespace mdb
@@ -1,80 +1,378 @@
 #include "disk_storage_manager.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/log/trivial.hpp>
 #include <chrono>
-#include <cmath>
 #include <iostream>
-#include <queue>
 #include <vector>
 
+#include "helpers.h"
 #include "iterator.h"
 #include "table_reader.h"
 #include "table_writer.h"
+#include "thread_pool.h"
 
 namespace mdb {
 
 namespace {
 
-struct KeyValue {
-  KeyValue(std::pair<std::string, std::string> kv_, size_t iterator_id_)
-      : kv{std::move(kv_)}, iterator_id{iterator_id_} {}
+// Adapts a table's TableIterators to the interface of
+// UncompressedTableReader::Iterator, for formats without an iterator of
+// their own.
+class GenericTableIterator {
+ public:
+  explicit GenericTableIterator(TableReader& reader)
+      : cur_{reader.Begin()}, end_{reader.End()} {}
+
+  bool Valid() const { return cur_ != end_; }
+  void Next() { ++cur_; }
+  std::string_view Key() const noexcept { return cur_->first; }
+  SequenceNumber Sequence() const noexcept { return cur_.Sequence(); }
+  std::string_view Value() const noexcept { return cur_->second; }
+
+ private:
+  TableIterator cur_;
+  TableIterator end_;
+};
+
+// Merge the inputs, which are ordered from newest to oldest, and call
+// visit(key, seq, value, input_index) with every version in sorted order:
+// by key, then from newest to oldest. The views are only valid during the
+// call.
+template <typename Iterator, typename Visitor>
+void MergeInputs(std::vector<Iterator>& inputs, Visitor&& visit) {
+  auto greater{[&inputs](size_t lhs, size_t rhs) {
+    int cmp{inputs[lhs].Key().compare(inputs[rhs].Key())};
+    if (cmp != 0) {
+      return cmp > 0;
+    }
 
-  friend bool operator>(const KeyValue& lhs, const KeyValue& rhs) {
-    int cmp{lhs.kv.first.compare(rhs.kv.first)};
-    if (cmp == 0) {
-      // In the case that the strings are equal, the more recent one is
-      // smaller. This causes it to have higher priority in the min-heap.
-      return lhs.iterator_id > rhs.iterator_id;
+    // The newer version has to come out of the min-heap first. Versions
+    // without a sequence number are ordered by their input.
+    auto lhs_seq{inputs[lhs].Sequence()};
+    auto rhs_seq{inputs[rhs].Sequence()};
+    return lhs_seq == rhs_seq ? lhs > rhs : lhs_seq < rhs_seq;
+  }};
+
+  std::vector<size_t> heap;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (inputs[i].Valid()) {
+      heap.push_back(i);
     }
-    return cmp > 0;
   }
+  std::make_heap(heap.begin(), heap.end(), greater);
 
-  std::pair<std::string, std::string> kv;
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), greater);
 
-  // Lower ID = more recent.
-  size_t iterator_id;
-};
+    auto index{heap.back()};
+    auto& input{inputs[index]};
+    visit(input.Key(), input.Sequence(), input.Value(), index);
+
+    input.Next();
+    if (input.Valid()) {
+      std::push_heap(heap.begin(), heap.end(), greater);
+    } else {
+      heap.pop_back();
+    }
+  }
+}
+
+// Sort the tombstones and merge the ones that overlap or touch. Only
+// tombstones with the same sequence number are merged, since readers at
+// different snapshots see different ones.
+RangeTombstoneList MergeRangeTombstones(RangeTombstoneList tombstones) {
+  std::sort(tombstones.begin(), tombstones.end(),
+            [](const RangeTombstone& lhs, const RangeTombstone& rhs) {
+              return lhs.seq == rhs.seq ? lhs.begin < rhs.begin
+                                        : lhs.seq < rhs.seq;
+            });
+
+  RangeTombstoneList merged;
+  for (auto& tombstone : tombstones) {
+    if (!merged.empty() && tombstone.seq == merged.back().seq &&
+        tombstone.begin <= merged.back().end) {
+      merged.back().end = std::max(merged.back().end, tombstone.end);
+    } else {
+      merged.push_back(std::move(tombstone));
+    }
+  }
+
+  return merged;
+}
+
+TableMetadata ToMetadata(const DiskStorageManager::Table& table,
+                         size_t level) {
+  return {.number = table.number,
+          .level = level,
+          .recency = table.recency,
+          .smallest_key = table.smallest_key,
+          .largest_key = table.largest_key,
+          .size = table.size,
+          .range_tombstones = table.range_tombstones,
+          .creation_time = table.creation_time};
+}
+
+// Lower "newest_hit" to "index" unless a newer table already has the key.
+void RecordHit(std::atomic<size_t>& newest_hit, size_t index) {
+  auto newest{newest_hit.load()};
+  while (index < newest && !newest_hit.compare_exchange_weak(newest, index)) {
+  }
+}
 
 }  // namespace
 
-using PriorityQueue = std::priority_queue<KeyValue, std::vector<KeyValue>,
-                                          // Use a min-heap
-                                          std::greater<KeyValue>>;
+DiskStorageManager::DiskStorageManager(const SnapshotList* snapshots)
+    : snapshots_{snapshots} {}
 
 DiskStorageManager::~DiskStorageManager() { WaitForOngoingCompactions(); }
 
-std::string DiskStorageManager::ValueOf(std::string_view key) const {
+std::string DiskStorageManager::ValueOf(std::string_view key,
+                                        SequenceNumber snapshot) const {
+  std::string buffer;
+  PinnableValue value{&buffer};
+  ValueOf(key, snapshot, value);
+  if (value.IsPinned()) {
+    return std::string{value.View()};
+  }
+  return buffer;
+}
+
+void DiskStorageManager::ValueOf(std::string_view key,
+                                 SequenceNumber snapshot,
+                                 PinnableValue& value) const {
   std::shared_lock lk{level_mutex_};
 
+  // The candidates of the first levels are collected, in the order they
+  // are searched, and probed together.
+  std::vector<std::shared_ptr<TableReader>> readers;
+  auto parallel_levels_end{
+      levels_.lower_bound(options_.parallel_probe_levels)};
+  for (auto level{levels_.cbegin()}; level != parallel_levels_end; ++level) {
+    for (const auto& table : level->second) {
+      if (key >= table.smallest_key && key <= table.largest_key) {
+        readers.push_back(GetReader(table));
+      }
+    }
+  }
+
+  if (!readers.empty()) {
+    auto val{ProbeInParallel(readers, key, snapshot)};
+    if (val) {
+      *value.GetSelf() = std::move(*val);
+      value.PinSelf();
+      return;
+    }
+  }
+
+  for (auto level{parallel_levels_end}; level != levels_.cend(); ++level) {
+    for (const auto& table : level->second) {
+      if (key < table.smallest_key || key > table.largest_key) {
+        continue;
+      }
+
+      // This view is possibly empty if the table has the key marked as
+      // deleted. Nothing is read into scratch if the table is mapped, in
+      // which case the view points into the table itself.
+      auto reader{GetReader(table)};
+      std::vector<char> scratch;
+      auto val{reader->ValueView(key, snapshot, scratch)};
+      if (!val) {
+        continue;
+      }
+
+      // Moving the scratch buffer doesn't move what the view points at.
+      if (scratch.empty()) {
+        value.Pin(*val, std::move(reader));
+      } else {
+        value.Pin(*val,
+                  std::make_shared<std::vector<char>>(std::move(scratch)));
+      }
+      return;
+    }
+  }
+
+  value.Reset();
+}
+
+std::optional<std::string> DiskStorageManager::ProbeInParallel(
+    const std::vector<std::shared_ptr<TableReader>>& readers,
+    std::string_view key, SequenceNumber snapshot) const {
+  if (readers.size() == 1) {
+    return readers.front()->ValueOf(key, snapshot);
+  }
+
+  std::call_once(probe_pool_flag_, [this] {
+    auto num_threads{std::max<size_t>(options_.parallel_probe_threads, 1)};
+    probe_pool_ = std::make_unique<ThreadPool>(num_threads);
+  });
+
+  // Probes are left behind once a newer table has the key, so they own
+  // their copy of it. The index of the newest table known to have the key
+  // lets the probes of older tables that haven't started yet return right
+  // away, instead of holding up the pool.
+  auto owned_key{std::make_shared<std::string>(key)};
+  auto newest_hit{std::make_shared<std::atomic<size_t>>(readers.size())};
+  std::vector<std::future<std::optional<std::string>>> probes;
+  for (size_t i = 1; i < readers.size(); ++i) {
+    probes.push_back(probe_pool_->Submit(
+        [reader = readers[i], owned_key, newest_hit, i,
+         snapshot]() -> std::optional<std::string> {
+          if (newest_hit->load() < i) {
+            return std::nullopt;
+          }
+          auto val{reader->ValueOf(*owned_key, snapshot)};
+          if (val) {
+            RecordHit(*newest_hit, i);
+          }
+          return val;
+        }));
+  }
+
+  auto val{readers.front()->ValueOf(key, snapshot)};
+  if (val) {
+    RecordHit(*newest_hit, 0);
+  }
+  for (auto& probe : probes) {
+    if (val) {
+      break;
+    }
+    val = probe.get();
+  }
+  return val;
+}
+
+void DiskStorageManager::MultiValueOf(
+    const std::vector<std::string_view>& keys, SequenceNumber snapshot,
+    std::vector<std::optional<std::string>>& values) const {
+  struct TableLookup {
+    std::shared_ptr<TableReader> reader;
+    std::vector<size_t> found_in;
+    std::vector<std::string_view> keys;
+    std::unique_ptr<TableReader::MultiLookup> lookup;
+  };
+
+  std::shared_lock lk{level_mutex_};
+
+  std::vector<TableLookup> lookups;
+  std::vector<ReadRequest> requests;
+  std::vector<std::optional<std::string>> table_values;
+
   for (const auto& levelid_and_level : levels_) {
-    for (const auto& reader : levelid_and_level.second) {
-      // This string is possibly empty if the table has
-      // the key marked as deleted.
-      auto val{reader->ValueOf(key)};
-      if (val) {
-        return val.value();
+    lookups.clear();
+    for (const auto& table : levelid_and_level.second) {
+      TableLookup table_lookup;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        if (!values[i] && keys[i] >= table.smallest_key &&
+            keys[i] <= table.largest_key) {
+          table_lookup.found_in.push_back(i);
+          table_lookup.keys.push_back(keys[i]);
+        }
+      }
+      if (!table_lookup.keys.empty()) {
+        table_lookup.reader = GetReader(table);
+        lookups.push_back(std::move(table_lookup));
+      }
+    }
+
+    // The block reads of every table in the level go out as one batch.
+    // Lookups are only started once "lookups" stops moving, since they
+    // refer to its keys.
+    requests.clear();
+    for (auto& table_lookup : lookups) {
+      table_lookup.lookup =
+          table_lookup.reader->StartMultiValueOf(table_lookup.keys, snapshot);
+      const auto& table_requests{table_lookup.lookup->Requests()};
+      requests.insert(requests.end(), table_requests.cbegin(),
+                      table_requests.cend());
+    }
+    if (!requests.empty()) {
+      options_.env->MultiRead(requests);
+    }
+
+    // Tables in a level are ordered from newest to oldest, so the first
+    // one to find a key wins.
+    auto request{requests.cbegin()};
+    for (auto& table_lookup : lookups) {
+      for (auto& table_request : table_lookup.lookup->Requests()) {
+        table_request = *request++;
+      }
+
+      table_values.assign(table_lookup.keys.size(), std::nullopt);
+      table_lookup.lookup->Finish(table_values);
+      for (size_t i = 0; i < table_lookup.found_in.size(); ++i) {
+        auto& value{values[table_lookup.found_in[i]]};
+        if (!value) {
+          value = std::move(table_values[i]);
+        }
       }
     }
   }
+}
 
-  return "";
+void DiskStorageManager::WriteMemtable(
+    const Options& options, const MemTableT& memtable,
+    const RangeTombstoneList& range_tombstones) {
+  WriteMemtable(options, MemTable{memtable, range_tombstones});
 }
 
 void DiskStorageManager::WriteMemtable(const Options& options,
-                                       const MemTableT& memtable) {
-  std::unique_lock level_lk{level_mutex_};
+                                       const MemTable& memtable,
+                                       size_t log_number) {
+  auto table_number{NewTableNumber()};
+  auto writer{options.table_factory->MakeTableWriter(table_number, options, 0)};
+
+  // The range tombstones have to stay since they delete keys in older
+  // tables, but the versions they delete can go if nobody sees them.
+  VersionFilter filter{LiveSnapshots(), false};
+  const auto& tombstones{memtable.RangeTombstones()};
+
+  for (const auto& [version, value] : memtable.Entries()) {
+    const auto& [key, seq]{version};
+
+    bool deleted_by_range{std::any_of(
+        tombstones.cbegin(), tombstones.cend(),
+        [&filter, &key = key, seq = seq](const RangeTombstone& tombstone) {
+          return seq < tombstone.seq && tombstone.Covers(key) &&
+                 filter.Stripe(seq) == filter.Stripe(tombstone.seq);
+        })};
+
+    if (filter.Keep(key, seq, value.empty(), deleted_by_range)) {
+      writer->Add(key, value, seq);
+    }
+  }
 
-  levels_[0].push_front(
-      options.table_factory->TableFromMemtable(next_table_, options, memtable));
+  for (const auto& tombstone : tombstones) {
+    writer->AddRangeTombstone(tombstone.begin, tombstone.end, tombstone.seq);
+  }
+  writer->Flush();
+
+  // The caller retires the log once this returns, so the table and its
+  // edit have to be durable whether or not the log was synced.
+  writer->Sync();
+
+  auto table{MakeTable(
+      table_number,
+      options.table_factory->TableReaderFromWriter(*writer, options),
+      std::chrono::system_clock::now(), table_number, options)};
 
-  ++next_table_;
+  // The table must be in the manifest before a compaction can remove it.
+  LogEdit({.added_tables = {ToMetadata(table, 0)},
+           .last_sequence = memtable.LastSequence(),
+           .log_number = log_number},
+          options, /*sync=*/true);
+
+  std::unique_lock level_lk{level_mutex_};
+  options_ = options;
+  levels_[0].push_front(std::move(table));
   level_lk.unlock();
 
   std::scoped_lock compaction_lk{compaction_mutex_};
-  if (!ongoing_compaction_ && NeedsCompaction(0, options)) {
+  if (!ongoing_compaction_ && NeedsCompaction(options)) {
     ongoing_compaction_ = true;
-    BOOST_LOG_TRIVIAL(info) << "Compaction on level 0 triggered";
-    std::thread(&DiskStorageManager::TriggerCompaction, this, 0, options)
+    BOOST_LOG_TRIVIAL(info) << "Compaction triggered";
+    std::thread(&DiskStorageManager::TriggerCompaction, this, options)
         .detach();
   }
 }
@@ -84,56 +382,277 @@ void DiskStorageManager::WaitForOngoingCompactions() {
   compaction_cv_.wait(lk, [this] { return !ongoing_compaction_; });
 }
 
-void DiskStorageManager::LoadIndices(std::priority_queue<size_t>& table_numbers,
-                                     const Options& opt) {
+std::vector<std::shared_ptr<TableReader>> DiskStorageManager::Tables() const {
+  std::vector<std::shared_ptr<TableReader>> tables;
+
+  std::shared_lock lk{level_mutex_};
+  for (const auto& level_and_tables : levels_) {
+    for (const auto& table : level_and_tables.second) {
+      tables.push_back(GetReader(table));
+    }
+  }
+
+  return tables;
+}
+
+size_t DiskStorageManager::NumTables(size_t level) const {
+  std::shared_lock lk{level_mutex_};
+  auto it{levels_.find(level)};
+  return it == levels_.end() ? 0 : it->second.size();
+}
+
+size_t DiskStorageManager::NumOpenTables() const {
+  return table_cache_.Size();
+}
+
+void DiskStorageManager::LoadIndices(const Options& opt) {
   std::unique_lock level_lk{level_mutex_};
+  options_ = opt;
 
-  while (!table_numbers.empty()) {
-    auto table_number{table_numbers.top()};
+  ManifestState manifest;
+  if (opt.env->FileExists(util::ManifestFileName(opt))) {
+    manifest = ManifestReader{opt}.ReadState();
+  }
+  next_table_ = std::max(next_table_, manifest.next_table);
+  last_sequence_ = std::max(last_sequence_, manifest.last_sequence);
+  log_number_ = std::max(log_number_, manifest.log_number);
+
+  auto remove_table{[&opt](size_t table_number) {
+    auto filename{util::TableFileName(opt, table_number)};
+    if (opt.env->FileExists(filename)) {
+      BOOST_LOG_TRIVIAL(info) << "Removing obsolete table " << table_number;
+      opt.env->RemoveFile(filename);
+    }
+  }};
+
+  // We crashed after a compaction was recorded but before its inputs were
+  // deleted, or while tables were being written.
+  for (auto table_number : manifest.removed_tables) {
+    remove_table(table_number);
+  }
+  for (auto table_number : manifest.pending_tables) {
+    if (manifest.tables.count(table_number) == 0) {
+      remove_table(table_number);
+    }
+  }
 
-    next_table_ = std::max(next_table_, table_number + 1);
-    auto reader{opt.table_factory->MakeTableReader(table_number, opt)};
-    auto level{reader->GetLevel()};
-    levels_[level].push_back(std::move(reader));
+  // Tables started after the last edit got the next numbers.
+  for (auto table_number{next_table_};
+       opt.env->FileExists(util::TableFileName(opt, table_number));
+       table_number++) {
+    remove_table(table_number);
+  }
 
-    table_numbers.pop();
+  manifest.removed_tables.clear();
+  manifest.pending_tables.clear();
+
+  for (const auto& [table_number, metadata] : manifest.tables) {
+    levels_[metadata.level].push_back(
+        {.number = table_number,
+         .smallest_key = metadata.smallest_key,
+         .largest_key = metadata.largest_key,
+         .size = metadata.size,
+         .range_tombstones = metadata.range_tombstones,
+         .creation_time = metadata.creation_time,
+         .recency = metadata.recency});
+  }
+
+  for (auto& level_and_tables : levels_) {
+    level_and_tables.second.sort([](const Table& lhs, const Table& rhs) {
+      return lhs.recency > rhs.recency;
+    });
+  }
+
+  level_lk.unlock();
+
+  // Replaying a long manifest is only paid for once.
+  std::unique_lock manifest_lk{manifest_mutex_};
+  manifest_ = std::make_unique<ManifestWriter>(opt, std::move(manifest));
+  manifest_lk.unlock();
+
+  if (opt.open_tables_on_recovery) {
+    OpenTables(opt);
   }
 }
 
-bool DiskStorageManager::NeedsCompaction(size_t level,
-                                         const Options& opt) const {
-  if (level == 0) {
-    std::shared_lock lk{level_mutex_};
-    auto it{levels_.find(0)};
-    if (it == levels_.end()) {
-      return false;
+void DiskStorageManager::OpenTables(const Options& options) {
+  std::vector<size_t> table_numbers;
+  auto max_tables{std::max<size_t>(options.max_open_tables, 1)};
+
+  std::shared_lock level_lk{level_mutex_};
+  for (const auto& level_and_tables : levels_) {
+    for (const auto& table : level_and_tables.second) {
+      if (table_numbers.size() < max_tables) {
+        table_numbers.push_back(table.number);
+      }
     }
+  }
+  level_lk.unlock();
+
+  if (table_numbers.empty()) {
+    return;
+  }
+
+  ThreadPool pool{std::clamp<size_t>(options.max_file_opening_threads, 1,
+                                     table_numbers.size())};
+
+  std::vector<std::future<std::shared_ptr<TableReader>>> opened;
+  for (auto table_number : table_numbers) {
+    opened.push_back(pool.Submit([this, table_number, &options]() {
+      return table_cache_.Get(table_number, options);
+    }));
+  }
 
-    return it->second.size() >= opt.trigger_compaction_at;
+  for (auto& reader : opened) {
+    reader.get();
   }
 
-  return TotalSize(level) > std::pow(10, level + 1) * 1000 * 1000;
+  // Touch the tables that are searched first last, so that they are the
+  // last ones to be evicted.
+  for (auto it = table_numbers.crbegin(); it != table_numbers.crend(); ++it) {
+    table_cache_.Get(*it, options);
+  }
 }
 
-size_t DiskStorageManager::TotalSize(size_t level) const {
-  size_t total{0};
+DiskStorageManager::Table DiskStorageManager::MakeTable(
+    size_t table_number, std::shared_ptr<TableReader> reader,
+    std::chrono::system_clock::time_point creation_time, size_t recency,
+    const Options& options) {
+  Table table{.number = table_number,
+              .smallest_key = std::string{reader->SmallestKey()},
+              .largest_key = std::string{reader->LargestKey()},
+              .size = reader->Size(),
+              .range_tombstones = reader->RangeTombstones(),
+              .creation_time = creation_time,
+              .recency = recency};
+
+  table_cache_.Insert(table_number, std::move(reader), options);
+  return table;
+}
 
+std::shared_ptr<TableReader> DiskStorageManager::GetReader(
+    const Table& table) const {
+  return table_cache_.Get(table.number, options_);
+}
+
+SequenceNumber DiskStorageManager::LastSequence() const {
   std::shared_lock lk{level_mutex_};
-  auto it{levels_.find(level)};
-  if (it == levels_.end()) {
-    return 0;
+  return last_sequence_;
+}
+
+size_t DiskStorageManager::LogNumber() const {
+  std::shared_lock lk{level_mutex_};
+  return log_number_;
+}
+
+size_t DiskStorageManager::NewTableNumber() {
+  std::scoped_lock lk{level_mutex_};
+  pending_tables_.insert(next_table_);
+  return next_table_++;
+}
+
+std::vector<SequenceNumber> DiskStorageManager::LiveSnapshots() const {
+  return snapshots_ != nullptr ? snapshots_->Sequences()
+                               : std::vector<SequenceNumber>{};
+}
+
+LevelSummary DiskStorageManager::Summarize() const {
+  LevelSummary summary;
+
+  std::shared_lock lk{level_mutex_};
+  for (const auto& [level, tables] : levels_) {
+    auto& level_summary{summary[level]};
+    for (const auto& table : tables) {
+      level_summary.push_back({table.number, table.size, table.creation_time});
+    }
   }
 
-  for (const auto& reader : it->second) {
-    total += reader->Size();
+  return summary;
+}
+
+bool DiskStorageManager::NeedsCompaction(const Options& options) const {
+  return PickCoveredTables().has_value() ||
+         options.compaction_policy->PickCompaction(Summarize(), options)
+             .has_value();
+}
+
+std::optional<CompactionTask> DiskStorageManager::PickCoveredTables() const {
+  // A snapshot that is older than a tombstone still sees the keys it
+  // deletes.
+  auto snapshots{LiveSnapshots()};
+  auto oldest_snapshot{snapshots.empty() ? kMaxSequenceNumber
+                                         : snapshots.front()};
+
+  std::shared_lock lk{level_mutex_};
+
+  // Levels and the tables within them are visited from newest to oldest,
+  // so these are the tombstones of every table newer than the current one.
+  RangeTombstoneList newer_tombstones;
+
+  for (const auto& [level, tables] : levels_) {
+    CompactionTask task{.level = level,
+                        .tables = {},
+                        .output_level = level,
+                        .drop_deletes = false,
+                        .drop_tables = true};
+
+    for (const auto& table : tables) {
+      std::string_view smallest{table.smallest_key};
+      std::string_view largest{table.largest_key};
+
+      bool covered{!smallest.empty() &&
+                   std::any_of(newer_tombstones.cbegin(),
+                               newer_tombstones.cend(),
+                               [smallest, largest,
+                                oldest_snapshot](const auto& tombstone) {
+                                 return tombstone.seq <= oldest_snapshot &&
+                                        tombstone.begin <= smallest &&
+                                        largest < tombstone.end;
+                               })};
+      if (covered) {
+        task.tables.push_back(table.number);
+      }
+
+      newer_tombstones.insert(newer_tombstones.end(),
+                              table.range_tombstones.cbegin(),
+                              table.range_tombstones.cend());
+    }
+
+    if (!task.tables.empty()) {
+      return task;
+    }
   }
 
-  return total;
+  return std::nullopt;
 }
 
-void DiskStorageManager::TriggerCompaction(size_t level,
-                                           const Options& options) {
-  Compact(level, options);
+void DiskStorageManager::TriggerCompaction(const Options& options) {
+  while (true) {
+    auto task{PickCoveredTables()};
+    if (!task) {
+      task = options.compaction_policy->PickCompaction(Summarize(), options);
+    }
+    if (!task) {
+      break;
+    }
+
+    if (task->drop_tables) {
+      BOOST_LOG_TRIVIAL(info) << "Dropping " << task->tables.size()
+                              << " tables from level " << task->level;
+      DropTables(*task, options);
+    } else if (IsTrivialMove(*task)) {
+      BOOST_LOG_TRIVIAL(info)
+          << "Moving " << task->tables.size() << " tables from level "
+          << task->level << " to level " << task->output_level;
+      MoveTables(*task, options);
+    } else {
+      BOOST_LOG_TRIVIAL(info)
+          << "Compacting " << task->tables.size() << " tables from level "
+          << task->level << " into level " << task->output_level;
+      Compact(*task, options);
+    }
+  }
+
   std::scoped_lock compaction_lk{compaction_mutex_};
   ongoing_compaction_ = false;
 
@@ -147,88 +666,332 @@ void DiskStorageManager::TriggerCompaction(size_t level,
   compaction_cv_.notify_all();
 }
 
-void DiskStorageManager::Compact(size_t level, const Options& options) {
+void DiskStorageManager::Compact(const CompactionTask& task,
+                                 const Options& options) {
   std::shared_lock level_read_lock(level_mutex_);
 
-  // levels_[level] should have already been created if we are calling
-  // Compact(). Throw an exception if it doesn't exist.
-  LevelT& level_list{levels_.at(level)};
+  // The policy only picks tables that exist, so levels_[task.level] should
+  // be there. Throw an exception if it isn't.
+  LevelT& level_list{levels_.at(task.level)};
+
+  auto is_input{[&task](const Table& table) {
+    return std::find(task.tables.cbegin(), task.tables.cend(),
+                     table.number) != task.tables.cend();
+  }};
 
-  PriorityQueue pq;
+  std::vector<std::shared_ptr<TableReader>> inputs;
 
-  std::vector<std::pair<TableIterator, TableIterator>> iterators;
-  iterators.reserve(level_list.size());
+  // The output is as recent as the newest input.
+  size_t recency{0};
 
-  size_t iterator_id{0};
-  for (const auto& reader : level_list) {
-    if (reader->Begin() != reader->End()) {
-      pq.emplace(*reader->Begin(), iterator_id);
-      iterators.emplace_back(reader->Begin(), reader->End());
-      ++iterator_id;
+  // The range tombstones of all inputs, newest first. An input's keys may
+  // only be deleted by the tombstones of newer inputs, which are the first
+  // num_newer_tombstones[input_index] entries.
+  RangeTombstoneList tombstones;
+  std::vector<size_t> num_newer_tombstones;
+
+  // Tables are visited newest first, so lower input indices are more recent.
+  for (const auto& table : level_list) {
+    if (!is_input(table)) {
+      continue;
     }
+
+    inputs.push_back(GetReader(table));
+    recency = std::max(recency, table.recency);
+    num_newer_tombstones.push_back(tombstones.size());
+
+    tombstones.insert(tombstones.end(), table.range_tombstones.cbegin(),
+                      table.range_tombstones.cend());
   }
 
-  // Save this position because tables might be added while we're doing the
-  // compaction. Note insertions won't invalidate level_list_start.
-  auto level_list_start{level_list.begin()};
+  // Only this thread removes tables, so the inputs stay valid after
+  // unlocking even if new tables are added in the meantime.
   level_read_lock.unlock();
 
+  // Snapshots taken from now on see the newest version of everything in
+  // the inputs, which is always kept.
+  VersionFilter filter{LiveSnapshots(), task.drop_deletes};
+
+  // The output is split into several tables that are installed together.
+  std::vector<std::pair<size_t, std::unique_ptr<TableWriter>>> outputs;
+  bool split_outputs{task.output_level > 0};
+
+  auto start_output{[this, &outputs, &task, &options]() {
+    auto table_id{NewTableNumber()};
+    outputs.emplace_back(table_id,
+                         options.table_factory->MakeTableWriter(
+                             table_id, options, task.output_level));
+    return outputs.back().second.get();
+  }};
+
+  // Keys covered by the tombstones are dropped below unless a snapshot
+  // needs them, so the tombstones are kept for the sake of those keys and of
+  // older tables outside of this task.
+  RangeTombstoneList output_tombstones;
+  for (auto& tombstone : MergeRangeTombstones(tombstones)) {
+    if (filter.KeepRangeTombstone(tombstone.seq)) {
+      output_tombstones.push_back(std::move(tombstone));
+    }
+  }
+
+  // Each output gets the pieces of the tombstones between its first key and
+  // the first key of the next output, so that the outputs don't overlap.
+  // An empty bound is unbounded.
+  std::string output_begin{""};
+  auto finish_output{[&output_tombstones, &output_begin](
+                         TableWriter* writer, std::string_view output_end) {
+    for (const auto& tombstone : output_tombstones) {
+      std::string_view begin{std::max<std::string_view>(tombstone.begin,
+                                                        output_begin)};
+      std::string_view end{
+          output_end.empty()
+              ? tombstone.end
+              : std::min<std::string_view>(tombstone.end, output_end)};
+      if (begin < end) {
+        writer->AddRangeTombstone(begin, end, tombstone.seq);
+      }
+    }
+    writer->Flush();
+  }};
+
+  TableWriter* output_io{start_output()};
+
+  // The last key written. All of its versions go to the same output.
+  std::string last_key;
+
+  auto add_entry{[&](std::string_view key, SequenceNumber seq,
+                     std::string_view value, size_t input_index) {
+    // A version may be dropped if a tombstone deletes it for everyone who
+    // can see it. Within an input, only newer tombstones count.
+    auto deletes{[&filter, key, seq](const RangeTombstone& tombstone) {
+      return tombstone.Covers(key) &&
+             filter.Stripe(seq) == filter.Stripe(tombstone.seq);
+    }};
+    const auto& own_tombstones{inputs[input_index]->RangeTombstones()};
+
+    bool deleted_by_range{
+        std::any_of(tombstones.cbegin(),
+                    tombstones.cbegin() + num_newer_tombstones[input_index],
+                    deletes) ||
+        std::any_of(own_tombstones.cbegin(), own_tombstones.cend(),
+                    [&deletes, seq](const RangeTombstone& tombstone) {
+                      return seq < tombstone.seq && deletes(tombstone);
+                    })};
+
+    if (!filter.Keep(key, seq, value.empty(), deleted_by_range)) {
+      return;
+    }
+
+    // Size() only grows when a block is written out, so the current table
+    // always ends on a block boundary.
+    if (split_outputs && key != last_key &&
+        output_io->Size() >= options.target_file_size) {
+      finish_output(output_io, key);
+      output_io = start_output();
+      output_begin = key;
+    }
+    output_io->Add(key, value, seq);
+    last_key.assign(key);
+  }};
+
+  // Uncompressed tables are merged with their own iterator, which saves a
+  // virtual call and two string copies per entry.
+  std::vector<UncompressedTableReader::Iterator> uncompressed_inputs;
+  for (const auto& reader : inputs) {
+    auto* uncompressed{dynamic_cast<UncompressedTableReader*>(reader.get())};
+    if (uncompressed == nullptr) {
+      break;
+    }
+    uncompressed_inputs.push_back(
+        options.use_direct_io_for_flush_and_compaction
+            ? uncompressed->NewIterator(
+                  options.env->MakeDirectReadOnlyIO(reader->GetFileName()))
+            : uncompressed->NewIterator());
+    uncompressed_inputs.back().SeekToFirst();
+  }
+
+  if (uncompressed_inputs.size() == inputs.size()) {
+    MergeInputs(uncompressed_inputs, add_entry);
+  } else {
+    std::vector<GenericTableIterator> generic_inputs;
+    for (const auto& reader : inputs) {
+      generic_inputs.emplace_back(*reader);
+    }
+    MergeInputs(generic_inputs, add_entry);
+  }
+
+  finish_output(output_io, "");
+
+  LevelT output_tables;
+  VersionEdit edit{.removed_tables = task.tables};
+
+  for (auto& [table_id, writer] : outputs) {
+    if (writer->NumKeys() > 0 || writer->NumRangeTombstones() > 0) {
+      writer->Sync();
+      output_tables.push_back(MakeTable(
+          table_id,
+          options.table_factory->TableReaderFromWriter(*writer, options),
+          std::chrono::system_clock::now(), recency, options));
+      edit.added_tables.push_back(
+          ToMetadata(output_tables.back(), task.output_level));
+    } else {
+      options.env->RemoveFile(writer->GetFileName());
+
+      std::scoped_lock lk{level_mutex_};
+      pending_tables_.erase(table_id);
+    }
+  }
+
+  // The inputs are removed below, so the outputs and the edit replacing
+  // them have to be durable first.
+  LogEdit(std::move(edit), options, /*sync=*/true);
+
   std::unique_lock level_write_lock(level_mutex_);
-  auto table_id{next_table_};
-  ++next_table_;
-  level_write_lock.unlock();
+  LevelT& output_list{levels_[task.output_level]};
+
+  // An output that stays in the input level takes the place of the inputs
+  // to keep the level ordered from newest to oldest.
+  auto output_pos{task.output_level == task.level
+                      ? std::find_if(level_list.begin(), level_list.end(),
+                                     is_input)
+                      : output_list.begin()};
+
+  output_list.splice(output_pos, output_tables);
+
+  RemoveInputs(task, options);
+}
+
+void DiskStorageManager::DropTables(const CompactionTask& task,
+                                    const Options& options) {
+  LogEdit({.removed_tables = task.tables}, options, /*sync=*/true);
+
+  std::unique_lock level_lk{level_mutex_};
+  RemoveInputs(task, options);
+}
+
+bool DiskStorageManager::IsTrivialMove(const CompactionTask& task) const {
+  if (task.output_level == task.level) {
+    return false;
+  }
+
+  auto overlaps{[](const Table& lhs, const Table& rhs) {
+    return !(lhs.largest_key < rhs.smallest_key ||
+             rhs.largest_key < lhs.smallest_key);
+  }};
+
+  std::shared_lock lk{level_mutex_};
 
-  auto output_io{
-      options.table_factory->MakeTableWriter(table_id, options, level + 1)};
+  std::vector<const Table*> inputs;
+  for (const auto& table : levels_.at(task.level)) {
+    if (std::find(task.tables.cbegin(), task.tables.cend(), table.number) !=
+        task.tables.cend()) {
+      inputs.push_back(&table);
+    }
+  }
 
-  std::string last_key{""};
+  for (size_t i = 0; i < inputs.size(); i++) {
+    for (size_t j = i + 1; j < inputs.size(); j++) {
+      if (overlaps(*inputs[i], *inputs[j])) {
+        return false;
+      }
+    }
+  }
 
-  while (!pq.empty()) {
-    auto next_pair{pq.top()};
+  auto output_level{levels_.find(task.output_level)};
+  if (output_level == levels_.end()) {
+    return true;
+  }
 
-    // If we've seen the key before, we don't want to take it.
-    if (next_pair.kv.first != last_key) {
-      // Don't take deleted keys during compaction.
-      if (!next_pair.kv.second.empty()) {
-        output_io->Add(next_pair.kv.first, next_pair.kv.second);
+  for (const auto* input : inputs) {
+    for (const auto& table : output_level->second) {
+      if (overlaps(*input, table)) {
+        return false;
       }
-      last_key = std::move(next_pair.kv.first);
     }
+  }
+
+  return true;
+}
 
-    std::pair<TableIterator, TableIterator>& it{
-        iterators[next_pair.iterator_id]};
-    ++it.first;
+void DiskStorageManager::MoveTables(const CompactionTask& task,
+                                    const Options& options) {
+  VersionEdit edit;
 
-    pq.pop();
-    if (it.first != it.second) {
-      pq.emplace(*it.first, next_pair.iterator_id);
+  std::shared_lock level_read_lock{level_mutex_};
+  LevelT& level_list{levels_.at(task.level)};
+  for (const auto& table : level_list) {
+    if (std::find(task.tables.cbegin(), task.tables.cend(), table.number) !=
+        task.tables.cend()) {
+      edit.added_tables.push_back(ToMetadata(table, task.output_level));
     }
   }
+  level_read_lock.unlock();
 
-  if (output_io->NumKeys() > 0) {
-    output_io->Flush();
+  // A later compaction may remove the moved tables, which is only safe once
+  // the manifest has them in the output level.
+  LogEdit(std::move(edit), options, /*sync=*/true);
 
-    level_write_lock.lock();
-    levels_[level + 1].push_front(
-        options.table_factory->TableReaderFromWriter(*output_io, options));
-    level_write_lock.unlock();
+  std::unique_lock level_write_lock{level_mutex_};
+  LevelT& output_list{levels_[task.output_level]};
 
-    if (NeedsCompaction(level + 1, options)) {
-      BOOST_LOG_TRIVIAL(info)
-          << "Compaction on level " << level + 1 << " triggered.";
-      Compact(level + 1, options);
+  // The moved tables hold newer data than anything in the output level.
+  auto output_pos{output_list.begin()};
+  for (auto it = level_list.begin(); it != level_list.end();) {
+    auto next{std::next(it)};
+    if (std::find(task.tables.cbegin(), task.tables.cend(), it->number) !=
+        task.tables.cend()) {
+      output_list.splice(output_pos, level_list, it);
     }
+    it = next;
+  }
+}
 
-  } else {
-    options.env->RemoveFile(output_io->GetFileName());
+void DiskStorageManager::LogEdit(VersionEdit edit, const Options& options,
+                                 bool sync) {
+  std::scoped_lock manifest_lk{manifest_mutex_};
+
+  if (manifest_ == nullptr) {
+    manifest_ = std::make_unique<ManifestWriter>(options);
+  }
+
+  // Edits are logged one at a time, so the tables they add stop being
+  // pending in the same order.
+  std::unique_lock level_lk{level_mutex_};
+  for (const auto& table : edit.added_tables) {
+    pending_tables_.erase(table.number);
   }
+  edit.next_table = next_table_;
+  edit.last_sequence = std::max(edit.last_sequence, last_sequence_);
+  edit.log_number = std::max(edit.log_number, log_number_);
+  edit.pending_tables.assign(pending_tables_.cbegin(), pending_tables_.cend());
 
-  level_write_lock.lock();
-  for (auto it = level_list_start; it != level_list.end(); it++) {
-    options.env->RemoveFile((*it)->GetFileName());
+  last_sequence_ = edit.last_sequence;
+  log_number_ = edit.log_number;
+  level_lk.unlock();
+
+  manifest_->Add(edit, sync);
+}
+
+void DiskStorageManager::RemoveInputs(const CompactionTask& task,
+                                      const Options& options) {
+  LevelT& level_list{levels_.at(task.level)};
+
+  for (auto it = level_list.begin(); it != level_list.end();) {
+    if (std::find(task.tables.cbegin(), task.tables.cend(), it->number) !=
+        task.tables.cend()) {
+      table_cache_.Erase(it->number);
+      options.env->RemoveFile(util::TableFileName(options, it->number));
+      it = level_list.erase(it);
+    } else {
+      ++it;
+    }
   }
 
-  level_list.erase(level_list_start, level_list.end());
+  // Compactions may drop data, e.g. FIFO compaction, so cached values can't
+  // be trusted anymore.
+  if (options.row_cache != nullptr) {
+    options.row_cache->Clear();
+  }
 }
 
 }  // namespace mdb
@@ -1,23 +1,51 @@
 #pragma once
 
+#include <chrono>
 #include <future>
 #include <list>
 #include <map>
-#include <queue>
+#include <set>
 #include <shared_mutex>
 #include <string>
 
+#include "compaction_policy.h"
+#include "manifest.h"
+#include "memtable.h"
 #include "options.h"
+#include "pinnable_value.h"
+#include "snapshot_list.h"
+#include "table_cache.h"
 #include "table_reader.h"
+#include "thread_pool.h"
 #include "types.h"
 
 namespace mdb {
 
 class DiskStorageManager {
  public:
-  using LevelT = std::list<std::unique_ptr<TableReader>>;
+  // What is kept in memory about every table. The reader itself comes
+  // from the table cache, which may close it when it isn't in use.
+  struct Table {
+    size_t number;
 
-  DiskStorageManager() = default;
+    // See TableReader::SmallestKey() and LargestKey().
+    std::string smallest_key;
+    std::string largest_key;
+
+    size_t size;
+    RangeTombstoneList range_tombstones;
+
+    std::chrono::system_clock::time_point creation_time;
+
+    // See TableMetadata::recency.
+    size_t recency;
+  };
+
+  using LevelT = std::list<Table>;
+
+  // Compactions keep the versions that the snapshots in "snapshots" can
+  // see. Without it, only the newest version of each key is kept.
+  explicit DiskStorageManager(const SnapshotList* snapshots = nullptr);
 
   DiskStorageManager(const DiskStorageManager&) = delete;
   DiskStorageManager& operator=(const DiskStorageManager&) = delete;
@@ -28,35 +56,137 @@ class DiskStorageManager {
   ~DiskStorageManager();
 
   // Concurrent calls to ValueOf/WriteMemtable are safe.
-  std::string ValueOf(std::string_view key) const;
+  std::string ValueOf(std::string_view key,
+                      SequenceNumber snapshot = kMaxSequenceNumber) const;
+
+  // ValueOf() into "value". A value in a mapped table is pinned rather than
+  // copied.
+  void ValueOf(std::string_view key, SequenceNumber snapshot,
+               PinnableValue& value) const;
+
+  // ValueOf() for each of the sorted "keys" whose value is still nullopt.
+  // Every table is visited once, for all of the keys in its range. The
+  // block reads of each level go to Env::MultiRead() as one batch.
+  void MultiValueOf(const std::vector<std::string_view>& keys,
+                    SequenceNumber snapshot,
+                    std::vector<std::optional<std::string>>& values) const;
 
   // This method requires external synchronization. The implementation
-  // assumes that it is being called by only one thread.
-  void WriteMemtable(const Options& options, const MemTableT& memtable);
+  // assumes that it is being called by only one thread. Versions that no
+  // snapshot can see are not written. "log_number" is the first log that
+  // holds writes which aren't in "memtable", so older logs may be deleted
+  // once this returns. The table and its manifest edit are synced first.
+  void WriteMemtable(const Options& options, const MemTable& memtable,
+                     size_t log_number = 0);
+
+  // Same as above, with every entry at sequence number 0.
+  void WriteMemtable(const Options& options, const MemTableT& memtable,
+                     const RangeTombstoneList& range_tombstones = {});
 
   void WaitForOngoingCompactions();
 
-  // Load the specified tables into the the system. Assumes higher table
-  // numbers are more recent.
+  // All tables in the order that they are searched, from newest to oldest.
+  // Every table is opened. The readers stay usable after a compaction
+  // removes their table.
+  std::vector<std::shared_ptr<TableReader>> Tables() const;
+
+  // The number of tables in "level".
+  size_t NumTables(size_t level) const;
+
+  // The number of table readers that are currently cached.
+  size_t NumOpenTables() const;
+
+  // Load the tables recorded in the manifest. No table is opened unless
+  // Options::open_tables_on_recovery is set. Files of tables that were
+  // removed, or that were still being written when we crashed, are
+  // deleted. The manifest is then replaced by a checkpoint.
   //
   // This function is technically thread-safe, but it's not really intended to
   // be used concurrently with other operations. It's meant for loading the
   // tables during database construction in recovery mode.
-  void LoadIndices(std::priority_queue<size_t>& table_numbers,
-                   const Options& opt);
+  void LoadIndices(const Options& opt);
+
+  // The highest sequence number in any table, as recorded in the manifest.
+  SequenceNumber LastSequence() const;
+
+  // The first log that is still needed, as recorded in the manifest.
+  size_t LogNumber() const;
 
  private:
-  bool NeedsCompaction(size_t level, const Options& options) const;
-  void Compact(size_t level, const Options& options);
-  void TriggerCompaction(size_t level, const Options& options);
-  size_t TotalSize(size_t level) const;
+  std::vector<SequenceNumber> LiveSnapshots() const;
+
+  // Hand out a table number. The table is pending until an edit that adds
+  // it is logged, or until it is deleted.
+  size_t NewTableNumber();
+
+  // Describe a table that was just written or loaded, and hand its reader
+  // to the table cache.
+  Table MakeTable(size_t table_number, std::shared_ptr<TableReader> reader,
+                  std::chrono::system_clock::time_point creation_time,
+                  size_t recency, const Options& options);
+
+  // Requires a lock on level_mutex_.
+  std::shared_ptr<TableReader> GetReader(const Table& table) const;
+
+  // The first version of "key" that the readers hold, in order. They are
+  // probed at the same time on probe_pool_, except for the first one,
+  // which is probed by the calling thread. Probes of tables older than one
+  // known to have the key are skipped.
+  std::optional<std::string> ProbeInParallel(
+      const std::vector<std::shared_ptr<TableReader>>& readers,
+      std::string_view key, SequenceNumber snapshot) const;
+
+  // Fill the table cache in parallel with the tables that are searched
+  // first.
+  void OpenTables(const Options& options);
+
+  LevelSummary Summarize() const;
+  bool NeedsCompaction(const Options& options) const;
+  void Compact(const CompactionTask& task, const Options& options);
+  void DropTables(const CompactionTask& task, const Options& options);
+
+  // Find tables in a single level whose whole key range is deleted by a
+  // range tombstone in a newer table. They can be dropped without being
+  // read.
+  std::optional<CompactionTask> PickCoveredTables() const;
+
+  // A task is a trivial move if its inputs can be relinked into the output
+  // level without being rewritten: they must not overlap each other or any
+  // table already in the output level.
+  bool IsTrivialMove(const CompactionTask& task) const;
+  void MoveTables(const CompactionTask& task, const Options& options);
+
+  void LogEdit(VersionEdit edit, const Options& options, bool sync = false);
+
+  // Delete the input tables of a finished task. The caller must hold an
+  // exclusive lock on level_mutex_.
+  void RemoveInputs(const CompactionTask& task, const Options& options);
+  void TriggerCompaction(const Options& options);
+
+  const SnapshotList* snapshots_;
 
   size_t next_table_{0};
+  SequenceNumber last_sequence_{0};
+  size_t log_number_{0};
+  std::set<size_t> pending_tables_;
 
   std::map<size_t, LevelT> levels_;
 
+  // The options of the last call that added tables. Tables are reopened
+  // with them by calls that don't take options. Guarded by level_mutex_.
+  Options options_;
+
+  mutable TableCache table_cache_;
+
+  // Started by the first read that probes tables in parallel.
+  mutable std::once_flag probe_pool_flag_;
+  mutable std::unique_ptr<ThreadPool> probe_pool_;
+
   mutable std::shared_mutex level_mutex_;
 
+  std::mutex manifest_mutex_;
+  std::unique_ptr<ManifestWriter> manifest_;
+
   std::mutex compaction_mutex_;
   std::condition_variable compaction_cv_;
   bool ongoing_compaction_{false};
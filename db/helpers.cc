@@ -1,56 +1,95 @@
 #include "helpers.h"
 
-#include <cassert>
+#include <algorithm>
 #include <filesystem>
-#include <regex>
 
 #include "options.h"
 
 namespace mdb {
 namespace util {
 
-void AddStringToWritable(std::string_view str, std::vector<char>& writable) {
-  size_t str_size{str.size()};
-  char* size_bytes{reinterpret_cast<char*>(&str_size)};
-
+void AddSizeToWritable(size_t size, std::vector<char>& writable) {
+  char* size_bytes{reinterpret_cast<char*>(&size)};
   writable.insert(writable.end(), size_bytes, size_bytes + sizeof(size_t));
+}
 
+void AddStringToWritable(std::string_view str, std::vector<char>& writable) {
+  AddSizeToWritable(str.size(), writable);
   writable.insert(writable.end(), str.begin(), str.end());
 }
 
-std::string LogFileName(const Options& options, size_t number) {
-  return options.path / ("log" + std::to_string(number) + ".dat");
+void AddRangeTombstoneToWritable(const RangeTombstone& tombstone,
+                                 std::vector<char>& writable) {
+  AddStringToWritable(tombstone.begin, writable);
+  AddStringToWritable(tombstone.end, writable);
+  AddSizeToWritable(tombstone.seq, writable);
 }
 
-std::string TableFileName(const Options& options, size_t number) {
-  return options.path / ("table" + std::to_string(number) + ".mdb");
-}
+std::optional<RangeTombstoneList> ParseRangeTombstones(std::string_view data) {
+  RangeTombstoneList tombstones;
+
+  auto read_size{[&data]() -> std::optional<size_t> {
+    size_t size;
+    if (data.size() < sizeof(size_t)) {
+      return std::nullopt;
+    }
+    std::copy_n(data.data(), sizeof(size_t), reinterpret_cast<char*>(&size));
+    data.remove_prefix(sizeof(size_t));
+    return size;
+  }};
+
+  auto read_string{[&data, &read_size]() -> std::optional<std::string> {
+    auto size{read_size()};
+    if (!size || data.size() < *size) {
+      return std::nullopt;
+    }
+    std::string str{data.substr(0, *size)};
+    data.remove_prefix(*size);
+    return str;
+  }};
 
-FileInfo GetFileInfo(const std::filesystem::directory_entry& entry) {
-  if (!std::filesystem::is_regular_file(entry)) {
-    return {.id = FileType::Unknown, .index = 0, .path = entry.path()};
+  while (!data.empty()) {
+    auto begin{read_string()};
+    auto end{read_string()};
+    auto seq{read_size()};
+    if (!begin || !end || !seq || *begin >= *end) {
+      return std::nullopt;
+    }
+    tombstones.push_back({std::move(*begin), std::move(*end), *seq});
   }
 
-  std::string fname{entry.path().filename()};
+  return tombstones;
+}
 
-  const std::regex log_regex{"log([0-9]+)\\.dat"};
-  const std::regex table_regex{"table([0-9]+)\\.mdb"};
-  std::smatch base_match;
+bool IsCovered(std::string_view key, const RangeTombstoneList& tombstones,
+               SequenceNumber snapshot) {
+  return std::any_of(tombstones.cbegin(), tombstones.cend(),
+                     [key, snapshot](const RangeTombstone& tombstone) {
+                       return tombstone.seq <= snapshot &&
+                              tombstone.Covers(key);
+                     });
+}
 
-  auto id{FileType::Unknown};
-  size_t index{0};
+bool IsCovered(std::string_view key, SequenceNumber seq,
+               const RangeTombstoneList& tombstones, SequenceNumber snapshot) {
+  return std::any_of(tombstones.cbegin(), tombstones.cend(),
+                     [key, seq, snapshot](const RangeTombstone& tombstone) {
+                       return seq < tombstone.seq &&
+                              tombstone.seq <= snapshot &&
+                              tombstone.Covers(key);
+                     });
+}
 
-  if (std::regex_match(fname, base_match, log_regex)) {
-    assert(base_match.size() == 2);
-    id = FileType::LogFile;
-    index = std::stoi(base_match[1].str());
-  } else if (std::regex_match(fname, base_match, table_regex)) {
-    assert(base_match.size() == 2);
-    id = FileType::TableFile;
-    index = std::stoi(base_match[1].str());
-  }
+std::string LogFileName(const Options& options, size_t number) {
+  return options.path / ("log" + std::to_string(number) + ".dat");
+}
+
+std::string TableFileName(const Options& options, size_t number) {
+  return options.path / ("table" + std::to_string(number) + ".mdb");
+}
 
-  return {.id = id, .index = index, .path = entry.path()};
+std::string ManifestFileName(const Options& options) {
+  return options.path / "manifest.dat";
 }
 
 }  // namespace util
@@ -1,34 +1,52 @@
 #pragma once
 
-#include <filesystem>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "types.h"
+
 namespace mdb {
 
 struct Options;
 
 namespace util {
 
+// Append the raw bytes of "size" to the buffer in "writable".
+void AddSizeToWritable(size_t size, std::vector<char>& writable);
+
 // Given a string "str", append the following sequence of bytes to
 // the buffer in "writable": str.size() + str.data() [no null terminator!]
 void AddStringToWritable(std::string_view str, std::vector<char>& writable);
 
+// Append "tombstone.begin" and "tombstone.end" to the buffer in "writable",
+// in the same format as AddStringToWritable, followed by "tombstone.seq".
+void AddRangeTombstoneToWritable(const RangeTombstone& tombstone,
+                                 std::vector<char>& writable);
+
+// Parse a sequence of tombstones written by AddRangeTombstoneToWritable.
+// Returns nullopt if "data" is malformed or holds an empty range.
+std::optional<RangeTombstoneList> ParseRangeTombstones(std::string_view data);
+
+// True if any of the tombstones visible at "snapshot" deletes "key". Use
+// this for tombstones from a newer source than the key, or when the source
+// of the tombstones has no version of the key.
+bool IsCovered(std::string_view key, const RangeTombstoneList& tombstones,
+               SequenceNumber snapshot);
+
+// Like above, but for the version of "key" numbered "seq" from the same
+// source as the tombstones. Only newer tombstones delete it.
+bool IsCovered(std::string_view key, SequenceNumber seq,
+               const RangeTombstoneList& tombstones, SequenceNumber snapshot);
+
 // Produce the n-th logfile name, "/path/in/options/logn.dat"
 std::string LogFileName(const Options& options, size_t number);
 
 // Produce the n-th table file name, "/path/in/options/tablen.mdb"
 std::string TableFileName(const Options& options, size_t number);
 
-enum class FileType { LogFile, TableFile, Unknown };
-
-struct FileInfo {
-  FileType id;
-  size_t index;
-  std::filesystem::path path;
-};
-
-FileInfo GetFileInfo(const std::filesystem::directory_entry& entry);
+// Produce the manifest file name, "/path/in/options/manifest.dat"
+std::string ManifestFileName(const Options& options);
 
 }  // namespace util
 }  // namespace mdb
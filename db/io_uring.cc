@@ -0,0 +1,650 @@
+#include "env.h"
+
+#if __has_include(<linux/io_uring.h>)
+#define MDB_HAS_IO_URING
+#endif
+
+#ifdef MDB_HAS_IO_URING
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#endif
+
+namespace mdb {
+
+#ifdef MDB_HAS_IO_URING
+
+namespace {
+
+void ThrowIfError(int ret) {
+  if (ret == -1) {
+    throw std::system_error(errno, std::generic_category());
+  }
+}
+
+// io_uring results are -errno on failure.
+void ThrowIfFailed(int result) {
+  if (result < 0) {
+    throw std::system_error(-result, std::generic_category());
+  }
+}
+
+// The length of a read or write is 32 bits. Bigger requests are split.
+constexpr size_t kMaxIOSize{size_t{1} << 30};
+
+io_uring_sqe ReadEntry(int fd, char* output, size_t size, size_t offset) {
+  io_uring_sqe sqe{};
+  sqe.opcode = IORING_OP_READ;
+  sqe.fd = fd;
+  sqe.addr = reinterpret_cast<uint64_t>(output);
+  sqe.len = std::min(size, kMaxIOSize);
+  sqe.off = offset;
+  return sqe;
+}
+
+// Writes at the current position, which is the end of files opened with
+// O_APPEND.
+io_uring_sqe WriteEntry(int fd, const char* data, size_t size) {
+  io_uring_sqe sqe{};
+  sqe.opcode = IORING_OP_WRITE;
+  sqe.fd = fd;
+  sqe.addr = reinterpret_cast<uint64_t>(data);
+  sqe.len = std::min(size, kMaxIOSize);
+  sqe.off = static_cast<uint64_t>(-1);
+  return sqe;
+}
+
+// Like fdatasync().
+io_uring_sqe FsyncEntry(int fd) {
+  io_uring_sqe sqe{};
+  sqe.opcode = IORING_OP_FSYNC;
+  sqe.fd = fd;
+  sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+  return sqe;
+}
+
+// A submission and a completion queue shared with the kernel. Not
+// thread-safe; IoUringPool hands each thread a ring of its own.
+class IoUring {
+ public:
+  static constexpr unsigned kEntries{64};
+
+  // nullptr if the kernel lacks io_uring or the features used here.
+  static std::unique_ptr<IoUring> Create() {
+    io_uring_params params{};
+    int fd{static_cast<int>(
+        ::syscall(__NR_io_uring_setup, kEntries, &params))};
+    if (fd < 0) {
+      return nullptr;
+    }
+
+    std::unique_ptr<IoUring> ring{new IoUring(fd)};
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+        !(params.features & IORING_FEAT_RW_CUR_POS)) {
+      return nullptr;
+    }
+
+    // Both rings live in a single mapping.
+    size_t sq_size{params.sq_off.array + params.sq_entries * sizeof(unsigned)};
+    size_t cq_size{params.cq_off.cqes +
+                   params.cq_entries * sizeof(io_uring_cqe)};
+    ring->rings_size_ = std::max(sq_size, cq_size);
+    void* rings{::mmap(nullptr, ring->rings_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING)};
+    if (rings == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->rings_ = static_cast<char*>(rings);
+
+    ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes{::mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES)};
+    if (sqes == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* base{ring->rings_};
+    ring->sq_entries_ = params.sq_entries;
+    ring->sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    ring->sq_mask_ =
+        *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    ring->sq_array_ = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    ring->cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    ring->cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    ring->cq_mask_ =
+        *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    ring->cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    return ring;
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  IoUring(IoUring&&) = delete;
+  IoUring& operator=(IoUring&&) = delete;
+
+  ~IoUring() {
+    if (sqes_ != nullptr) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (rings_ != nullptr) {
+      ::munmap(rings_, rings_size_);
+    }
+    ::close(fd_);
+  }
+
+  // Submit all entries with a single syscall and wait for them to
+  // complete. Returns the result of each entry, in order. At most
+  // kEntries entries fit in one call.
+  std::vector<int> Run(const std::vector<io_uring_sqe>& sqes) {
+    assert(sqes.size() <= sq_entries_);
+
+    // We are the only producer, so the tail can't move under us.
+    unsigned tail{*sq_tail_};
+    for (size_t i = 0; i < sqes.size(); ++i) {
+      unsigned index{(tail + static_cast<unsigned>(i)) & sq_mask_};
+      sqes_[index] = sqes[i];
+      sqes_[index].user_data = i;
+      sq_array_[index] = index;
+    }
+    __atomic_store_n(sq_tail_, tail + static_cast<unsigned>(sqes.size()),
+                     __ATOMIC_RELEASE);
+
+    std::vector<int> results(sqes.size());
+    size_t to_submit{sqes.size()};
+    size_t completed{0};
+
+    while (completed < sqes.size()) {
+      auto submitted{::syscall(__NR_io_uring_enter, fd_, to_submit,
+                               sqes.size() - completed,
+                               IORING_ENTER_GETEVENTS, nullptr, 0)};
+      if (submitted < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category());
+      }
+      to_submit -= submitted;
+
+      unsigned head{*cq_head_};
+      unsigned cq_tail{__atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)};
+      for (; head != cq_tail; ++head) {
+        const auto& cqe{cqes_[head & cq_mask_]};
+        results[cqe.user_data] = cqe.res;
+        ++completed;
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    return results;
+  }
+
+ private:
+  explicit IoUring(int fd) : fd_{fd} {}
+
+  const int fd_;
+
+  char* rings_{nullptr};
+  size_t rings_size_{0};
+  io_uring_sqe* sqes_{nullptr};
+  size_t sqes_size_{0};
+
+  unsigned sq_entries_{0};
+  unsigned* sq_tail_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned* sq_array_{nullptr};
+
+  unsigned* cq_head_{nullptr};
+  unsigned* cq_tail_{nullptr};
+  unsigned cq_mask_{0};
+  io_uring_cqe* cqes_{nullptr};
+};
+
+// Rings are created on demand, one per concurrent caller, so that threads
+// don't wait on each other's IO. A few idle rings are kept around.
+class IoUringPool {
+ public:
+  std::vector<int> Run(const std::vector<io_uring_sqe>& sqes) {
+    std::unique_ptr<IoUring> ring;
+    {
+      std::lock_guard lock{mutex_};
+      if (!free_.empty()) {
+        ring = std::move(free_.back());
+        free_.pop_back();
+      }
+    }
+
+    if (ring == nullptr) {
+      ring = IoUring::Create();
+      if (ring == nullptr) {
+        return RunBlocking(sqes);
+      }
+    }
+
+    // A ring that failed is dropped, since it may still hold entries.
+    auto results{ring->Run(sqes)};
+
+    std::lock_guard lock{mutex_};
+    if (free_.size() < kMaxFreeRings) {
+      free_.push_back(std::move(ring));
+    }
+    return results;
+  }
+
+ private:
+  static constexpr size_t kMaxFreeRings{4};
+
+  // Used when no new ring can be set up (e.g. the locked memory limit is
+  // reached). Does the same work with plain syscalls.
+  static std::vector<int> RunBlocking(const std::vector<io_uring_sqe>& sqes) {
+    std::vector<int> results(sqes.size());
+    bool link_failed{false};
+
+    for (size_t i = 0; i < sqes.size(); ++i) {
+      const auto& sqe{sqes[i]};
+      auto* addr{reinterpret_cast<char*>(sqe.addr)};
+
+      if (link_failed) {
+        results[i] = -ECANCELED;
+      } else {
+        ssize_t ret{0};
+        switch (sqe.opcode) {
+          case IORING_OP_READ:
+            ret = ::pread(sqe.fd, addr, sqe.len, sqe.off);
+            break;
+          case IORING_OP_WRITE:
+            ret = ::write(sqe.fd, addr, sqe.len);
+            break;
+          case IORING_OP_WRITEV:
+            ret = ::writev(sqe.fd, reinterpret_cast<iovec*>(addr), sqe.len);
+            break;
+          case IORING_OP_FSYNC:
+            ret = (sqe.fsync_flags & IORING_FSYNC_DATASYNC)
+                      ? ::fdatasync(sqe.fd)
+                      : ::fsync(sqe.fd);
+            break;
+          default:
+            assert(false);
+        }
+        results[i] = ret < 0 ? -errno : static_cast<int>(ret);
+      }
+
+      bool short_io{(sqe.opcode == IORING_OP_READ ||
+                     sqe.opcode == IORING_OP_WRITE) &&
+                    results[i] != static_cast<int>(sqe.len)};
+      bool failed{results[i] < 0 || short_io};
+      link_failed = (sqe.flags & IOSQE_IO_LINK) && failed;
+    }
+
+    return results;
+  }
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<IoUring>> free_;
+};
+
+// Perform (fd, request) reads, up to a ring's worth per submission. Short
+// reads are resubmitted for the rest until the end of the file.
+void SubmitReads(IoUringPool& pool,
+                 std::vector<std::pair<int, ReadRequest*>> pending) {
+  for (auto& read : pending) {
+    read.second->bytes_read = 0;
+  }
+
+  std::vector<io_uring_sqe> sqes;
+  while (!pending.empty()) {
+    size_t batch_size{std::min<size_t>(pending.size(), IoUring::kEntries)};
+
+    sqes.clear();
+    for (size_t i = 0; i < batch_size; ++i) {
+      auto [fd, request]{pending[i]};
+      sqes.push_back(ReadEntry(fd, request->output + request->bytes_read,
+                               request->size - request->bytes_read,
+                               request->offset + request->bytes_read));
+    }
+
+    auto results{pool.Run(sqes)};
+
+    std::vector<std::pair<int, ReadRequest*>> unfinished;
+    for (size_t i = 0; i < batch_size; ++i) {
+      ThrowIfFailed(results[i]);
+      auto* request{pending[i].second};
+      request->bytes_read += results[i];
+      if (results[i] > 0 && request->bytes_read < request->size) {
+        unfinished.push_back(pending[i]);
+      }
+    }
+    unfinished.insert(unfinished.end(), pending.begin() + batch_size,
+                      pending.end());
+    pending = std::move(unfinished);
+  }
+}
+
+// Without "append", writes start at the beginning of the file and overwrite
+// what is there.
+class IoUringWriteOnlyFile : public WriteOnlyIO {
+ public:
+  IoUringWriteOnlyFile(std::string filename,
+                       std::shared_ptr<IoUringPool> pool, bool append = true)
+      : fd_{::open(filename.c_str(),
+                   (append ? O_APPEND : 0) | O_WRONLY | O_CREAT, 0644)},
+        filename_{std::move(filename)},
+        pool_{std::move(pool)} {
+    ThrowIfError(fd_);
+  }
+
+  IoUringWriteOnlyFile(const IoUringWriteOnlyFile&) = delete;
+  IoUringWriteOnlyFile& operator=(const IoUringWriteOnlyFile&) = delete;
+
+  IoUringWriteOnlyFile(IoUringWriteOnlyFile&&) = delete;
+  IoUringWriteOnlyFile& operator=(IoUringWriteOnlyFile&&) = delete;
+
+  ~IoUringWriteOnlyFile() override {
+    if (!closed_) {
+      // Ignore errors
+      ::close(fd_);
+    }
+  }
+
+  void Write(const char* data, size_t size) override {
+    while (size > 0) {
+      auto written{pool_->Run({WriteEntry(fd_, data, size)})[0]};
+      ThrowIfFailed(written);
+      data += written;
+      size -= written;
+    }
+  }
+
+  void WriteV(const std::string_view* parts, size_t num_parts) override {
+    std::vector<iovec> iov;
+    iov.reserve(num_parts);
+    for (size_t i = 0; i < num_parts; ++i) {
+      if (!parts[i].empty()) {
+        iov.push_back({const_cast<char*>(parts[i].data()), parts[i].size()});
+      }
+    }
+
+    for (size_t first = 0; first < iov.size();) {
+      io_uring_sqe sqe{};
+      sqe.opcode = IORING_OP_WRITEV;
+      sqe.fd = fd_;
+      sqe.addr = reinterpret_cast<uint64_t>(iov.data() + first);
+      sqe.len = std::min<size_t>(iov.size() - first, IOV_MAX);
+      sqe.off = static_cast<uint64_t>(-1);
+
+      auto written{pool_->Run({sqe})[0]};
+      ThrowIfFailed(written);
+
+      // Skip what was written.
+      for (size_t n = written; n > 0;) {
+        if (n >= iov[first].iov_len) {
+          n -= iov[first].iov_len;
+          ++first;
+        } else {
+          iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + n;
+          iov[first].iov_len -= n;
+          n = 0;
+        }
+      }
+    }
+  }
+
+  // The write and the fsync are linked, so both go to the kernel in one
+  // syscall and the fsync only runs if the write completed.
+  void WriteAndSync(const char* data, size_t size) override {
+    auto write{WriteEntry(fd_, data, size)};
+    write.flags |= IOSQE_IO_LINK;
+
+    auto results{pool_->Run({write, FsyncEntry(fd_)})};
+    ThrowIfFailed(results[0]);
+
+    // A short write cancels the fsync. Finish the job one step at a time.
+    if (static_cast<size_t>(results[0]) < size) {
+      Write(data + results[0], size - results[0]);
+      Sync();
+      return;
+    }
+    ThrowIfFailed(results[1]);
+  }
+
+  void Sync() override { ThrowIfFailed(pool_->Run({FsyncEntry(fd_)})[0]); }
+
+  // File systems that can't preallocate are left alone.
+  void Allocate(size_t size) override {
+    if (size > 0 && ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, size) == -1 &&
+        errno != EOPNOTSUPP && errno != ENOSYS) {
+      throw std::system_error(errno, std::generic_category());
+    }
+  }
+
+  void RangeSync(size_t offset, size_t size) override {
+    ThrowIfError(::sync_file_range(fd_, offset, size,
+                                   SYNC_FILE_RANGE_WAIT_BEFORE |
+                                       SYNC_FILE_RANGE_WRITE |
+                                       SYNC_FILE_RANGE_WAIT_AFTER));
+  }
+
+  void Close() override {
+    if (!closed_) {
+      closed_ = true;
+      ThrowIfError(::close(fd_));
+    }
+  }
+
+  std::string GetFileName() const noexcept override { return filename_; }
+
+  int GetID() const noexcept override { return fd_; }
+
+ private:
+  const int fd_;
+  bool closed_{false};
+
+  std::string filename_;
+  std::shared_ptr<IoUringPool> pool_;
+};
+
+class IoUringReadOnlyFile : public ReadOnlyIO {
+ public:
+  IoUringReadOnlyFile(std::string filename, std::shared_ptr<IoUringPool> pool)
+      : fd_{::open(filename.c_str(), O_RDONLY)},
+        filename_{std::move(filename)},
+        pool_{std::move(pool)} {
+    ThrowIfError(fd_);
+
+    // Read-only files don't change while they are open, so the size is
+    // looked up once.
+    struct stat s;
+    if (::fstat(fd_, &s) == -1) {
+      int err{errno};
+      ::close(fd_);
+      throw std::system_error(err, std::generic_category());
+    }
+    size_ = s.st_size;
+  }
+
+  IoUringReadOnlyFile(const IoUringReadOnlyFile&) = delete;
+  IoUringReadOnlyFile& operator=(const IoUringReadOnlyFile&) = delete;
+
+  IoUringReadOnlyFile(IoUringReadOnlyFile&&) = delete;
+  IoUringReadOnlyFile& operator=(IoUringReadOnlyFile&&) = delete;
+
+  ~IoUringReadOnlyFile() override {
+    if (!closed_) {
+      ::close(fd_);
+    }
+  }
+
+  size_t Read(char* output, size_t size, size_t offset) override {
+    if (closed_) {
+      return 0;
+    }
+
+    size_t total{0};
+    while (total < size) {
+      auto bytes_read{pool_->Run(
+          {ReadEntry(fd_, output + total, size - total, offset + total)})[0]};
+      ThrowIfFailed(bytes_read);
+      if (bytes_read == 0) {
+        break;
+      }
+      total += bytes_read;
+    }
+    return total;
+  }
+
+  size_t ReadNoExcept(char* output, size_t size,
+                      size_t offset) noexcept override {
+    try {
+      return Read(output, size, offset);
+    } catch (const std::system_error&) {
+      return 0;
+    }
+  }
+
+  void MultiRead(ReadRequest* requests, size_t num_requests) override {
+    std::vector<std::pair<int, ReadRequest*>> reads;
+    for (size_t i = 0; i < num_requests; ++i) {
+      requests[i].bytes_read = 0;
+      if (!closed_) {
+        reads.emplace_back(fd_, &requests[i]);
+      }
+    }
+    SubmitReads(*pool_, std::move(reads));
+  }
+
+  void Close() override {
+    if (!closed_) {
+      closed_ = true;
+      ThrowIfError(::close(fd_));
+    }
+  }
+
+  std::string GetFileName() const noexcept override { return filename_; }
+
+  int GetID() const noexcept override { return closed_ ? -1 : fd_; }
+
+  size_t Size() const override { return size_; }
+
+ private:
+  const int fd_;
+  size_t size_;
+  bool closed_{false};
+
+  std::string filename_;
+  std::shared_ptr<IoUringPool> pool_;
+};
+
+// Reads and writes of regular files go through io_uring. Everything else,
+// including mmap and direct IO files, is left to the POSIX env.
+class IoUringEnv : public Env {
+ public:
+  explicit IoUringEnv(std::shared_ptr<Env> base) : base_{std::move(base)} {}
+
+  std::unique_ptr<WriteOnlyIO> MakeWriteOnlyIO(
+      std::string filename) const override {
+    return std::make_unique<IoUringWriteOnlyFile>(std::move(filename), pool_);
+  }
+
+  std::unique_ptr<ReadOnlyIO> MakeReadOnlyIO(
+      std::string filename) const override {
+    return std::make_unique<IoUringReadOnlyFile>(std::move(filename), pool_);
+  }
+
+  std::unique_ptr<ReadOnlyIO> MakeMmapReadOnlyIO(
+      std::string filename) const override {
+    return base_->MakeMmapReadOnlyIO(std::move(filename));
+  }
+
+  std::unique_ptr<WriteOnlyIO> MakeDirectWriteOnlyIO(
+      std::string filename) const override {
+    return base_->MakeDirectWriteOnlyIO(std::move(filename));
+  }
+
+  std::unique_ptr<ReadOnlyIO> MakeDirectReadOnlyIO(
+      std::string filename) const override {
+    return base_->MakeDirectReadOnlyIO(std::move(filename));
+  }
+
+  // Reads of our own files are submitted together. Others are left to
+  // their file.
+  void MultiRead(std::vector<ReadRequest>& requests) const override {
+    std::vector<std::pair<int, ReadRequest*>> reads;
+    for (auto& request : requests) {
+      auto* file{dynamic_cast<IoUringReadOnlyFile*>(request.file)};
+      if (file != nullptr && file->GetID() != -1) {
+        reads.emplace_back(file->GetID(), &request);
+      } else {
+        request.file->MultiRead(&request, 1);
+      }
+    }
+    SubmitReads(*pool_, std::move(reads));
+  }
+
+  std::unique_ptr<WriteOnlyIO> ReuseWriteOnlyIO(
+      const std::string& old_filename, std::string filename) override {
+    base_->RenameFile(old_filename, filename);
+    return std::make_unique<IoUringWriteOnlyFile>(std::move(filename), pool_,
+                                                  /*append=*/false);
+  }
+
+  void RemoveFile(const std::string& file) override { base_->RemoveFile(file); }
+
+  void RenameFile(const std::string& from, const std::string& to) override {
+    base_->RenameFile(from, to);
+  }
+
+  void SyncDir(const std::string& dirname) override {
+    base_->SyncDir(dirname);
+  }
+
+  bool FileExists(const std::string& file) const override {
+    return base_->FileExists(file);
+  }
+
+  std::chrono::system_clock::time_point ModificationTime(
+      const std::string& file) const override {
+    return base_->ModificationTime(file);
+  }
+
+ private:
+  std::shared_ptr<Env> base_;
+
+  // Shared with the files, which may outlive the env.
+  std::shared_ptr<IoUringPool> pool_{std::make_shared<IoUringPool>()};
+};
+
+}  // namespace
+
+std::shared_ptr<Env> Env::CreateIoUring() {
+  // Make sure a ring can actually be set up here. It may be disabled by
+  // the kernel or a seccomp filter.
+  if (IoUring::Create() == nullptr) {
+    return CreateDefault();
+  }
+  return std::make_shared<IoUringEnv>(CreateDefault());
+}
+
+#else
+
+std::shared_ptr<Env> Env::CreateIoUring() { return CreateDefault(); }
+
+#endif
+
+}  // namespace mdb
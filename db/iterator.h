@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include "types.h"
@@ -24,10 +25,21 @@ class TableIteratorImpl {
   virtual ~TableIteratorImpl() = default;
 
   virtual ValueType& GetValue() = 0;
+
+  // The sequence number of the current entry.
+  virtual SequenceNumber Sequence() const noexcept = 0;
+
   virtual bool IsDone() = 0;
   virtual void Next() = 0;
   virtual size_t Position() const noexcept = 0;
 
+  // Move to the first entry whose key is >= "key", or to the end if there
+  // is none.
+  virtual void Seek(std::string_view key) = 0;
+
+  // Move to the last entry, or to the end if the table is empty.
+  virtual void SeekToLast() = 0;
+
   virtual bool operator==(const TableIteratorImpl& other) = 0;
 
   virtual std::shared_ptr<TableIteratorImpl> Clone() = 0;
@@ -85,6 +97,12 @@ class TableIterator {
 
   pointer operator->() const { return &impl_->GetValue(); }
 
+  SequenceNumber Sequence() const noexcept { return impl_->Sequence(); }
+
+  void Seek(std::string_view key) { impl_->Seek(key); }
+
+  void SeekToLast() { impl_->SeekToLast(); }
+
  private:
   std::shared_ptr<TableIteratorImpl> impl_;
 };
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace mdb {
+
+// A log is a sequence of blocks of kLogBlockSize bytes. Records are split
+// into fragments that never cross a block boundary, so a reader can always
+// find the next fragment at the start of a block. Every fragment starts
+// with a header:
+//
+//   checksum (4 bytes) | payload length (2 bytes) | type (1 byte) |
+//   log number (4 bytes)
+//
+// The checksum is a CRC-32 of the type, the log number and the payload. A
+// block with less room than a header left is padded with zeroes. The last
+// block of a log is not padded.
+//
+// Log files may be reused, in which case the new log overwrites the old one
+// from the start. The log number tells what is left of the old log apart
+// from the new records; only the low 32 bits of it are stored.
+//
+// The payload of a record is its sequence number, key size, key, value
+// size and value. A range tombstone is a record with an empty key.
+constexpr size_t kLogBlockSize{32 * 1024};
+constexpr size_t kLogHeaderSize{11};
+
+enum class LogRecordType : uint8_t {
+  // Never written, so zeroed space doesn't parse as a fragment.
+  kZero = 0,
+
+  // A whole record.
+  kFull = 1,
+
+  // The pieces of a record that spans blocks.
+  kFirst = 2,
+  kMiddle = 3,
+  kLast = 4,
+};
+
+using LogHeader = std::array<char, kLogHeaderSize>;
+
+inline LogHeader EncodeLogHeader(uint32_t checksum, uint16_t length,
+                                 LogRecordType type, uint32_t log_number) {
+  LogHeader header;
+  std::memcpy(header.data(), &checksum, sizeof(checksum));
+  std::memcpy(header.data() + 4, &length, sizeof(length));
+  header[6] = static_cast<char>(type);
+  std::memcpy(header.data() + 7, &log_number, sizeof(log_number));
+  return header;
+}
+
+struct DecodedLogHeader {
+  uint32_t checksum;
+  uint16_t length;
+  LogRecordType type;
+  uint32_t log_number;
+};
+
+// "data" must hold at least kLogHeaderSize bytes.
+inline DecodedLogHeader DecodeLogHeader(const char* data) {
+  DecodedLogHeader header;
+  std::memcpy(&header.checksum, data, sizeof(header.checksum));
+  std::memcpy(&header.length, data + 4, sizeof(header.length));
+  header.type = static_cast<LogRecordType>(data[6]);
+  std::memcpy(&header.log_number, data + 7, sizeof(header.log_number));
+  return header;
+}
+
+}  // namespace mdb
@@ -1,5 +1,7 @@
 #include "log_reader.h"
 
+#include <algorithm>
+#include <boost/crc.hpp>
 #include <cassert>
 #include <vector>
 
@@ -7,69 +9,248 @@
 
 namespace mdb {
 
+namespace {
+
+// The length of the prefix of "block" that is made of intact fragments of
+// the log. This is "size" if the whole block can be replayed.
+size_t VerifyBlock(const char* block, size_t size, uint32_t log_number) {
+  size_t pos{0};
+  while (size - pos >= kLogHeaderSize) {
+    auto header{DecodeLogHeader(block + pos)};
+    if (header.type == LogRecordType::kZero ||
+        header.type > LogRecordType::kLast ||
+        header.length > size - pos - kLogHeaderSize ||
+        header.log_number != log_number) {
+      return pos;
+    }
+
+    boost::crc_32_type crc;
+    crc.process_byte(static_cast<unsigned char>(header.type));
+    crc.process_bytes(&header.log_number, sizeof(header.log_number));
+    crc.process_bytes(block + pos + kLogHeaderSize, header.length);
+    if (crc.checksum() != header.checksum) {
+      return pos;
+    }
+
+    pos += kLogHeaderSize + header.length;
+  }
+
+  // A full block ends with padding. Anything else is a torn header.
+  return size == kLogBlockSize ? size : pos;
+}
+
+}  // namespace
+
 LogReader::LogReader(size_t log_number, const Options& options)
     : LogReader(
-          options.env->MakeReadOnlyIO(util::LogFileName(options, log_number))) {
-}
+          options.env->MakeReadOnlyIO(util::LogFileName(options, log_number)),
+          log_number, options.log_recovery_threads) {}
 
-LogReader::LogReader(std::unique_ptr<ReadOnlyIO>&& file)
-    : file_{std::move(file)} {
+LogReader::LogReader(std::unique_ptr<ReadOnlyIO>&& file, size_t log_number,
+                     size_t num_threads)
+    : file_{std::move(file)},
+      log_number_{static_cast<uint32_t>(log_number)},
+      chunk_(kChunkSize) {
   assert(file_ != nullptr);
+  if (num_threads > 1) {
+    pool_ = std::make_unique<ThreadPool>(num_threads);
+  }
 }
 
-std::optional<std::string> LogReader::ReadNextString() {
-  assert(file_ != nullptr);
+bool LogReader::ReadChunk() {
+  if (stopped_) {
+    return false;
+  }
 
-  std::vector<char> buf;
-  buf.reserve(sizeof(size_t));
+  // A failed read is not the end of the log. The caller would drop what is
+  // left of it.
+  auto size{file_->Read(chunk_.data(), kChunkSize, file_pos_)};
+  file_pos_ += size;
+  chunk_pos_ = 0;
+  chunk_end_ = size;
 
-  if (file_->ReadNoExcept(buf.data(), sizeof(size_t), pos_) != sizeof(size_t)) {
-    return std::nullopt;
+  auto num_blocks{(size + kLogBlockSize - 1) / kLogBlockSize};
+  auto block_size{[size](size_t block) {
+    return std::min(kLogBlockSize, size - block * kLogBlockSize);
+  }};
+  auto verify{[this, &block_size](size_t block) {
+    return VerifyBlock(chunk_.data() + block * kLogBlockSize,
+                       block_size(block), log_number_);
+  }};
+
+  std::vector<size_t> valid(num_blocks);
+  if (pool_ != nullptr && num_blocks > 1) {
+    std::vector<std::future<size_t>> results;
+    for (size_t block = 0; block < num_blocks; block++) {
+      results.push_back(
+          pool_->Submit([&verify, block]() { return verify(block); }));
+    }
+    for (size_t block = 0; block < num_blocks; block++) {
+      valid[block] = results[block].get();
+    }
+  } else {
+    for (size_t block = 0; block < num_blocks; block++) {
+      valid[block] = verify(block);
+    }
+  }
+
+  // A short chunk is the end of the log.
+  stopped_ = size < kChunkSize;
+  for (size_t block = 0; block < num_blocks; block++) {
+    if (valid[block] < block_size(block)) {
+      chunk_end_ = block * kLogBlockSize + valid[block];
+      stopped_ = true;
+      break;
+    }
   }
-  pos_ += sizeof(size_t);
 
-  size_t str_size{*reinterpret_cast<size_t*>(buf.data())};
+  return chunk_end_ > 0;
+}
+
+std::optional<std::string_view> LogReader::ReadNextPayload() {
+  bool in_record{false};
 
-  if (str_size == 0) {
-    return "";
+  while (true) {
+    // Skip the padding at the end of a block.
+    auto block_left{kLogBlockSize - chunk_pos_ % kLogBlockSize};
+    if (block_left < kLogHeaderSize) {
+      chunk_pos_ += block_left;
+    }
+
+    if (chunk_pos_ >= chunk_end_) {
+      if (!ReadChunk()) {
+        return std::nullopt;
+      }
+      continue;
+    }
+
+    // Verification made sure that the whole fragment is there.
+    auto header{DecodeLogHeader(chunk_.data() + chunk_pos_)};
+    std::string_view fragment{chunk_.data() + chunk_pos_ + kLogHeaderSize,
+                              header.length};
+    chunk_pos_ += kLogHeaderSize + header.length;
+
+    bool expected{(header.type == LogRecordType::kFull ||
+                   header.type == LogRecordType::kFirst) != in_record};
+    if (!expected) {
+      stopped_ = true;
+      chunk_end_ = chunk_pos_;
+      return std::nullopt;
+    }
+
+    switch (header.type) {
+      case LogRecordType::kFull:
+        return fragment;
+      case LogRecordType::kFirst:
+        scratch_.assign(fragment);
+        in_record = true;
+        break;
+      case LogRecordType::kMiddle:
+        scratch_.append(fragment);
+        break;
+      default:
+        scratch_.append(fragment);
+        return scratch_;
+    }
   }
+}
 
-  try {
-    buf.reserve(str_size);
-  } catch (const std::bad_alloc&) {
+std::optional<LogReader::Record> LogReader::ReadNextRecord() {
+  auto payload{ReadNextPayload()};
+  if (!payload) {
     return std::nullopt;
   }
 
-  if (file_->ReadNoExcept(buf.data(), str_size, pos_) != str_size) {
+  auto read_size{[&payload]() -> std::optional<size_t> {
+    size_t size;
+    if (payload->size() < sizeof(size_t)) {
+      return std::nullopt;
+    }
+    std::copy_n(payload->data(), sizeof(size_t),
+                reinterpret_cast<char*>(&size));
+    payload->remove_prefix(sizeof(size_t));
+    return size;
+  }};
+
+  auto read_string{[&payload,
+                    &read_size]() -> std::optional<std::string_view> {
+    auto size{read_size()};
+    if (!size || payload->size() < *size) {
+      return std::nullopt;
+    }
+    auto str{payload->substr(0, *size)};
+    payload->remove_prefix(*size);
+    return str;
+  }};
+
+  auto seq{read_size()};
+  auto key{read_string()};
+  auto value{read_string()};
+  if (!seq || !key || !value || !payload->empty()) {
+    stopped_ = true;
+    chunk_end_ = chunk_pos_;
     return std::nullopt;
   }
-  pos_ += str_size;
 
-  return std::string{buf.data(), str_size};
+  return Record{*seq, *key, *value};
 }
 
 MemTableT LogReader::ReadMemTable() {
   MemTableT memtable;
+  range_tombstones_.clear();
+
+  while (auto record{ReadNextRecord()}) {
+    auto& [seq, key, value]{*record};
 
-  auto key = ReadNextString();
-  auto value = ReadNextString();
+    if (key.empty()) {
+      auto tombstones{util::ParseRangeTombstones(value)};
+      if (!tombstones) {
+        break;
+      }
 
-  while (key && value) {
-    if (value->size() > 0) {
-      memtable.insert_or_assign(key.value(), value.value());
+      for (auto& tombstone : *tombstones) {
+        memtable.erase(memtable.lower_bound(tombstone.begin),
+                       memtable.lower_bound(tombstone.end));
+        range_tombstones_.push_back(std::move(tombstone));
+      }
+    } else if (value.size() > 0) {
+      memtable.insert_or_assign(std::string{key}, std::string{value});
     } else {
-      memtable.erase(key.value());
+      memtable.erase(std::string{key});
     }
+  }
+
+  return memtable;
+}
 
-    key = ReadNextString();
-    if (key) {
-      value = ReadNextString();
+MemTable LogReader::ReadVersions() {
+  MemTable memtable;
+
+  while (auto record{ReadNextRecord()}) {
+    const auto& [seq, key, value]{*record};
+
+    if (key.empty()) {
+      auto tombstones{util::ParseRangeTombstones(value)};
+      if (!tombstones) {
+        break;
+      }
+
+      for (const auto& tombstone : *tombstones) {
+        memtable.AddRangeTombstone(tombstone.begin, tombstone.end,
+                                   tombstone.seq);
+      }
+    } else {
+      memtable.Add(key, value, seq);
     }
   }
 
   return memtable;
 }
 
+const RangeTombstoneList& LogReader::RangeTombstones() const noexcept {
+  return range_tombstones_;
+}
+
 std::string LogReader::GetFileName() const noexcept {
   assert(file_ != nullptr);
   return file_->GetFileName();
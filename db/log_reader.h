@@ -1,29 +1,88 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "file.h"
+#include "log_format.h"
+#include "memtable.h"
 #include "options.h"
+#include "thread_pool.h"
 #include "types.h"
 
 namespace mdb {
 
+// Reads the log in large chunks. The checksums of the blocks in a chunk are
+// verified on "num_threads" threads before any record in it is replayed.
+// Replay stops at the first fragment that is torn or corrupted, so a crash
+// in the middle of a write only loses that write. So does the first
+// fragment of another log, which is what is left of the log that the file
+// was last used for.
 class LogReader {
  public:
   LogReader(size_t log_number, const Options& options);
-  explicit LogReader(std::unique_ptr<ReadOnlyIO>&& file);
+  explicit LogReader(std::unique_ptr<ReadOnlyIO>&& file,
+                     size_t log_number = 0, size_t num_threads = 1);
 
   MemTableT ReadMemTable();
 
+  // The range deletions replayed by the last call to ReadMemTable().
+  const RangeTombstoneList& RangeTombstones() const noexcept;
+
+  // Like ReadMemTable(), but every write is kept as a version with its
+  // sequence number. This includes deletes and range deletions.
+  MemTable ReadVersions();
+
   std::string GetFileName() const noexcept;
 
  private:
-  std::optional<std::string> ReadNextString();
+  static constexpr size_t kChunkSize{32 * kLogBlockSize};
+
+  // The key and value point into the reader, and are valid until the next
+  // call.
+  struct Record {
+    SequenceNumber seq;
+    std::string_view key;
+    std::string_view value;
+  };
+
+  // Returns nullopt at the end of the log or at the first corrupted record.
+  std::optional<Record> ReadNextRecord();
+
+  // The payload of the next record, put together from its fragments.
+  std::optional<std::string_view> ReadNextPayload();
+
+  // Read and verify the next chunk. Returns false if there is nothing left
+  // that can be replayed. Throws std::system_error if the read fails.
+  bool ReadChunk();
+
   std::unique_ptr<ReadOnlyIO> file_;
 
-  size_t pos_{0};
+  uint32_t log_number_;
+
+  std::unique_ptr<ThreadPool> pool_;
+
+  RangeTombstoneList range_tombstones_;
+
+  // Where the next chunk starts in the file.
+  size_t file_pos_{0};
+
+  std::vector<char> chunk_;
+
+  // The next fragment starts at chunk_pos_. Nothing past chunk_end_ may be
+  // replayed.
+  size_t chunk_pos_{0};
+  size_t chunk_end_{0};
+
+  // Set once a torn or corrupted fragment was found.
+  bool stopped_{false};
+
+  // Records that span fragments are put together here.
+  std::string scratch_;
 };
 
 }  // namespace mdb
@@ -1,5 +1,7 @@
 #include "log_writer.h"
 
+#include <algorithm>
+#include <boost/crc.hpp>
 #include <boost/log/trivial.hpp>
 #include <cassert>
 #include <system_error>
@@ -8,15 +10,45 @@
 
 namespace mdb {
 
-LogWriter::LogWriter() : file_{nullptr}, sync_{false} {}
+namespace {
 
-LogWriter::LogWriter(int log_number, const Options& options)
-    : LogWriter(
-          options.env->MakeWriteOnlyIO(util::LogFileName(options, log_number)),
-          options.write_sync) {}
+// Sync the first "size" bytes of the file.
+void SyncFile(WriteOnlyIO& file, WALSyncMethod method, size_t size) {
+  if (method == WALSyncMethod::kSyncFileRange) {
+    file.RangeSync(0, size);
+  } else {
+    file.Sync();
+  }
+}
+
+}  // namespace
+
+LogWriter::LogWriter()
+    : file_{nullptr},
+      sync_{false},
+      sync_method_{WALSyncMethod::kFdatasync},
+      log_number_{0} {}
 
-LogWriter::LogWriter(std::unique_ptr<WriteOnlyIO>&& file, bool sync)
-    : file_{std::move(file)}, sync_{sync} {}
+LogWriter::LogWriter(int log_number, const Options& options,
+                     const std::string& recycled_filename)
+    : LogWriter(recycled_filename.empty()
+                    ? options.env->MakeWriteOnlyIO(
+                          util::LogFileName(options, log_number))
+                    : options.env->ReuseWriteOnlyIO(
+                          recycled_filename,
+                          util::LogFileName(options, log_number)),
+                options.write_sync, log_number, options.wal_sync_method) {
+  // The memtable is flushed once its keys and values pass
+  // memtable_max_size. Leave some room for the record headers.
+  file_->Allocate(options.memtable_max_size + options.memtable_max_size / 10);
+}
+
+LogWriter::LogWriter(std::unique_ptr<WriteOnlyIO>&& file, bool sync,
+                     size_t log_number, WALSyncMethod sync_method)
+    : file_{std::move(file)},
+      sync_{sync},
+      sync_method_{sync_method},
+      log_number_{static_cast<uint32_t>(log_number)} {}
 
 LogWriter::~LogWriter() {
   // User did not flush before destructing; we still have pending writes
@@ -31,7 +63,8 @@ LogWriter::~LogWriter() {
   }
 }
 
-void LogWriter::Add(std::string_view key, std::string_view value) {
+void LogWriter::Add(std::string_view key, std::string_view value,
+                    SequenceNumber seq) {
   if (file_ == nullptr) {
     BOOST_LOG_TRIVIAL(warning) << "Trying to log data to nonexistent (== "
                                   "nullptr) log file. No action was taken.";
@@ -41,17 +74,31 @@ void LogWriter::Add(std::string_view key, std::string_view value) {
   // For the purposes of exception safety, we write everything together.
   // If we wrote key/value sequentially, and an exception occured during
   // the key write, we would leave the log file in a unreadable state!
-  std::vector<char> writable_data;
-  writable_data.reserve(key.size() + value.size() + 2 * sizeof(size_t));
+  // The parts are gathered straight from the caller's memory.
+  std::array<size_t, 2> header{seq, key.size()};
+  size_t value_size{value.size()};
+  std::array<std::string_view, 4> parts{
+      std::string_view{reinterpret_cast<const char*>(header.data()),
+                       sizeof(header)},
+      key,
+      std::string_view{reinterpret_cast<const char*>(&value_size),
+                       sizeof(size_t)},
+      value};
 
-  util::AddStringToWritable(key, writable_data);
-  util::AddStringToWritable(value, writable_data);
+  Append(parts.data(), parts.size());
+}
 
-  Append(writable_data);
+void LogWriter::AddRangeTombstone(std::string_view begin,
+                                  std::string_view end, SequenceNumber seq) {
+  std::vector<char> tombstone;
+  util::AddRangeTombstoneToWritable(
+      {std::string(begin), std::string(end), seq}, tombstone);
+
+  Add("", std::string_view(tombstone.data(), tombstone.size()), seq);
 }
 
 size_t LogWriter::GetSpaceAvail() const noexcept {
-  return kBlockSize - buf_pos_;
+  return kBufferSize - buf_pos_;
 }
 
 void LogWriter::FlushBuffer() {
@@ -70,29 +117,129 @@ void LogWriter::FlushBuffer() {
   }
 }
 
-void LogWriter::BufferData(const std::vector<char>& data) {
+std::function<void()> LogWriter::FlushForSync(bool durable) {
+  if (file_ == nullptr) {
+    return [] {};
+  }
+
+  FlushBuffer();
+  auto method{durable ? WALSyncMethod::kFdatasync : sync_method_};
+  return [file = file_, method, size = size_] {
+    SyncFile(*file, method, size);
+  };
+}
+
+void LogWriter::Frame(const std::string_view* parts, size_t num_parts,
+                      size_t size) {
+  static constexpr std::array<char, kLogHeaderSize> kPadding{};
+
+  headers_.clear();
+  frames_.clear();
+
+  // Every full block holds one fragment, plus one for each end.
+  headers_.reserve(size / (kLogBlockSize - kLogHeaderSize) + 2);
+
+  size_t part{0};
+  size_t part_pos{0};
+  size_t left{size};
+  bool begin{true};
+
+  do {
+    auto block_left{kLogBlockSize - block_offset_};
+    if (block_left < kLogHeaderSize) {
+      frames_.emplace_back(kPadding.data(), block_left);
+      block_offset_ = 0;
+      block_left = kLogBlockSize;
+    }
+
+    auto fragment_size{std::min(left, block_left - kLogHeaderSize)};
+    bool end{fragment_size == left};
+    auto type{begin && end ? LogRecordType::kFull
+              : begin      ? LogRecordType::kFirst
+              : end        ? LogRecordType::kLast
+                           : LogRecordType::kMiddle};
+
+    auto header_index{headers_.size()};
+    headers_.emplace_back();
+    frames_.emplace_back(headers_.back().data(), kLogHeaderSize);
+
+    boost::crc_32_type crc;
+    crc.process_byte(static_cast<unsigned char>(type));
+    crc.process_bytes(&log_number_, sizeof(log_number_));
+
+    for (auto remaining{fragment_size}; remaining > 0;) {
+      auto piece{parts[part].substr(part_pos, remaining)};
+      if (!piece.empty()) {
+        crc.process_bytes(piece.data(), piece.size());
+        frames_.push_back(piece);
+        remaining -= piece.size();
+        part_pos += piece.size();
+      }
+      if (part_pos == parts[part].size()) {
+        ++part;
+        part_pos = 0;
+      }
+    }
+    assert(part <= num_parts);
+
+    headers_[header_index] =
+        EncodeLogHeader(crc.checksum(), static_cast<uint16_t>(fragment_size),
+                        type, log_number_);
+
+    block_offset_ += kLogHeaderSize + fragment_size;
+    left -= fragment_size;
+    begin = false;
+  } while (left > 0);
+}
+
+void LogWriter::BufferFrames(size_t size) {
   assert(file_ != nullptr);
 
-  if (data.size() > kBlockSize) {
-    file_->Write(data.data(), data.size());
-  } else {
-    if (data.size() > kBlockSize - buf_pos_) {
-      FlushBuffer();
+  if (size <= GetSpaceAvail()) {
+    for (const auto& frame : frames_) {
+      std::copy(frame.cbegin(), frame.cend(), buf_.begin() + buf_pos_);
+      buf_pos_ += frame.size();
     }
-    std::copy(data.cbegin(), data.cend(), buf_.begin() + buf_pos_);
-    buf_pos_ += data.size();
+    return;
   }
+
+  // The buffered data and the record go out in a single writev(), so the
+  // record is never copied.
+  frames_.insert(frames_.begin(),
+                 {buf_.data(), static_cast<size_t>(buf_pos_)});
+  file_->WriteV(frames_.data(), frames_.size());
+  size_ += buf_pos_ + size;
+  buf_pos_ = 0;
 }
 
-void LogWriter::Append(const std::vector<char>& data) {
+void LogWriter::Append(const std::string_view* parts, size_t num_parts) {
   assert(file_ != nullptr);
 
-  // Syncing is on, always write
+  size_t record_size{0};
+  for (size_t i = 0; i < num_parts; ++i) {
+    record_size += parts[i].size();
+  }
+
+  Frame(parts, num_parts, record_size);
+
+  size_t size{0};
+  for (const auto& frame : frames_) {
+    size += frame.size();
+  }
+
+  // Syncing is on, always write. The write must be durable when it returns,
+  // so the sync method is ignored. The record is made contiguous so that the
+  // write and the sync can be queued together.
   if (sync_) {
-    file_->Write(data.data(), data.size());
-    file_->Sync();
+    std::vector<char> record;
+    record.reserve(size);
+    for (const auto& frame : frames_) {
+      record.insert(record.end(), frame.cbegin(), frame.cend());
+    }
+    file_->WriteAndSync(record.data(), record.size());
+    size_ += size;
   } else {
-    BufferData(data);
+    BufferFrames(size);
   }
 }
 
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 #include "file.h"
+#include "log_format.h"
 #include "options.h"
+#include "types.h"
 
 namespace mdb {
 
@@ -13,8 +18,13 @@ class LogWriter {
  public:
   LogWriter();
 
-  LogWriter(int log_number, const Options& options);
-  LogWriter(std::unique_ptr<WriteOnlyIO>&& file, bool sync);
+  // Reuses "recycled_filename" for the log if it is given. The file is
+  // preallocated to about the size of a full memtable.
+  LogWriter(int log_number, const Options& options,
+            const std::string& recycled_filename = "");
+  LogWriter(std::unique_ptr<WriteOnlyIO>&& file, bool sync,
+            size_t log_number = 0,
+            WALSyncMethod sync_method = WALSyncMethod::kFdatasync);
 
   LogWriter(const LogWriter&) = delete;
   LogWriter& operator=(const LogWriter&) = delete;
@@ -24,32 +34,66 @@ class LogWriter {
 
   ~LogWriter();
 
-  void Add(std::string_view key, std::string_view value);
+  // Every record starts with the sequence number of its write.
+  void Add(std::string_view key, std::string_view value,
+           SequenceNumber seq = 0);
+
+  // Log a DeleteRange as a single record. It is stored under the empty key,
+  // which user keys can never be.
+  void AddRangeTombstone(std::string_view begin, std::string_view end,
+                         SequenceNumber seq = 0);
 
   void FlushBuffer();
 
+  // Hand the buffered records to the file, and return a function that makes
+  // every record added so far durable. It keeps the file open, and may run
+  // without the caller's lock while further records are added. Without
+  // "durable", the records are synced with the writer's sync method, which
+  // may not survive a power loss.
+  std::function<void()> FlushForSync(bool durable = true);
+
   size_t Size() const noexcept;
 
   std::string GetFileName() const noexcept;
 
  private:
-  static constexpr size_t kBlockSize{512};
+  static constexpr size_t kBufferSize{512};
 
-  void Append(const std::vector<char>& data);
+  // Write a record made of the given parts. See log_format.h.
+  void Append(const std::string_view* parts, size_t num_parts);
 
-  void BufferData(const std::vector<char>& data);
+  // Split the record into fragments, filling frames_ with the headers,
+  // padding and pieces of the record in the order they are written.
+  void Frame(const std::string_view* parts, size_t num_parts, size_t size);
+
+  // Write out frames_, or buffer it if it fits.
+  void BufferFrames(size_t size);
 
   size_t GetSpaceAvail() const noexcept;
 
-  std::unique_ptr<WriteOnlyIO> file_;
+  // Shared with the functions returned by FlushForSync().
+  std::shared_ptr<WriteOnlyIO> file_;
 
-  std::array<char, kBlockSize> buf_;
+  std::array<char, kBufferSize> buf_;
 
   int buf_pos_{0};
 
   size_t size_{0};
 
+  // Where the next fragment starts in the current block.
+  size_t block_offset_{0};
+
+  // Kept around to avoid allocations. The frames point into headers_,
+  // which must not reallocate while they are in use.
+  std::vector<LogHeader> headers_;
+  std::vector<std::string_view> frames_;
+
   bool sync_;
+
+  WALSyncMethod sync_method_;
+
+  // Stamped on every fragment. See log_format.h.
+  uint32_t log_number_;
 };
 
 }  // namespace mdb
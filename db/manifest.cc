@@ -0,0 +1,311 @@
+#include "manifest.h"
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+
+#include "helpers.h"
+
+namespace mdb {
+
+namespace {
+
+// Reads size_t values out of a record, keeping track of whether the record
+// was long enough.
+class RecordParser {
+ public:
+  explicit RecordParser(const std::vector<char>& record) : record_{record} {}
+
+  std::optional<size_t> ReadSize() {
+    if (record_.size() - pos_ < sizeof(size_t)) {
+      return std::nullopt;
+    }
+
+    size_t size{*reinterpret_cast<const size_t*>(record_.data() + pos_)};
+    pos_ += sizeof(size_t);
+    return size;
+  }
+
+  std::optional<std::string> ReadString() {
+    auto size{ReadSize()};
+    if (!size || record_.size() - pos_ < *size) {
+      return std::nullopt;
+    }
+
+    std::string str(record_.data() + pos_, *size);
+    pos_ += *size;
+    return str;
+  }
+
+  std::optional<RangeTombstone> ReadRangeTombstone() {
+    auto begin{ReadString()};
+    auto end{ReadString()};
+    auto seq{ReadSize()};
+    if (!begin || !end || !seq) {
+      return std::nullopt;
+    }
+    return RangeTombstone{std::move(*begin), std::move(*end), *seq};
+  }
+
+  std::optional<TableMetadata> ReadTable() {
+    auto number{ReadSize()};
+    auto level{ReadSize()};
+    auto recency{ReadSize()};
+    auto smallest_key{ReadString()};
+    auto largest_key{ReadString()};
+    auto size{ReadSize()};
+    auto creation_time{ReadSize()};
+    auto num_tombstones{ReadSize()};
+    if (!number || !level || !recency || !smallest_key || !largest_key ||
+        !size || !creation_time || !num_tombstones) {
+      return std::nullopt;
+    }
+
+    TableMetadata table{
+        .number = *number,
+        .level = *level,
+        .recency = *recency,
+        .smallest_key = std::move(*smallest_key),
+        .largest_key = std::move(*largest_key),
+        .size = *size,
+        .range_tombstones = {},
+        .creation_time = std::chrono::system_clock::time_point{
+            std::chrono::seconds{*creation_time}}};
+
+    for (size_t i = 0; i < *num_tombstones; i++) {
+      auto tombstone{ReadRangeTombstone()};
+      if (!tombstone) {
+        return std::nullopt;
+      }
+      table.range_tombstones.push_back(std::move(*tombstone));
+    }
+
+    return table;
+  }
+
+  std::optional<std::vector<size_t>> ReadSizes() {
+    auto num_sizes{ReadSize()};
+    if (!num_sizes) {
+      return std::nullopt;
+    }
+
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < *num_sizes; i++) {
+      auto size{ReadSize()};
+      if (!size) {
+        return std::nullopt;
+      }
+      sizes.push_back(*size);
+    }
+
+    return sizes;
+  }
+
+  bool Done() const noexcept { return pos_ == record_.size(); }
+
+ private:
+  const std::vector<char>& record_;
+  size_t pos_{0};
+};
+
+void AddSizesToWritable(const std::vector<size_t>& sizes,
+                        std::vector<char>& writable) {
+  util::AddSizeToWritable(sizes.size(), writable);
+  for (auto size : sizes) {
+    util::AddSizeToWritable(size, writable);
+  }
+}
+
+}  // namespace
+
+void ManifestState::Apply(const VersionEdit& edit) {
+  next_table = std::max(next_table, edit.next_table);
+  last_sequence = std::max(last_sequence, edit.last_sequence);
+  log_number = std::max(log_number, edit.log_number);
+  pending_tables = edit.pending_tables;
+
+  for (const auto& table : edit.added_tables) {
+    tables.insert_or_assign(table.number, table);
+  }
+
+  for (auto number : edit.removed_tables) {
+    tables.erase(number);
+    removed_tables.insert(number);
+  }
+}
+
+ManifestWriter::ManifestWriter(const Options& options, ManifestState state)
+    : sync_{options.write_sync},
+      env_{options.env},
+      filename_{util::ManifestFileName(options)},
+      max_file_size_{options.max_manifest_file_size},
+      state_{std::move(state)} {
+  WriteCheckpoint({state_.removed_tables.cbegin(),
+                   state_.removed_tables.cend()});
+}
+
+ManifestWriter::ManifestWriter(std::unique_ptr<WriteOnlyIO>&& file, bool sync)
+    : file_{std::move(file)}, sync_{sync} {
+  assert(file_ != nullptr);
+}
+
+void ManifestWriter::Add(const VersionEdit& edit, bool sync) {
+  state_.Apply(edit);
+
+  if (env_ != nullptr && file_size_ >= max_file_size_) {
+    WriteCheckpoint(edit.removed_tables);
+  } else {
+    WriteRecord(edit, sync_ || sync);
+  }
+}
+
+void ManifestWriter::WriteCheckpoint(std::vector<size_t> removed_tables) {
+  VersionEdit checkpoint{.added_tables = {},
+                         .removed_tables = std::move(removed_tables),
+                         .next_table = state_.next_table,
+                         .last_sequence = state_.last_sequence,
+                         .log_number = state_.log_number,
+                         .pending_tables = state_.pending_tables};
+  for (const auto& number_and_table : state_.tables) {
+    checkpoint.added_tables.push_back(number_and_table.second);
+  }
+
+  // The removed tables are only remembered until the next checkpoint.
+  state_.removed_tables = {checkpoint.removed_tables.cbegin(),
+                           checkpoint.removed_tables.cend()};
+
+  // Left behind if we crashed while writing the last checkpoint.
+  auto temp_filename{filename_ + ".tmp"};
+  if (env_->FileExists(temp_filename)) {
+    env_->RemoveFile(temp_filename);
+  }
+
+  // The old manifest stays in use until the new one is complete on disk.
+  // The file stays open across the rename.
+  file_ = env_->MakeWriteOnlyIO(temp_filename);
+  file_size_ = 0;
+  WriteRecord(checkpoint, true);
+
+  env_->RenameFile(temp_filename, filename_);
+
+  // Otherwise the rename may be lost, leaving the old manifest in place of
+  // one that later edits are appended to.
+  env_->SyncDir(std::filesystem::path{filename_}.parent_path().string());
+}
+
+void ManifestWriter::WriteRecord(const VersionEdit& edit, bool sync) {
+  std::vector<char> record;
+
+  // Placeholder for the record size.
+  util::AddSizeToWritable(0, record);
+
+  util::AddSizeToWritable(edit.next_table, record);
+  util::AddSizeToWritable(edit.last_sequence, record);
+  util::AddSizeToWritable(edit.log_number, record);
+
+  util::AddSizeToWritable(edit.added_tables.size(), record);
+  for (const auto& table : edit.added_tables) {
+    util::AddSizeToWritable(table.number, record);
+    util::AddSizeToWritable(table.level, record);
+    util::AddSizeToWritable(table.recency, record);
+    util::AddStringToWritable(table.smallest_key, record);
+    util::AddStringToWritable(table.largest_key, record);
+    util::AddSizeToWritable(table.size, record);
+    util::AddSizeToWritable(
+        std::chrono::duration_cast<std::chrono::seconds>(
+            table.creation_time.time_since_epoch())
+            .count(),
+        record);
+
+    util::AddSizeToWritable(table.range_tombstones.size(), record);
+    for (const auto& tombstone : table.range_tombstones) {
+      util::AddRangeTombstoneToWritable(tombstone, record);
+    }
+  }
+
+  AddSizesToWritable(edit.removed_tables, record);
+  AddSizesToWritable(edit.pending_tables, record);
+
+  *reinterpret_cast<size_t*>(record.data()) = record.size() - sizeof(size_t);
+  file_size_ += record.size();
+
+  // The whole record goes out in a single write so that a crash can only
+  // leave a torn record at the very end of the file.
+  if (sync) {
+    file_->WriteAndSync(record.data(), record.size());
+  } else {
+    file_->Write(record.data(), record.size());
+  }
+}
+
+ManifestReader::ManifestReader(const Options& options)
+    : ManifestReader(
+          options.env->MakeReadOnlyIO(util::ManifestFileName(options))) {}
+
+ManifestReader::ManifestReader(std::unique_ptr<ReadOnlyIO>&& file)
+    : file_{std::move(file)} {
+  assert(file_ != nullptr);
+}
+
+std::optional<VersionEdit> ManifestReader::ReadNextEdit() {
+  size_t record_size;
+  if (file_->ReadNoExcept(reinterpret_cast<char*>(&record_size),
+                          sizeof(size_t), pos_) != sizeof(size_t)) {
+    return std::nullopt;
+  }
+
+  if (record_size > file_->Size() - pos_ - sizeof(size_t)) {
+    return std::nullopt;
+  }
+
+  std::vector<char> record(record_size);
+  if (file_->ReadNoExcept(record.data(), record_size, pos_ + sizeof(size_t)) !=
+      record_size) {
+    return std::nullopt;
+  }
+
+  RecordParser parser{record};
+  VersionEdit edit;
+
+  auto next_table{parser.ReadSize()};
+  auto last_sequence{parser.ReadSize()};
+  auto log_number{parser.ReadSize()};
+  auto num_added{parser.ReadSize()};
+  if (!next_table || !last_sequence || !log_number || !num_added) {
+    return std::nullopt;
+  }
+  edit.next_table = *next_table;
+  edit.last_sequence = *last_sequence;
+  edit.log_number = *log_number;
+
+  for (size_t i = 0; i < *num_added; i++) {
+    auto table{parser.ReadTable()};
+    if (!table) {
+      return std::nullopt;
+    }
+    edit.added_tables.push_back(std::move(*table));
+  }
+
+  auto removed_tables{parser.ReadSizes()};
+  auto pending_tables{parser.ReadSizes()};
+  if (!removed_tables || !pending_tables || !parser.Done()) {
+    return std::nullopt;
+  }
+  edit.removed_tables = std::move(*removed_tables);
+  edit.pending_tables = std::move(*pending_tables);
+
+  pos_ += record_size + sizeof(size_t);
+  return edit;
+}
+
+ManifestState ManifestReader::ReadState() {
+  ManifestState state;
+
+  while (auto edit{ReadNextEdit()}) {
+    state.Apply(*edit);
+  }
+
+  return state;
+}
+
+}  // namespace mdb
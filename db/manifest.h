@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "options.h"
+#include "types.h"
+
+namespace mdb {
+
+// What the manifest knows about a table.
+struct TableMetadata {
+  size_t number;
+  size_t level;
+
+  // Within a level, tables with a higher recency hold newer data. Flushed
+  // tables use their table number, and compaction outputs inherit the
+  // highest recency of their inputs.
+  size_t recency;
+
+  // Everything else that is kept in memory about the table, so that it
+  // doesn't have to be opened during recovery.
+  std::string smallest_key{};
+  std::string largest_key{};
+  size_t size{0};
+  RangeTombstoneList range_tombstones{};
+
+  // Stored with a resolution of one second.
+  std::chrono::system_clock::time_point creation_time{};
+};
+
+// A change to the set of tables on disk. Adding a table that is already
+// known moves it to the given level.
+struct VersionEdit {
+  std::vector<TableMetadata> added_tables{};
+
+  std::vector<size_t> removed_tables{};
+
+  // The next table number that will be handed out.
+  size_t next_table{0};
+
+  // The highest sequence number that made it into a table.
+  SequenceNumber last_sequence{0};
+
+  // Logs with lower numbers only hold writes that made it into a table.
+  size_t log_number{0};
+
+  // Tables that were being written when the edit was made. Those that
+  // never made it into the manifest are deleted during recovery.
+  std::vector<size_t> pending_tables{};
+};
+
+// The result of replaying every edit in a manifest.
+struct ManifestState {
+  // Table number -> metadata, for all live tables.
+  std::map<size_t, TableMetadata> tables;
+
+  // Tables that were removed. Their files may still exist if we crashed
+  // before deleting them.
+  std::set<size_t> removed_tables;
+
+  size_t next_table{0};
+
+  SequenceNumber last_sequence{0};
+
+  size_t log_number{0};
+
+  // The pending tables of the last edit.
+  std::vector<size_t> pending_tables;
+
+  void Apply(const VersionEdit& edit);
+};
+
+// The manifest is an append-only log of VersionEdits. It records every
+// table with its level and key range, so tables can move between levels
+// without being rewritten and recovery never has to look at them.
+class ManifestWriter {
+ public:
+  // Start a new manifest that holds "state", replacing the current one if
+  // there is any. Once the manifest grows past
+  // Options::max_manifest_file_size, it is replaced by a checkpoint of the
+  // state in the same way.
+  explicit ManifestWriter(const Options& options, ManifestState state = {});
+
+  // Append to "file" without ever writing a checkpoint.
+  ManifestWriter(std::unique_ptr<WriteOnlyIO>&& file, bool sync);
+
+  ManifestWriter(const ManifestWriter&) = delete;
+  ManifestWriter& operator=(const ManifestWriter&) = delete;
+
+  ManifestWriter(ManifestWriter&&) = delete;
+  ManifestWriter& operator=(ManifestWriter&&) = delete;
+
+  // The edit is synced if "sync" is set, even if the writer doesn't sync
+  // every edit.
+  void Add(const VersionEdit& edit, bool sync = false);
+
+ private:
+  void WriteRecord(const VersionEdit& edit, bool sync);
+
+  // Write the state to a temporary file as a single edit and rename it over
+  // the manifest, so a crash leaves either the old or the new manifest.
+  // Tables in "removed_tables" may still have files that recovery has to
+  // delete.
+  void WriteCheckpoint(std::vector<size_t> removed_tables);
+
+  std::unique_ptr<WriteOnlyIO> file_;
+  bool sync_;
+
+  // Only set by the first constructor.
+  std::shared_ptr<Env> env_;
+  std::string filename_;
+  size_t max_file_size_{std::numeric_limits<size_t>::max()};
+
+  size_t file_size_{0};
+  ManifestState state_;
+};
+
+class ManifestReader {
+ public:
+  explicit ManifestReader(const Options& options);
+  explicit ManifestReader(std::unique_ptr<ReadOnlyIO>&& file);
+
+  // Replay all edits. Reading stops at the first incomplete or corrupted
+  // record, which can only be the last one.
+  ManifestState ReadState();
+
+ private:
+  std::optional<VersionEdit> ReadNextEdit();
+
+  std::unique_ptr<ReadOnlyIO> file_;
+
+  size_t pos_{0};
+};
+
+}  // namespace mdb
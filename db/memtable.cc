@@ -0,0 +1,87 @@
+#include "memtable.h"
+
+#include <algorithm>
+
+#include "helpers.h"
+
+namespace mdb {
+
+MemTable::MemTable(const MemTableT& memtable,
+                   const RangeTombstoneList& range_tombstones) {
+  for (const auto& [key, value] : memtable) {
+    Add(key, value, 0);
+  }
+
+  for (const auto& tombstone : range_tombstones) {
+    AddRangeTombstone(tombstone.begin, tombstone.end, 0);
+  }
+}
+
+void MemTable::Add(std::string_view key, std::string_view value,
+                   SequenceNumber seq) {
+  entries_.insert_or_assign({std::string(key), seq}, std::string(value));
+  last_sequence_ = std::max(last_sequence_, seq);
+  size_ += key.size() + value.size();
+}
+
+void MemTable::AddRangeTombstone(std::string_view begin, std::string_view end,
+                                 SequenceNumber seq) {
+  range_tombstones_.push_back({std::string(begin), std::string(end), seq});
+  last_sequence_ = std::max(last_sequence_, seq);
+  size_ += begin.size() + end.size();
+}
+
+std::optional<std::string> MemTable::Get(std::string_view key,
+                                         SequenceNumber snapshot) const {
+  auto value{GetView(key, snapshot)};
+  if (!value) {
+    return std::nullopt;
+  }
+  return std::string{*value};
+}
+
+std::optional<std::string_view> MemTable::GetView(
+    std::string_view key, SequenceNumber snapshot) const {
+  // The first version of the key that is not newer than the snapshot.
+  auto loc{entries_.lower_bound(std::pair{key, snapshot})};
+  if (loc != entries_.end() && loc->first.first == key) {
+    if (util::IsCovered(key, loc->first.second, range_tombstones_,
+                        snapshot)) {
+      return "";
+    }
+    return loc->second;
+  }
+
+  if (util::IsCovered(key, range_tombstones_, snapshot)) {
+    return "";
+  }
+
+  return std::nullopt;
+}
+
+const MemTable::EntriesT& MemTable::Entries() const noexcept {
+  return entries_;
+}
+
+const RangeTombstoneList& MemTable::RangeTombstones() const noexcept {
+  return range_tombstones_;
+}
+
+SequenceNumber MemTable::LastSequence() const noexcept {
+  return last_sequence_;
+}
+
+bool MemTable::Empty() const noexcept {
+  return entries_.empty() && range_tombstones_.empty();
+}
+
+size_t MemTable::Size() const noexcept { return size_; }
+
+void MemTable::Clear() {
+  entries_.clear();
+  range_tombstones_.clear();
+  last_sequence_ = 0;
+  size_ = 0;
+}
+
+}  // namespace mdb
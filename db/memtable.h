@@ -0,0 +1,76 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "types.h"
+
+namespace mdb {
+
+// Orders (key, sequence number) pairs by key, and the versions of a key from
+// newest to oldest. Heterogeneous lookup works the same way as in MemTableT.
+struct VersionLess {
+  using is_transparent = void;
+
+  template <typename Lhs, typename Rhs>
+  bool operator()(const Lhs& lhs, const Rhs& rhs) const noexcept {
+    int cmp{std::string_view(lhs.first).compare(rhs.first)};
+    return cmp == 0 ? lhs.second > rhs.second : cmp < 0;
+  }
+};
+
+// The memtable of a DB. Unlike MemTableT, it keeps every version of a key
+// along with its sequence number, so that snapshots can still read what a
+// later write replaced. Deletes are stored as empty values. The caller must
+// synchronize access.
+class MemTable {
+ public:
+  using VersionKey = std::pair<std::string, SequenceNumber>;
+  using EntriesT = std::map<VersionKey, std::string, VersionLess>;
+
+  MemTable() = default;
+
+  // The contents of "memtable" and "range_tombstones" get sequence
+  // number 0.
+  MemTable(const MemTableT& memtable,
+           const RangeTombstoneList& range_tombstones);
+
+  void Add(std::string_view key, std::string_view value, SequenceNumber seq);
+
+  void AddRangeTombstone(std::string_view begin, std::string_view end,
+                         SequenceNumber seq);
+
+  // The newest version of "key" that is visible at "snapshot". Returns an
+  // empty string if the key is deleted, and nullopt if the memtable doesn't
+  // know about the key.
+  std::optional<std::string> Get(std::string_view key,
+                                 SequenceNumber snapshot) const;
+
+  // Like Get(), but a view of the value in the memtable. It is valid until
+  // the memtable is cleared.
+  std::optional<std::string_view> GetView(std::string_view key,
+                                          SequenceNumber snapshot) const;
+
+  const EntriesT& Entries() const noexcept;
+  const RangeTombstoneList& RangeTombstones() const noexcept;
+
+  // The highest sequence number added, or 0 if there is none.
+  SequenceNumber LastSequence() const noexcept;
+
+  bool Empty() const noexcept;
+
+  // Number of bytes taken up by keys, values and range tombstones.
+  size_t Size() const noexcept;
+
+  void Clear();
+
+ private:
+  EntriesT entries_;
+  RangeTombstoneList range_tombstones_;
+  SequenceNumber last_sequence_{0};
+  size_t size_{0};
+};
+
+}  // namespace mdb
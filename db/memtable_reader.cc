@@ -0,0 +1,157 @@
+#include "memtable_reader.h"
+
+#include <algorithm>
+
+namespace mdb {
+
+// Steps through the entries with the lock held, so writers may add entries
+// in between. Map iterators stay valid across inserts, and the memtable is
+// never cleared while a reader holds it.
+class MemTableReader::MemTableIter : public TableIteratorImpl {
+ public:
+  MemTableIter(const MemTableReader& reader,
+               MemTable::EntriesT::const_iterator it)
+      : reader_{reader}, memtable_{reader.memtable_->Entries()}, it_{it} {
+    auto lk{reader_.Lock()};
+    SetCur();
+  }
+
+  ValueType& GetValue() override { return cur_; }
+
+  // Keys and sequence numbers never change once added.
+  SequenceNumber Sequence() const noexcept override {
+    return it_ != memtable_.end() ? it_->first.second : 0;
+  }
+
+  bool IsDone() override { return it_ == memtable_.end(); }
+
+  void Next() override {
+    auto lk{reader_.Lock()};
+    ++it_;
+    SetCur();
+  }
+
+  // A memtable has no file offsets to report.
+  size_t Position() const noexcept override { return 0; }
+
+  void Seek(std::string_view key) override {
+    auto lk{reader_.Lock()};
+    it_ = memtable_.lower_bound(std::pair{key, kMaxSequenceNumber});
+    SetCur();
+  }
+
+  void SeekToLast() override {
+    auto lk{reader_.Lock()};
+    it_ = memtable_.empty() ? memtable_.end() : std::prev(memtable_.end());
+    SetCur();
+  }
+
+  bool operator==(const TableIteratorImpl& other) override {
+    if (typeid(*this) == typeid(other)) {
+      const MemTableIter& other_cast{static_cast<const MemTableIter&>(other)};
+      return &memtable_ == &other_cast.memtable_ && it_ == other_cast.it_;
+    }
+    return false;
+  }
+
+  std::shared_ptr<TableIteratorImpl> Clone() override {
+    return std::make_shared<MemTableIter>(reader_, it_);
+  }
+
+ private:
+  // Requires the lock.
+  void SetCur() {
+    if (it_ != memtable_.end()) {
+      cur_.first.assign(it_->first.first);
+      cur_.second.assign(it_->second);
+    } else {
+      cur_ = {"", ""};
+    }
+  }
+
+  const MemTableReader& reader_;
+  const MemTable::EntriesT& memtable_;
+  MemTable::EntriesT::const_iterator it_;
+
+  ValueType cur_;
+};
+
+MemTableReader::MemTableReader(MemTable memtable)
+    : MemTableReader(std::make_shared<const MemTable>(std::move(memtable)),
+                     nullptr) {}
+
+MemTableReader::MemTableReader(std::shared_ptr<const MemTable> memtable,
+                               std::shared_ptr<std::shared_mutex> mutex)
+    : memtable_{std::move(memtable)}, mutex_{std::move(mutex)} {
+  auto lk{Lock()};
+  const auto& entries{memtable_->Entries()};
+  size_ = memtable_->Size();
+  range_tombstones_ = memtable_->RangeTombstones();
+
+  if (!entries.empty()) {
+    smallest_key_ = entries.begin()->first.first;
+    largest_key_ = entries.rbegin()->first.first;
+  }
+
+  for (const auto& tombstone : range_tombstones_) {
+    if (smallest_key_.empty() || tombstone.begin < smallest_key_) {
+      smallest_key_ = tombstone.begin;
+    }
+    largest_key_ = std::max(largest_key_, tombstone.end);
+  }
+}
+
+MemTableReader::MemTableReader(const MemTableT& memtable,
+                               const RangeTombstoneList& range_tombstones)
+    : MemTableReader(MemTable{memtable, range_tombstones}) {}
+
+std::optional<std::string> MemTableReader::ValueOf(std::string_view key,
+                                                   SequenceNumber snapshot) {
+  auto lk{Lock()};
+  return memtable_->Get(key, snapshot);
+}
+
+TableIterator MemTableReader::Begin() {
+  return TableIterator(
+      std::make_shared<MemTableIter>(*this, memtable_->Entries().cbegin()));
+}
+
+TableIterator MemTableReader::End() {
+  return TableIterator(
+      std::make_shared<MemTableIter>(*this, memtable_->Entries().cend()));
+}
+
+TableIterator MemTableReader::Seek(std::string_view key) {
+  auto it{End()};
+  it.Seek(key);
+  return it;
+}
+
+TableIterator MemTableReader::SeekToLast() {
+  auto it{End()};
+  it.SeekToLast();
+  return it;
+}
+
+size_t MemTableReader::Size() const { return size_; }
+
+std::string_view MemTableReader::SmallestKey() const noexcept {
+  return smallest_key_;
+}
+
+std::string_view MemTableReader::LargestKey() const noexcept {
+  return largest_key_;
+}
+
+const RangeTombstoneList& MemTableReader::RangeTombstones() const noexcept {
+  return range_tombstones_;
+}
+
+std::shared_lock<std::shared_mutex> MemTableReader::Lock() const {
+  if (mutex_ == nullptr) {
+    return {};
+  }
+  return std::shared_lock{*mutex_};
+}
+
+}  // namespace mdb
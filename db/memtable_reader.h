@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+
+#include "memtable.h"
+#include "table_reader.h"
+#include "types.h"
+
+namespace mdb {
+
+// Exposes a memtable through the TableReader interface so that it can be
+// merged with the tables on disk.
+class MemTableReader : public TableReader {
+ public:
+  explicit MemTableReader(MemTable memtable);
+
+  // Read "memtable" in place while writers keep adding to it. Writers must
+  // hold "mutex" exclusively, and every access takes it shared. The range
+  // tombstones are copied, so ones added later are not seen. Neither are
+  // later entries if the reader is only read at an older snapshot.
+  MemTableReader(std::shared_ptr<const MemTable> memtable,
+                 std::shared_ptr<std::shared_mutex> mutex);
+
+  // Every entry gets sequence number 0.
+  MemTableReader(const MemTableT& memtable,
+                 const RangeTombstoneList& range_tombstones);
+
+  using TableReader::ValueOf;
+
+  std::optional<std::string> ValueOf(std::string_view key,
+                                     SequenceNumber snapshot) override;
+
+  TableIterator Begin() override;
+  TableIterator End() override;
+
+  TableIterator Seek(std::string_view key) override;
+  TableIterator SeekToLast() override;
+
+  // Number of bytes taken up by keys, values and range tombstones.
+  size_t Size() const override;
+
+  size_t GetLevel() const override { return 0; }
+
+  std::string_view SmallestKey() const noexcept override;
+  std::string_view LargestKey() const noexcept override;
+
+  const RangeTombstoneList& RangeTombstones() const noexcept override;
+
+ private:
+  class MemTableIter;
+
+  // Held while the memtable is read, if it is shared with writers.
+  std::shared_lock<std::shared_mutex> Lock() const;
+
+  std::shared_ptr<const MemTable> memtable_;
+  std::shared_ptr<std::shared_mutex> mutex_;
+  RangeTombstoneList range_tombstones_;
+
+  size_t size_{0};
+  std::string smallest_key_;
+  std::string largest_key_;
+};
+
+}  // namespace mdb
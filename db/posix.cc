@@ -1,7 +1,15 @@
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
 #include <system_error>
 #include <vector>
 
@@ -16,10 +24,112 @@ void ThrowIfError(int ret) {
   }
 }
 
+// Drop the first "n" bytes from iov[first..]. Returns the index of the
+// first iovec with data left.
+size_t ConsumeIovecs(std::vector<iovec>& iov, size_t first, size_t n) {
+  while (n > 0) {
+    if (n >= iov[first].iov_len) {
+      n -= iov[first].iov_len;
+      ++first;
+    } else {
+      iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + n;
+      iov[first].iov_len -= n;
+      n = 0;
+    }
+  }
+  return first;
+}
+
+// O_DIRECT needs buffers, offsets and sizes aligned to the logical block
+// size of the device. 4 KiB covers the common devices.
+constexpr size_t kDirectIOAlignment{4096};
+
+// Direct files read and write in chunks of this size.
+constexpr size_t kDirectIOBufferSize{1024 * 1024};
+
+size_t AlignDown(size_t n) { return n - n % kDirectIOAlignment; }
+
+size_t AlignUp(size_t n) { return AlignDown(n + kDirectIOAlignment - 1); }
+
+struct FreeDeleter {
+  void operator()(char* p) const noexcept { std::free(p); }
+};
+
+using AlignedBuffer = std::unique_ptr<char, FreeDeleter>;
+
+// "size" must be a multiple of kDirectIOAlignment.
+AlignedBuffer AllocateAligned(size_t size) {
+  auto* p{static_cast<char*>(std::aligned_alloc(kDirectIOAlignment, size))};
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return AlignedBuffer{p};
+}
+
+// Keeps a few buffers of kDirectIOBufferSize around, so that flushes and
+// compactions don't allocate a new one for every file.
+class AlignedBufferPool {
+ public:
+  AlignedBuffer Acquire() {
+    std::lock_guard lock{mutex_};
+    if (free_.empty()) {
+      return AllocateAligned(kDirectIOBufferSize);
+    }
+    auto buf{std::move(free_.back())};
+    free_.pop_back();
+    return buf;
+  }
+
+  void Release(AlignedBuffer buf) {
+    std::lock_guard lock{mutex_};
+    if (buf != nullptr && free_.size() < kMaxFreeBuffers) {
+      free_.push_back(std::move(buf));
+    }
+  }
+
+ private:
+  static constexpr size_t kMaxFreeBuffers{8};
+
+  std::mutex mutex_;
+  std::vector<AlignedBuffer> free_;
+};
+
+// Open with O_DIRECT if the file system supports it. Some (e.g. tmpfs)
+// don't, and there is no page cache to bypass on those anyway.
+int OpenDirect(const std::string& filename, int flags) {
+  int fd{::open(filename.c_str(), flags | O_DIRECT, 0644)};
+  if (fd == -1 && errno == EINVAL) {
+    fd = ::open(filename.c_str(), flags, 0644);
+  }
+  ThrowIfError(fd);
+  return fd;
+}
+
+void PwriteAll(int fd, const char* data, size_t size, size_t offset) {
+  while (size > 0) {
+    auto written{::pwrite(fd, data, size, offset)};
+    ThrowIfError(written);
+    data += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+// File systems that can't preallocate are left alone.
+void FallocateKeepSize(int fd, size_t size) {
+  if (size > 0 && ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) == -1 &&
+      errno != EOPNOTSUPP && errno != ENOSYS) {
+    throw std::system_error(errno, std::generic_category());
+  }
+}
+
+// Without "append", writes start at the beginning of the file and overwrite
+// what is there.
 class PosixWriteOnlyFile : public WriteOnlyIO {
  public:
-  PosixWriteOnlyFile(std::string filename)
-      : fd_{::open(filename.c_str(), O_APPEND | O_WRONLY | O_CREAT, 0644)},
+  PosixWriteOnlyFile(std::string filename, bool append = true)
+      : fd_{::open(filename.c_str(),
+                   (append ? O_APPEND : 0) | O_WRONLY | O_CREAT, 0644)},
         filename_{std::move(filename)} {
     ThrowIfError(fd_);
   }
@@ -41,7 +151,34 @@ class PosixWriteOnlyFile : public WriteOnlyIO {
     ThrowIfError(::write(fd_, data, size));
   }
 
-  void Sync() override { ThrowIfError(::fsync(fd_)); }
+  void WriteV(const std::string_view* parts, size_t num_parts) override {
+    std::vector<iovec> iov;
+    iov.reserve(num_parts);
+    for (size_t i = 0; i < num_parts; ++i) {
+      if (!parts[i].empty()) {
+        iov.push_back({const_cast<char*>(parts[i].data()), parts[i].size()});
+      }
+    }
+
+    // writev() takes at most IOV_MAX parts and may write less than asked.
+    for (size_t first = 0; first < iov.size();) {
+      auto written{::writev(fd_, iov.data() + first,
+                            std::min<size_t>(iov.size() - first, IOV_MAX))};
+      ThrowIfError(written);
+      first = ConsumeIovecs(iov, first, written);
+    }
+  }
+
+  void Sync() override { ThrowIfError(::fdatasync(fd_)); }
+
+  void Allocate(size_t size) override { FallocateKeepSize(fd_, size); }
+
+  void RangeSync(size_t offset, size_t size) override {
+    ThrowIfError(::sync_file_range(fd_, offset, size,
+                                   SYNC_FILE_RANGE_WAIT_BEFORE |
+                                       SYNC_FILE_RANGE_WRITE |
+                                       SYNC_FILE_RANGE_WAIT_AFTER));
+  }
 
   void Close() override {
     if (!closed_) {
@@ -91,6 +228,55 @@ class PosixReadOnlyFile : public ReadOnlyIO {
     }
   }
 
+  // Requests that are adjacent in the file are read with a single
+  // preadv(), whatever order they come in.
+  void MultiRead(ReadRequest* requests, size_t num_requests) override {
+    std::vector<ReadRequest*> sorted;
+    sorted.reserve(num_requests);
+    for (size_t i = 0; i < num_requests; ++i) {
+      requests[i].bytes_read = 0;
+      sorted.push_back(&requests[i]);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const ReadRequest* a, const ReadRequest* b) {
+                return a->offset < b->offset;
+              });
+
+    std::vector<iovec> iov;
+    for (size_t begin = 0, end = 0; begin < sorted.size(); begin = end) {
+      iov.clear();
+      size_t next_offset{sorted[begin]->offset};
+      while (end < sorted.size() && sorted[end]->offset == next_offset &&
+             iov.size() < IOV_MAX) {
+        iov.push_back({sorted[end]->output, sorted[end]->size});
+        next_offset += sorted[end]->size;
+        ++end;
+      }
+
+      size_t bytes_read{0};
+      if (!closed_) {
+        auto ret{::preadv(fd_, iov.data(), iov.size(), sorted[begin]->offset)};
+        ThrowIfError(ret);
+        bytes_read = ret;
+      }
+
+      // A short read usually means the end of the file. Otherwise the rest
+      // is read one request at a time.
+      for (size_t i = begin; i < end; ++i) {
+        auto& request{*sorted[i]};
+        request.bytes_read = std::min(request.size, bytes_read);
+        bytes_read -= request.bytes_read;
+
+        if (request.bytes_read < request.size) {
+          request.bytes_read +=
+              Read(request.output + request.bytes_read,
+                   request.size - request.bytes_read,
+                   request.offset + request.bytes_read);
+        }
+      }
+    }
+  }
+
   void Close() override {
     if (!closed_) {
       closed_ = true;
@@ -114,6 +300,294 @@ class PosixReadOnlyFile : public ReadOnlyIO {
   std::string filename_;
 };
 
+// Maps the whole file at construction. Tables never change once written,
+// so the size is read once. The descriptor is closed right away; the
+// mapping stays valid even if the file is removed.
+class PosixMmapReadOnlyFile : public ReadOnlyIO {
+ public:
+  PosixMmapReadOnlyFile(std::string filename)
+      : filename_{std::move(filename)} {
+    int fd{::open(filename_.c_str(), O_RDONLY)};
+    ThrowIfError(fd);
+
+    struct stat s;
+    if (::fstat(fd, &s) == -1) {
+      int err{errno};
+      ::close(fd);
+      throw std::system_error(err, std::generic_category());
+    }
+    size_ = s.st_size;
+
+    // Empty files can't be mapped. Reads from them return nothing anyway.
+    if (size_ > 0) {
+      void* data{::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0)};
+      int err{errno};
+      ::close(fd);
+      if (data == MAP_FAILED) {
+        throw std::system_error(err, std::generic_category());
+      }
+      data_ = static_cast<const char*>(data);
+    } else {
+      ::close(fd);
+    }
+  }
+
+  PosixMmapReadOnlyFile(const PosixMmapReadOnlyFile&) = delete;
+  PosixMmapReadOnlyFile& operator=(const PosixMmapReadOnlyFile&) = delete;
+
+  PosixMmapReadOnlyFile(PosixMmapReadOnlyFile&&) = delete;
+  PosixMmapReadOnlyFile& operator=(PosixMmapReadOnlyFile&&) = delete;
+
+  ~PosixMmapReadOnlyFile() override {
+    if (data_ != nullptr) {
+      // Ignore errors
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  size_t Read(char* output, size_t size, size_t offset) override {
+    if (data_ == nullptr || offset >= size_) {
+      return 0;
+    }
+
+    size_t read_size{std::min(size, size_ - offset)};
+    std::memcpy(output, data_ + offset, read_size);
+    return read_size;
+  }
+
+  void Close() override {
+    if (data_ != nullptr) {
+      auto* data{const_cast<char*>(data_)};
+      data_ = nullptr;
+      ThrowIfError(::munmap(data, size_));
+    }
+  }
+
+  std::string GetFileName() const noexcept override { return filename_; }
+
+  size_t Size() const override { return size_; }
+
+  const char* MappedData() const noexcept override { return data_; }
+
+ private:
+  const char* data_{nullptr};
+  size_t size_{0};
+  std::string filename_;
+};
+
+// Writes bypass the page cache. Data is collected in an aligned buffer and
+// written out one full buffer at a time. The unaligned tail is written
+// padded with zeros on Sync() and Close(), and the padding is truncated
+// away. It stays in the buffer, so later writes rewrite that last block.
+class PosixDirectWriteOnlyFile : public WriteOnlyIO {
+ public:
+  PosixDirectWriteOnlyFile(std::string filename,
+                           std::shared_ptr<AlignedBufferPool> pool)
+      : fd_{OpenDirect(filename, O_WRONLY | O_CREAT | O_TRUNC)},
+        filename_{std::move(filename)},
+        pool_{std::move(pool)},
+        buf_{pool_->Acquire()} {}
+
+  PosixDirectWriteOnlyFile(const PosixDirectWriteOnlyFile&) = delete;
+  PosixDirectWriteOnlyFile& operator=(const PosixDirectWriteOnlyFile&) =
+      delete;
+
+  PosixDirectWriteOnlyFile(PosixDirectWriteOnlyFile&&) = delete;
+  PosixDirectWriteOnlyFile& operator=(PosixDirectWriteOnlyFile&&) = delete;
+
+  ~PosixDirectWriteOnlyFile() override {
+    if (!closed_) {
+      // Ignore errors
+      try {
+        WriteTail();
+      } catch (const std::system_error&) {
+      }
+      ::close(fd_);
+      pool_->Release(std::move(buf_));
+    }
+  }
+
+  void Write(const char* data, size_t size) override {
+    while (size > 0) {
+      size_t n{std::min(size, kDirectIOBufferSize - buf_size_)};
+      std::memcpy(buf_.get() + buf_size_, data, n);
+      buf_size_ += n;
+      data += n;
+      size -= n;
+
+      if (buf_size_ == kDirectIOBufferSize) {
+        PwriteAll(fd_, buf_.get(), buf_size_, file_offset_);
+        file_offset_ += buf_size_;
+        buf_size_ = 0;
+      }
+    }
+  }
+
+  void Flush() override { WriteTail(); }
+
+  void Sync() override {
+    WriteTail();
+    ThrowIfError(::fdatasync(fd_));
+  }
+
+  void Close() override {
+    if (!closed_) {
+      closed_ = true;
+      WriteTail();
+      pool_->Release(std::move(buf_));
+      ThrowIfError(::close(fd_));
+    }
+  }
+
+  std::string GetFileName() const noexcept override { return filename_; }
+
+  int GetID() const noexcept override { return fd_; }
+
+ private:
+  void WriteTail() {
+    if (buf_size_ == 0) {
+      return;
+    }
+
+    size_t padded_size{AlignUp(buf_size_)};
+    std::memset(buf_.get() + buf_size_, 0, padded_size - buf_size_);
+    PwriteAll(fd_, buf_.get(), padded_size, file_offset_);
+    ThrowIfError(::ftruncate(fd_, file_offset_ + buf_size_));
+  }
+
+  const int fd_;
+  bool closed_{false};
+  std::string filename_;
+
+  std::shared_ptr<AlignedBufferPool> pool_;
+  AlignedBuffer buf_;
+
+  // buf_ holds the data from file_offset_ on, which is always aligned.
+  size_t file_offset_{0};
+  size_t buf_size_{0};
+};
+
+// Reads bypass the page cache. Each read fetches an aligned chunk of
+// kDirectIOBufferSize, so sequential reads (like a compaction scanning its
+// inputs) are served from the buffer most of the time. Reads that don't
+// fit in a chunk get a buffer of their own.
+class PosixDirectReadOnlyFile : public ReadOnlyIO {
+ public:
+  PosixDirectReadOnlyFile(std::string filename,
+                          std::shared_ptr<AlignedBufferPool> pool)
+      : fd_{OpenDirect(filename, O_RDONLY)},
+        filename_{std::move(filename)},
+        pool_{std::move(pool)},
+        buf_{pool_->Acquire()} {
+    struct stat s;
+    if (::fstat(fd_, &s) == -1) {
+      int err{errno};
+      ::close(fd_);
+      pool_->Release(std::move(buf_));
+      throw std::system_error(err, std::generic_category());
+    }
+    size_ = s.st_size;
+  }
+
+  PosixDirectReadOnlyFile(const PosixDirectReadOnlyFile&) = delete;
+  PosixDirectReadOnlyFile& operator=(const PosixDirectReadOnlyFile&) = delete;
+
+  PosixDirectReadOnlyFile(PosixDirectReadOnlyFile&&) = delete;
+  PosixDirectReadOnlyFile& operator=(PosixDirectReadOnlyFile&&) = delete;
+
+  ~PosixDirectReadOnlyFile() override {
+    if (!closed_) {
+      ::close(fd_);
+      pool_->Release(std::move(buf_));
+    }
+  }
+
+  size_t Read(char* output, size_t size, size_t offset) override {
+    std::lock_guard lock{mutex_};
+    if (closed_ || offset >= size_) {
+      return 0;
+    }
+    size = std::min(size, size_ - offset);
+
+    if (offset < buf_offset_ || offset + size > buf_offset_ + buf_size_) {
+      size_t aligned_offset{AlignDown(offset)};
+      size_t aligned_size{AlignUp(offset + size) - aligned_offset};
+
+      if (aligned_size > kDirectIOBufferSize) {
+        auto buf{AllocateAligned(aligned_size)};
+        size_t bytes_read{ReadAligned(buf.get(), aligned_size, aligned_offset)};
+        size = std::min(size, bytes_read - (offset - aligned_offset));
+        std::memcpy(output, buf.get() + offset - aligned_offset, size);
+        return size;
+      }
+
+      // Forget the old contents first in case the read fails.
+      buf_offset_ = aligned_offset;
+      buf_size_ = 0;
+      buf_size_ = ReadAligned(buf_.get(), kDirectIOBufferSize, buf_offset_);
+      if (offset + size > buf_offset_ + buf_size_) {
+        size = buf_offset_ + buf_size_ - offset;
+      }
+    }
+
+    std::memcpy(output, buf_.get() + offset - buf_offset_, size);
+    return size;
+  }
+
+  size_t ReadNoExcept(char* output, size_t size,
+                      size_t offset) noexcept override {
+    try {
+      return Read(output, size, offset);
+    } catch (const std::system_error&) {
+      return 0;
+    }
+  }
+
+  void Close() override {
+    std::lock_guard lock{mutex_};
+    if (!closed_) {
+      closed_ = true;
+      pool_->Release(std::move(buf_));
+      ThrowIfError(::close(fd_));
+    }
+  }
+
+  std::string GetFileName() const noexcept override { return filename_; }
+
+  int GetID() const noexcept override { return fd_; }
+
+  size_t Size() const override { return size_; }
+
+ private:
+  // Read until "size" bytes are in or the end of the file is reached.
+  size_t ReadAligned(char* output, size_t size, size_t offset) {
+    size_t total{0};
+    while (total < size) {
+      auto bytes_read{::pread(fd_, output + total, size - total,
+                              offset + total)};
+      ThrowIfError(bytes_read);
+      if (bytes_read == 0) {
+        break;
+      }
+      total += bytes_read;
+    }
+    return total;
+  }
+
+  const int fd_;
+  bool closed_{false};
+  std::string filename_;
+  size_t size_{0};
+
+  std::shared_ptr<AlignedBufferPool> pool_;
+  std::mutex mutex_;
+  AlignedBuffer buf_;
+
+  // buf_ holds buf_size_ bytes of the file starting at buf_offset_.
+  size_t buf_offset_{0};
+  size_t buf_size_{0};
+};
+
 class PosixEnv : public Env {
  public:
   std::unique_ptr<WriteOnlyIO> MakeWriteOnlyIO(
@@ -126,9 +600,64 @@ class PosixEnv : public Env {
     return std::make_unique<PosixReadOnlyFile>(std::move(filename));
   }
 
+  std::unique_ptr<ReadOnlyIO> MakeMmapReadOnlyIO(
+      std::string filename) const override {
+    return std::make_unique<PosixMmapReadOnlyFile>(std::move(filename));
+  }
+
+  std::unique_ptr<WriteOnlyIO> MakeDirectWriteOnlyIO(
+      std::string filename) const override {
+    return std::make_unique<PosixDirectWriteOnlyFile>(std::move(filename),
+                                                      buffer_pool_);
+  }
+
+  std::unique_ptr<ReadOnlyIO> MakeDirectReadOnlyIO(
+      std::string filename) const override {
+    return std::make_unique<PosixDirectReadOnlyFile>(std::move(filename),
+                                                     buffer_pool_);
+  }
+
+  std::unique_ptr<WriteOnlyIO> ReuseWriteOnlyIO(
+      const std::string& old_filename, std::string filename) override {
+    RenameFile(old_filename, filename);
+    return std::make_unique<PosixWriteOnlyFile>(std::move(filename),
+                                                /*append=*/false);
+  }
+
   void RemoveFile(const std::string& file) override {
     ThrowIfError(::remove(file.c_str()));
   }
+
+  void RenameFile(const std::string& from, const std::string& to) override {
+    ThrowIfError(::rename(from.c_str(), to.c_str()));
+  }
+
+  void SyncDir(const std::string& dirname) override {
+    int fd{::open(dirname.c_str(), O_RDONLY | O_DIRECTORY)};
+    ThrowIfError(fd);
+    if (::fsync(fd) == -1) {
+      int err{errno};
+      ::close(fd);
+      throw std::system_error(err, std::generic_category());
+    }
+    ThrowIfError(::close(fd));
+  }
+
+  bool FileExists(const std::string& file) const override {
+    return ::access(file.c_str(), F_OK) == 0;
+  }
+
+  std::chrono::system_clock::time_point ModificationTime(
+      const std::string& file) const override {
+    struct stat s;
+    ThrowIfError(::stat(file.c_str(), &s));
+    return std::chrono::system_clock::from_time_t(s.st_mtime);
+  }
+
+ private:
+  // Shared with the files, which may outlive the env.
+  std::shared_ptr<AlignedBufferPool> buffer_pool_{
+      std::make_shared<AlignedBufferPool>()};
 };
 
 }  // namespace
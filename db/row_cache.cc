@@ -0,0 +1,86 @@
+#include "row_cache.h"
+
+#include <functional>
+
+namespace mdb {
+
+RowCache::RowCache(size_t capacity) : capacity_{capacity} {}
+
+std::optional<std::string> RowCache::Get(std::string_view key) {
+  std::scoped_lock lock{mutex_};
+  auto entry{entries_.find(std::string{key})};
+  if (entry == entries_.end()) {
+    return std::nullopt;
+  }
+
+  lru_.splice(lru_.begin(), lru_, entry->second);
+  return entry->second->second;
+}
+
+RowCache::Ticket RowCache::GetTicket(std::string_view key) const {
+  std::scoped_lock lock{mutex_};
+  return {epoch_, stripe_versions_[StripeOf(key)]};
+}
+
+void RowCache::Insert(std::string_view key, std::string value,
+                      const Ticket& ticket) {
+  size_t charge{key.size() + value.size()};
+  if (charge > capacity_) {
+    return;
+  }
+
+  std::scoped_lock lock{mutex_};
+  if (ticket.epoch != epoch_ ||
+      ticket.stripe_version != stripe_versions_[StripeOf(key)]) {
+    return;
+  }
+
+  auto entry{entries_.find(std::string{key})};
+  if (entry != entries_.end()) {
+    EraseLocked(entry);
+  }
+
+  lru_.emplace_front(std::string{key}, std::move(value));
+  entries_.emplace(lru_.front().first, lru_.begin());
+  charge_ += charge;
+
+  while (charge_ > capacity_) {
+    EraseLocked(entries_.find(lru_.back().first));
+  }
+}
+
+void RowCache::Erase(std::string_view key) {
+  std::scoped_lock lock{mutex_};
+  stripe_versions_[StripeOf(key)]++;
+
+  auto entry{entries_.find(std::string{key})};
+  if (entry != entries_.end()) {
+    EraseLocked(entry);
+  }
+}
+
+void RowCache::Clear() {
+  std::scoped_lock lock{mutex_};
+  epoch_++;
+  entries_.clear();
+  lru_.clear();
+  charge_ = 0;
+}
+
+size_t RowCache::Charge() const {
+  std::scoped_lock lock{mutex_};
+  return charge_;
+}
+
+size_t RowCache::StripeOf(std::string_view key) {
+  return std::hash<std::string_view>{}(key) % kNumStripes;
+}
+
+void RowCache::EraseLocked(EntryMap::iterator entry) {
+  auto lru_entry{entry->second};
+  charge_ -= lru_entry->first.size() + lru_entry->second.size();
+  entries_.erase(entry);
+  lru_.erase(lru_entry);
+}
+
+}  // namespace mdb
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mdb {
+
+// Caches what DB::Get() found in the tables for recently read keys. Keys
+// that were not found are cached with an empty value, like deleted ones.
+// Entries are charged the size of their key and value, and the least
+// recently used ones are evicted once the total passes the capacity. Safe
+// to use concurrently.
+class RowCache {
+ public:
+  // Taken before a read, and passed to Insert() once the value is known.
+  // Insert() does nothing if the key was invalidated in between.
+  struct Ticket {
+    uint64_t epoch;
+    uint64_t stripe_version;
+  };
+
+  explicit RowCache(size_t capacity);
+
+  RowCache(const RowCache&) = delete;
+  RowCache& operator=(const RowCache&) = delete;
+
+  RowCache(RowCache&&) = delete;
+  RowCache& operator=(RowCache&&) = delete;
+
+  ~RowCache() = default;
+
+  std::optional<std::string> Get(std::string_view key);
+
+  Ticket GetTicket(std::string_view key) const;
+
+  void Insert(std::string_view key, std::string value, const Ticket& ticket);
+
+  // Called after the key was written.
+  void Erase(std::string_view key);
+
+  // Called when any number of keys may have changed.
+  void Clear();
+
+  // The total size of the keys and values in the cache.
+  size_t Charge() const;
+
+ private:
+  // Tickets remember a version per stripe of keys, so that writes to one
+  // key only keep reads of a few others from being cached.
+  static constexpr size_t kNumStripes{64};
+
+  using LruList = std::list<std::pair<std::string, std::string>>;
+  using EntryMap = std::unordered_map<std::string, LruList::iterator>;
+
+  static size_t StripeOf(std::string_view key);
+
+  // Requires mutex_.
+  void EraseLocked(EntryMap::iterator entry);
+
+  const size_t capacity_;
+
+  mutable std::mutex mutex_;
+
+  // Most recently used first.
+  LruList lru_;
+  EntryMap entries_;
+  size_t charge_{0};
+
+  uint64_t epoch_{0};
+  std::array<uint64_t, kNumStripes> stripe_versions_{};
+};
+
+}  // namespace mdb
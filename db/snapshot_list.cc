@@ -0,0 +1,78 @@
+#include "snapshot_list.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace mdb {
+
+const Snapshot* SnapshotList::New(SequenceNumber sequence) {
+  std::scoped_lock lk{mutex_};
+  return &snapshots_.emplace_back(sequence);
+}
+
+void SnapshotList::Release(const Snapshot* snapshot) {
+  std::scoped_lock lk{mutex_};
+
+  auto it{std::find_if(
+      snapshots_.cbegin(), snapshots_.cend(),
+      [snapshot](const Snapshot& live) { return &live == snapshot; })};
+  assert(it != snapshots_.cend());
+
+  if (it != snapshots_.cend()) {
+    snapshots_.erase(it);
+  }
+}
+
+std::vector<SequenceNumber> SnapshotList::Sequences() const {
+  std::vector<SequenceNumber> sequences;
+
+  std::unique_lock lk{mutex_};
+  for (const auto& snapshot : snapshots_) {
+    sequences.push_back(snapshot.Sequence());
+  }
+  lk.unlock();
+
+  std::sort(sequences.begin(), sequences.end());
+  return sequences;
+}
+
+VersionFilter::VersionFilter(std::vector<SequenceNumber> snapshots,
+                             bool drop_deletes)
+    : snapshots_{std::move(snapshots)}, drop_deletes_{drop_deletes} {
+  assert(std::is_sorted(snapshots_.cbegin(), snapshots_.cend()));
+}
+
+size_t VersionFilter::Stripe(SequenceNumber seq) const {
+  // A snapshot sees the versions numbered up to and including its own
+  // sequence number.
+  return std::lower_bound(snapshots_.cbegin(), snapshots_.cend(), seq) -
+         snapshots_.cbegin();
+}
+
+bool VersionFilter::Keep(std::string_view key, SequenceNumber seq,
+                         bool is_delete, bool deleted_by_range) {
+  auto stripe{Stripe(seq)};
+
+  if (!has_key_ || key != key_) {
+    key_ = key;
+    has_key_ = true;
+  } else if (stripe == last_stripe_) {
+    // A newer version hides this one from everyone who could see it.
+    return false;
+  }
+  last_stripe_ = stripe;
+
+  if (deleted_by_range) {
+    return false;
+  }
+
+  // Nobody can see past a delete in the oldest stripe, and there's nothing
+  // older to hide.
+  return !(is_delete && drop_deletes_ && stripe == 0);
+}
+
+bool VersionFilter::KeepRangeTombstone(SequenceNumber seq) const {
+  return !(drop_deletes_ && Stripe(seq) == 0);
+}
+
+}  // namespace mdb
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "snapshot.h"
+#include "types.h"
+
+namespace mdb {
+
+// The live snapshots of a DB. All methods are thread-safe.
+class SnapshotList {
+ public:
+  const Snapshot* New(SequenceNumber sequence);
+
+  // "snapshot" must have come from New() and must not be used afterwards.
+  void Release(const Snapshot* snapshot);
+
+  // The sequence numbers of the live snapshots in ascending order.
+  std::vector<SequenceNumber> Sequences() const;
+
+ private:
+  mutable std::mutex mutex_;
+
+  // A list keeps the addresses of the snapshots stable.
+  std::list<Snapshot> snapshots_;
+};
+
+// Decides which versions of a key are still needed by someone. The
+// snapshots split the sequence numbers into stripes: a stripe is seen by
+// exactly the same snapshots, so only the newest version in each stripe can
+// ever be read.
+class VersionFilter {
+ public:
+  // "snapshots" must be in ascending order. If "drop_deletes" is true, there
+  // is no older data that a delete has to hide.
+  VersionFilter(std::vector<SequenceNumber> snapshots, bool drop_deletes);
+
+  // Stripe 0 is the oldest. Every live snapshot sees it.
+  size_t Stripe(SequenceNumber seq) const;
+
+  // Versions must be passed key by key, from newest to oldest.
+  // "deleted_by_range" means that a range tombstone in the same stripe
+  // deletes the version.
+  bool Keep(std::string_view key, SequenceNumber seq, bool is_delete,
+            bool deleted_by_range);
+
+  bool KeepRangeTombstone(SequenceNumber seq) const;
+
+ private:
+  std::vector<SequenceNumber> snapshots_;
+  bool drop_deletes_;
+
+  std::string key_;
+  bool has_key_{false};
+  size_t last_stripe_{0};
+};
+
+}  // namespace mdb
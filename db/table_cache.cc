@@ -0,0 +1,82 @@
+#include "table_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace mdb {
+
+std::shared_ptr<TableReader> TableCache::Get(size_t table_number,
+                                             const Options& options) {
+  std::unique_lock lock{mutex_};
+  auto entry{entries_.find(table_number)};
+  if (entry != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, entry->second);
+    return entry->second->second;
+  }
+  lock.unlock();
+
+  // Opening builds the index, so it happens without holding the lock. If
+  // another thread opens the same table meanwhile, the first one wins.
+  std::shared_ptr<TableReader> reader{
+      options.table_factory->MakeTableReader(table_number, options)};
+  std::vector<std::shared_ptr<TableReader>> evicted;
+
+  lock.lock();
+  entry = entries_.find(table_number);
+  if (entry != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, entry->second);
+    return entry->second->second;
+  }
+  InsertLocked(table_number, reader, options.max_open_tables, evicted);
+  lock.unlock();
+
+  return reader;
+}
+
+void TableCache::Insert(size_t table_number,
+                        std::shared_ptr<TableReader> reader,
+                        const Options& options) {
+  std::vector<std::shared_ptr<TableReader>> evicted;
+
+  std::unique_lock lock{mutex_};
+  auto entry{entries_.find(table_number)};
+  if (entry != entries_.end()) {
+    evicted.push_back(std::move(entry->second->second));
+    lru_.erase(entry->second);
+    entries_.erase(entry);
+  }
+  InsertLocked(table_number, std::move(reader), options.max_open_tables,
+               evicted);
+}
+
+void TableCache::Erase(size_t table_number) {
+  std::shared_ptr<TableReader> reader;
+
+  std::unique_lock lock{mutex_};
+  auto entry{entries_.find(table_number)};
+  if (entry != entries_.end()) {
+    reader = std::move(entry->second->second);
+    lru_.erase(entry->second);
+    entries_.erase(entry);
+  }
+}
+
+size_t TableCache::Size() const {
+  std::scoped_lock lock{mutex_};
+  return lru_.size();
+}
+
+void TableCache::InsertLocked(
+    size_t table_number, std::shared_ptr<TableReader> reader, size_t capacity,
+    std::vector<std::shared_ptr<TableReader>>& evicted) {
+  lru_.emplace_front(table_number, std::move(reader));
+  entries_[table_number] = lru_.begin();
+
+  while (lru_.size() > std::max<size_t>(capacity, 1)) {
+    evicted.push_back(std::move(lru_.back().second));
+    entries_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+}
+
+}  // namespace mdb
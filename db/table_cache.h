@@ -0,0 +1,60 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "options.h"
+#include "table_reader.h"
+
+namespace mdb {
+
+// Keeps at most Options::max_open_tables table readers open, each with its
+// file and index. Readers are opened on first use, and the least recently
+// used one is closed when the cache is full. A reader that was handed out
+// stays usable for as long as the caller holds on to it.
+class TableCache {
+ public:
+  TableCache() = default;
+
+  TableCache(const TableCache&) = delete;
+  TableCache& operator=(const TableCache&) = delete;
+
+  TableCache(TableCache&&) = delete;
+  TableCache& operator=(TableCache&&) = delete;
+
+  ~TableCache() = default;
+
+  // The reader of the table, opened with the table factory if it isn't
+  // cached. Safe to call concurrently.
+  std::shared_ptr<TableReader> Get(size_t table_number, const Options& options);
+
+  // Cache a reader that already exists, e.g. one for a table that was just
+  // written.
+  void Insert(size_t table_number, std::shared_ptr<TableReader> reader,
+              const Options& options);
+
+  // Forget the table. Called when its file is removed.
+  void Erase(size_t table_number);
+
+  // The number of readers held by the cache.
+  size_t Size() const;
+
+ private:
+  using LruList = std::list<std::pair<size_t, std::shared_ptr<TableReader>>>;
+
+  // Requires mutex_. Evicted readers are moved to "evicted" so that they
+  // can be closed after unlocking.
+  void InsertLocked(size_t table_number, std::shared_ptr<TableReader> reader,
+                    size_t capacity,
+                    std::vector<std::shared_ptr<TableReader>>& evicted);
+
+  mutable std::mutex mutex_;
+
+  // Most recently used first.
+  LruList lru_;
+  std::unordered_map<size_t, LruList::iterator> entries_;
+};
+
+}  // namespace mdb
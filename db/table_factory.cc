@@ -6,35 +6,59 @@
 
 namespace mdb {
 
+namespace {
+
+std::unique_ptr<ReadOnlyIO> OpenTableFile(const Options& options,
+                                          std::string filename) {
+  if (options.use_mmap_reads) {
+    return options.env->MakeMmapReadOnlyIO(std::move(filename));
+  }
+  return options.env->MakeReadOnlyIO(std::move(filename));
+}
+
+std::unique_ptr<WriteOnlyIO> CreateTableFile(const Options& options,
+                                             std::string filename) {
+  if (options.use_direct_io_for_flush_and_compaction) {
+    return options.env->MakeDirectWriteOnlyIO(std::move(filename));
+  }
+  return options.env->MakeWriteOnlyIO(std::move(filename));
+}
+
+}  // namespace
+
 std::unique_ptr<TableReader> UncompressedTableFactory::TableFromMemtable(
-    size_t table_number, const Options& options, const MemTableT& memtable) {
+    size_t table_number, const Options& options, const MemTableT& memtable,
+    const RangeTombstoneList& range_tombstones) {
   UncompressedTableWriter writer{
-      options.env->MakeWriteOnlyIO(util::TableFileName(options, table_number)),
+      CreateTableFile(options, util::TableFileName(options, table_number)),
       options.write_sync, options.block_size, 0};
 
+  for (const auto& tombstone : range_tombstones) {
+    writer.AddRangeTombstone(tombstone.begin, tombstone.end);
+  }
   writer.WriteMemtable(memtable);
 
   return std::make_unique<UncompressedTableReader>(
-      options.env->MakeReadOnlyIO(writer.GetFileName()), writer.GetIndex());
+      OpenTableFile(options, writer.GetFileName()), writer.GetIndex());
 }
 
 std::unique_ptr<TableWriter> UncompressedTableFactory::MakeTableWriter(
     size_t table_number, const Options& options, size_t level) {
   return std::make_unique<UncompressedTableWriter>(
-      options.env->MakeWriteOnlyIO(util::TableFileName(options, table_number)),
+      CreateTableFile(options, util::TableFileName(options, table_number)),
       options.write_sync, options.block_size, level);
 }
 
 std::unique_ptr<TableReader> UncompressedTableFactory::TableReaderFromWriter(
     const TableWriter& writer, const Options& options) {
   return std::make_unique<UncompressedTableReader>(
-      options.env->MakeReadOnlyIO(writer.GetFileName()), writer.GetIndex());
+      OpenTableFile(options, writer.GetFileName()), writer.GetIndex());
 }
 
 std::unique_ptr<TableReader> UncompressedTableFactory::MakeTableReader(
     size_t table_number, const Options& options) {
   return std::make_unique<UncompressedTableReader>(
-      options.env->MakeReadOnlyIO(util::TableFileName(options, table_number)));
+      OpenTableFile(options, util::TableFileName(options, table_number)));
 }
 
 }  // namespace mdb
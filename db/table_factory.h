@@ -23,12 +23,12 @@ class TableFactory {
 
   virtual ~TableFactory() = default;
 
-  // A convenience function that writes an entire memtable
-  // and returns a reader to the new file. The level passed
+  // A convenience function that writes an entire memtable along with its
+  // range tombstones and returns a reader to the new file. The level passed
   // to the ctor of the new table reader is always 0.
   virtual std::unique_ptr<TableReader> TableFromMemtable(
-      size_t table_number, const Options& options,
-      const MemTableT& memtable) = 0;
+      size_t table_number, const Options& options, const MemTableT& memtable,
+      const RangeTombstoneList& range_tombstones) = 0;
 
   // Makes an empty table. The level must be specified.
   virtual std::unique_ptr<TableWriter> MakeTableWriter(size_t table_number,
@@ -48,8 +48,8 @@ class TableFactory {
 class UncompressedTableFactory : public TableFactory {
  public:
   std::unique_ptr<TableReader> TableFromMemtable(
-      size_t table_number, const Options& options,
-      const MemTableT& memtable) override;
+      size_t table_number, const Options& options, const MemTableT& memtable,
+      const RangeTombstoneList& range_tombstones) override;
 
   std::unique_ptr<TableWriter> MakeTableWriter(size_t table_number,
                                                const Options& options,
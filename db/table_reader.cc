@@ -1,9 +1,14 @@
 #include "table_reader.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <string>
 #include <system_error>
 #include <vector>
 
+#include "helpers.h"
+
 namespace mdb {
 
 namespace {
@@ -13,104 +18,290 @@ inline void ThrowIOError() {
   throw std::system_error(5, std::generic_category());
 }
 
+// An entry of a block, parsed in place.
+struct BlockEntry {
+  std::string_view key;
+  SequenceNumber seq;
+  std::string_view value;
+
+  // Bytes taken up by the entry, sizes included.
+  size_t size;
+};
+
+// Parse the entry at "pos" of the block. Throws std::system_error if the
+// entry runs past the end of the block.
+BlockEntry ParseBlockEntry(std::string_view block, size_t pos) {
+  auto read_size{[block](size_t offset) {
+    if (offset > block.size() || block.size() - offset < sizeof(size_t)) {
+      ThrowIOError();
+    }
+    size_t size;
+    std::memcpy(&size, block.data() + offset, sizeof(size_t));
+    return size;
+  }};
+
+  size_t key_size{read_size(pos)};
+  size_t key_pos{pos + sizeof(size_t)};
+  if (key_size > block.size() - key_pos) {
+    ThrowIOError();
+  }
+
+  size_t seq_pos{key_pos + key_size};
+  size_t value_size{read_size(seq_pos + sizeof(size_t))};
+  size_t value_pos{seq_pos + 2 * sizeof(size_t)};
+  if (value_size > block.size() - value_pos) {
+    ThrowIOError();
+  }
+
+  return {block.substr(key_pos, key_size), read_size(seq_pos),
+          block.substr(value_pos, value_size), value_pos + value_size - pos};
+}
+
+// The block at "data", which starts with its size, without that size.
+// Throws std::system_error unless the stored size is "block_size".
+std::string_view CheckBlock(const char* data, size_t block_size) {
+  size_t stored_size;
+  std::memcpy(&stored_size, data, sizeof(size_t));
+  if (stored_size != block_size) {
+    ThrowIOError();
+  }
+  return {data + sizeof(size_t), block_size};
+}
+
+// Leaves nothing to the caller.
+class DefaultMultiLookup : public TableReader::MultiLookup {
+ public:
+  DefaultMultiLookup(TableReader& reader,
+                     const std::vector<std::string_view>& keys,
+                     SequenceNumber snapshot)
+      : reader_{reader}, keys_{keys}, snapshot_{snapshot} {}
+
+  void Finish(std::vector<std::optional<std::string>>& values) override {
+    reader_.MultiValueOf(keys_, snapshot_, values);
+  }
+
+ private:
+  TableReader& reader_;
+  const std::vector<std::string_view>& keys_;
+  SequenceNumber snapshot_;
+};
+
 }  // namespace
 
+std::unique_ptr<TableReader::MultiLookup> TableReader::StartMultiValueOf(
+    const std::vector<std::string_view>& keys, SequenceNumber snapshot) {
+  return std::make_unique<DefaultMultiLookup>(*this, keys, snapshot);
+}
+
+UncompressedTableReader::Iterator::Iterator(
+    UncompressedTableReader& reader, std::shared_ptr<ReadOnlyIO> file)
+    : reader_{&reader},
+      own_file_{std::move(file)},
+      file_{own_file_ != nullptr ? own_file_.get() : reader.file_.get()},
+      block_{reader.index_.cend()} {}
+
+UncompressedTableReader::Iterator UncompressedTableReader::Iterator::Clone()
+    const {
+  Iterator copy{*reader_, own_file_};
+  if (Valid()) {
+    copy.block_ = block_;
+    copy.buf_ = buf_;
+    copy.data_ = data_;
+    if (data_.data() == buf_.data()) {
+      copy.data_ = {copy.buf_.data(), copy.buf_.size()};
+    }
+    copy.pos_ = pos_;
+    copy.ParseEntry();
+  }
+  return copy;
+}
+
+bool UncompressedTableReader::Iterator::Valid() const noexcept {
+  return block_ != reader_->index_.cend();
+}
+
+void UncompressedTableReader::Iterator::SeekToFirst() {
+  LoadBlock(reader_->index_.cbegin());
+}
+
+void UncompressedTableReader::Iterator::Seek(std::string_view key) {
+  // The block that may hold the key is the last one whose first key is
+  // <= key. If there is none, the answer is the first key of the table.
+  auto block{reader_->index_.upper_bound(key)};
+  if (block != reader_->index_.cbegin()) {
+    --block;
+  }
+
+  LoadBlock(block);
+
+  // This walks into the next block at most once, when the key is bigger
+  // than everything in the current one.
+  while (Valid() && Key() < key) {
+    Next();
+  }
+}
+
+void UncompressedTableReader::Iterator::SeekToLast() {
+  if (reader_->index_.empty()) {
+    SetDone();
+    return;
+  }
+
+  LoadBlock(std::prev(reader_->index_.cend()));
+  while (pos_ + entry_size_ < data_.size()) {
+    pos_ += entry_size_;
+    ParseEntry();
+  }
+}
+
+void UncompressedTableReader::Iterator::Next() {
+  assert(Valid());
+
+  pos_ += entry_size_;
+  if (pos_ < data_.size()) {
+    ParseEntry();
+  } else {
+    LoadBlock(std::next(block_));
+  }
+}
+
+std::string_view UncompressedTableReader::Iterator::Key() const noexcept {
+  assert(Valid());
+  return key_;
+}
+
+SequenceNumber UncompressedTableReader::Iterator::Sequence() const noexcept {
+  assert(Valid());
+  return seq_;
+}
+
+std::string_view UncompressedTableReader::Iterator::Value() const noexcept {
+  assert(Valid());
+  return value_;
+}
+
+size_t UncompressedTableReader::Iterator::Position() const {
+  if (!Valid()) {
+    return reader_->file_size_;
+  }
+  return block_->second + sizeof(size_t) + pos_;
+}
+
+void UncompressedTableReader::Iterator::LoadBlock(
+    IndexT::const_iterator block) {
+  // Blocks are never empty, but skip over them just in case.
+  for (block_ = block; Valid(); ++block_) {
+    // The buffer keeps its capacity, so this only allocates when a block
+    // is bigger than any seen before.
+    data_ = reader_->ReadBlock(*file_, block_->second, buf_);
+
+    if (!data_.empty()) {
+      pos_ = 0;
+      ParseEntry();
+      return;
+    }
+  }
+
+  SetDone();
+}
+
+void UncompressedTableReader::Iterator::ParseEntry() {
+  auto entry{ParseBlockEntry(data_, pos_)};
+  key_ = entry.key;
+  seq_ = entry.seq;
+  value_ = entry.value;
+  entry_size_ = entry.size;
+}
+
+void UncompressedTableReader::Iterator::SetDone() {
+  block_ = reader_->index_.cend();
+  data_ = {};
+  buf_.clear();
+  pos_ = 0;
+  entry_size_ = 0;
+  key_ = {};
+  seq_ = 0;
+  value_ = {};
+}
+
+// Adapts Iterator to the TableIterator interface. The current entry is
+// copied into strings that are reused, so this only allocates when an entry
+// is bigger than the ones before it.
 class UncompressedTableReader::UncompressedTableIter
     : public TableIteratorImpl {
  public:
-  UncompressedTableIter(UncompressedTableReader& reader,
-                        IndexT::const_iterator it)
-      : reader_{reader}, it_{it} {
-    if (it != reader_.index_.end()) {
-      JumpToBlock(it_->second);
-      SetCur();
-
-      // index_.end() passed in
-    } else {
-      cur_ = {"", ""};
-      pos_ = reader_.file_->Size();
-    }
+  UncompressedTableIter(UncompressedTableReader& reader, Iterator it)
+      : reader_{reader}, it_{std::move(it)} {
+    SetCur();
   }
 
   ValueType& GetValue() override { return cur_; }
 
-  bool IsDone() override { return it_ == reader_.index_.end(); }
+  SequenceNumber Sequence() const noexcept override {
+    return it_.Valid() ? it_.Sequence() : 0;
+  }
 
-  void Next() override {
-    pos_ += cur_size_;
-    cur_block_pos_ += cur_size_;
+  bool IsDone() override { return !it_.Valid(); }
 
-    assert(cur_block_pos_ <= cur_block_size_);
+  void Next() override {
+    it_.Next();
+    SetCur();
+  }
 
-    if (cur_block_pos_ == cur_block_size_) {
-      it_++;
-      if (!IsDone()) {
-        JumpToBlock(it_->second);
-      }
-    }
+  size_t Position() const noexcept override { return it_.Position(); }
 
-    if (!IsDone()) {
-      SetCur();
-    }
+  void Seek(std::string_view key) override {
+    it_.Seek(key);
+    SetCur();
   }
 
-  size_t Position() const noexcept override { return pos_; }
-
-  int GetFileID() const noexcept { return reader_.file_->GetID(); }
+  void SeekToLast() override {
+    it_.SeekToLast();
+    SetCur();
+  }
 
   bool operator==(const TableIteratorImpl& other) override {
     if (typeid(*this) == typeid(other)) {
       const UncompressedTableIter& other_cast =
           static_cast<const UncompressedTableIter&>(other);
-      return pos_ == other_cast.pos_ && GetFileID() == other_cast.GetFileID();
+      if (&reader_ != &other_cast.reader_ ||
+          it_.Valid() != other_cast.it_.Valid()) {
+        return false;
+      }
+
+      // Comparing against End() is the common case and must stay cheap.
+      return !it_.Valid() || Position() == other_cast.Position();
     }
     return false;
   }
 
   std::shared_ptr<TableIteratorImpl> Clone() override {
-    return std::make_shared<UncompressedTableIter>(reader_, it_);
+    return std::make_shared<UncompressedTableIter>(reader_, it_.Clone());
   }
 
  private:
-  void JumpToBlock(size_t block_loc) {
-    cur_block_pos_ = 0;
-    cur_block_size_ = reader_.ReadSize(block_loc);
-    pos_ = block_loc + sizeof(size_t);
-  }
 
   void SetCur() {
-    size_t key_size{reader_.ReadSize(pos_)};
-    assert(key_size < cur_block_size_);
-
-    cur_.first = reader_.ReadString(key_size, pos_ + sizeof(size_t));
-
-    size_t value_size{reader_.ReadSize(pos_ + key_size + sizeof(size_t))};
-
-    assert(value_size < cur_block_size_);
-    cur_.second =
-        reader_.ReadString(value_size, pos_ + key_size + 2 * sizeof(size_t));
-
-    cur_size_ = key_size + value_size + 2 * sizeof(size_t);
+    if (it_.Valid()) {
+      cur_.first.assign(it_.Key());
+      cur_.second.assign(it_.Value());
+    } else {
+      cur_.first.clear();
+      cur_.second.clear();
+    }
   }
 
   UncompressedTableReader& reader_;
-  IndexT::const_iterator it_;
-
+  Iterator it_;
   ValueType cur_;
-  size_t cur_size_;
-
-  size_t cur_block_size_{0};
-  size_t cur_block_pos_{0};
-
-  size_t pos_{0};
 };
 
 UncompressedTableReader::UncompressedTableReader(
     std::unique_ptr<ReadOnlyIO>&& file)
-    : file_{std::move(file)} {
+    : file_{std::move(file)}, file_size_{file_->Size()} {
   assert(file_ != nullptr);
   size_t offset = sizeof(size_t);
-  while (offset < file_->Size()) {
+  while (offset < file_size_) {
     size_t block_size{ReadSize(offset)};
     size_t key_size{ReadSize(offset + sizeof(size_t))};
     std::string key{ReadString(key_size, offset + 2 * sizeof(size_t))};
@@ -119,61 +310,311 @@ UncompressedTableReader::UncompressedTableReader(
     // Add sizeof(size_t); block_size does not include the size of itself.
     offset += block_size + sizeof(size_t);
   }
+
+  LoadBlockLocs();
+  LoadRangeTombstones();
+  ComputeKeyRange();
+}
+
+UncompressedTableReader::UncompressedTableReader(
+    std::unique_ptr<ReadOnlyIO>&& file, IndexT index)
+    : file_{std::move(file)},
+      file_size_{file_->Size()},
+      index_{std::move(index)} {
+  assert(file_ != nullptr);
+  LoadBlockLocs();
+  LoadRangeTombstones();
+  ComputeKeyRange();
 }
 
 std::optional<std::string> UncompressedTableReader::ValueOf(
-    std::string_view key) {
+    std::string_view key, SequenceNumber snapshot) {
+  // Unused if the file is mapped. Otherwise the block is read with a
+  // single pread and parsed in place.
+  std::vector<char> scratch;
+  auto value{ValueView(key, snapshot, scratch)};
+  if (!value) {
+    return std::nullopt;
+  }
+  return std::string{*value};
+}
+
+std::optional<std::string_view> UncompressedTableReader::ValueView(
+    std::string_view key, SequenceNumber snapshot,
+    std::vector<char>& scratch) {
+  assert(file_ != nullptr);
+  std::optional<std::pair<std::string_view, SequenceNumber>> version;
+
+  // All versions of a key are in the same block.
   auto lwr{index_.upper_bound(key)};
   if (lwr != index_.begin()) {
     --lwr;
-  } else {
-    return std::nullopt;
+    version = SearchBlock(ReadBlock(*file_, lwr->second, scratch), key,
+                          snapshot);
   }
 
-  size_t block_loc{lwr->second};
-  return SearchInBlock(block_loc, key);
+  return ApplyRangeTombstones(key, version, snapshot);
 }
 
-std::optional<std::string> UncompressedTableReader::SearchInBlock(
-    size_t block_loc, std::string_view key_to_find) {
-  assert(file_ != nullptr);
+// Reads every block that holds any of the keys once, along with its size.
+class UncompressedTableReader::BlockMultiLookup : public MultiLookup {
+ public:
+  BlockMultiLookup(UncompressedTableReader& reader,
+                   const std::vector<std::string_view>& keys,
+                   SequenceNumber snapshot)
+      : reader_{reader},
+        keys_{keys},
+        snapshot_{snapshot},
+        key_blocks_(keys.size()) {
+    // The keys are sorted, so keys in the same block are next to each
+    // other.
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      auto lwr{reader_.index_.upper_bound(keys_[i])};
+      if (lwr == reader_.index_.begin()) {
+        continue;
+      }
+      --lwr;
+      if (block_locs_.empty() || block_locs_.back() != lwr->second) {
+        block_locs_.push_back(lwr->second);
+      }
+      key_blocks_[i] = block_locs_.size() - 1;
+    }
+
+    scratch_.resize(block_locs_.size());
+    if (reader_.file_->MappedData() != nullptr) {
+      return;
+    }
+    for (size_t i = 0; i < block_locs_.size(); ++i) {
+      scratch_[i].resize(sizeof(size_t) + reader_.BlockSize(block_locs_[i]));
+      requests_.push_back({reader_.file_.get(), block_locs_[i],
+                           scratch_[i].size(), scratch_[i].data()});
+    }
+  }
+
+  void Finish(std::vector<std::optional<std::string>>& values) override {
+    assert(keys_.size() == values.size());
+
+    std::vector<std::string_view> blocks;
+    for (size_t i = 0; i < block_locs_.size(); ++i) {
+      if (requests_.empty()) {
+        blocks.push_back(
+            reader_.ReadBlock(*reader_.file_, block_locs_[i], scratch_[i]));
+        continue;
+      }
+      if (requests_[i].bytes_read != scratch_[i].size()) {
+        ThrowIOError();
+      }
+      blocks.push_back(
+          CheckBlock(scratch_[i].data(), scratch_[i].size() - sizeof(size_t)));
+    }
+
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      std::optional<std::pair<std::string_view, SequenceNumber>> version;
+      if (key_blocks_[i]) {
+        version = SearchBlock(blocks[*key_blocks_[i]], keys_[i], snapshot_);
+      }
+      values[i].reset();
+      if (auto value{
+              reader_.ApplyRangeTombstones(keys_[i], version, snapshot_)}) {
+        values[i] = std::string{*value};
+      }
+    }
+  }
+
+ private:
+  UncompressedTableReader& reader_;
+  const std::vector<std::string_view>& keys_;
+  SequenceNumber snapshot_;
+
+  std::vector<size_t> block_locs_;
+  std::vector<std::optional<size_t>> key_blocks_;
+  std::vector<std::vector<char>> scratch_;
+};
+
+void UncompressedTableReader::MultiValueOf(
+    const std::vector<std::string_view>& keys, SequenceNumber snapshot,
+    std::vector<std::optional<std::string>>& values) {
+  auto lookup{StartMultiValueOf(keys, snapshot)};
+  auto& requests{lookup->Requests()};
+  if (!requests.empty()) {
+    file_->MultiRead(requests.data(), requests.size());
+  }
+  lookup->Finish(values);
+}
+
+std::unique_ptr<TableReader::MultiLookup>
+UncompressedTableReader::StartMultiValueOf(
+    const std::vector<std::string_view>& keys, SequenceNumber snapshot) {
+  return std::make_unique<BlockMultiLookup>(*this, keys, snapshot);
+}
+
+std::optional<std::string_view> UncompressedTableReader::ApplyRangeTombstones(
+    std::string_view key,
+    std::optional<std::pair<std::string_view, SequenceNumber>> version,
+    SequenceNumber snapshot) const {
+  if (version) {
+    if (util::IsCovered(key, version->second, range_tombstones_, snapshot)) {
+      return "";
+    }
+    return version->first;
+  }
+
+  if (util::IsCovered(key, range_tombstones_, snapshot)) {
+    return "";
+  }
+
+  return std::nullopt;
+}
+
+std::optional<std::pair<std::string_view, SequenceNumber>>
+UncompressedTableReader::SearchBlock(std::string_view block,
+                                     std::string_view key_to_find,
+                                     SequenceNumber snapshot) {
+  for (size_t pos = 0; pos < block.size();) {
+    auto entry{ParseBlockEntry(block, pos)};
+
+    // Versions are ordered from newest to oldest.
+    if (entry.key == key_to_find && entry.seq <= snapshot) {
+      return std::pair{entry.value, entry.seq};
+    } else if (entry.key > key_to_find) {
+      break;
+    }
+    pos += entry.size;
+  }
 
-  size_t block_size;
-  file_->Read(reinterpret_cast<char*>(&block_size), sizeof(size_t), block_loc);
+  return std::nullopt;
+}
 
-  if (block_size > file_->Size() - sizeof(size_t)) {
+size_t UncompressedTableReader::BlockSize(size_t block_loc) const {
+  auto next{
+      std::upper_bound(block_locs_.cbegin(), block_locs_.cend(), block_loc)};
+  size_t block_end{next != block_locs_.cend() ? *next : file_size_};
+  if (block_end > file_size_ || block_loc > block_end ||
+      block_end - block_loc < sizeof(size_t)) {
     ThrowIOError();
   }
+  return block_end - block_loc - sizeof(size_t);
+}
+
+std::string_view UncompressedTableReader::ReadBlock(
+    ReadOnlyIO& file, size_t block_loc, std::vector<char>& scratch) const {
+  size_t block_size{BlockSize(block_loc)};
+  const char* mapped{file.MappedData()};
+  if (mapped != nullptr) {
+    return CheckBlock(mapped + block_loc, block_size);
+  }
 
-  size_t pos{0};
-  block_loc += sizeof(size_t);
+  // The size is read along with the block.
+  scratch.resize(sizeof(size_t) + block_size);
+  if (file.Read(scratch.data(), scratch.size(), block_loc) != scratch.size()) {
+    ThrowIOError();
+  }
+  return CheckBlock(scratch.data(), block_size);
+}
+
+void UncompressedTableReader::LoadBlockLocs() {
+  for (const auto& key_and_loc : index_) {
+    block_locs_.push_back(key_and_loc.second);
+  }
+  std::sort(block_locs_.begin(), block_locs_.end());
+}
 
-  while (pos < block_size) {
-    size_t key_size{ReadSize(block_loc + pos)};
+void UncompressedTableReader::LoadRangeTombstones() {
+  auto block{index_.find("")};
+  if (block == index_.end()) {
+    return;
+  }
+
+  size_t block_loc{block->second};
+  index_.erase(block);
+
+  size_t block_size{ReadSize(block_loc)};
+  size_t key_size{ReadSize(block_loc + sizeof(size_t))};
+  size_t value_size{ReadSize(block_loc + 3 * sizeof(size_t))};
+
+  if (key_size != 0 || value_size > file_size_ ||
+      block_size != value_size + 3 * sizeof(size_t)) {
+    ThrowIOError();
+  }
+
+  auto tombstones{util::ParseRangeTombstones(
+      ReadString(value_size, block_loc + 4 * sizeof(size_t)))};
+  if (!tombstones) {
+    ThrowIOError();
+  }
+
+  range_tombstones_ = std::move(*tombstones);
+}
+
+void UncompressedTableReader::ComputeKeyRange() {
+  if (!index_.empty()) {
+    smallest_key_ = index_.begin()->first;
+    largest_key_ = ReadLastKey();
+  }
+
+  // The end of a range is exclusive, so the range is a little wider than it
+  // needs to be. That only costs an occasional unnecessary lookup.
+  for (const auto& tombstone : range_tombstones_) {
+    if (smallest_key_.empty() || tombstone.begin < smallest_key_) {
+      smallest_key_ = tombstone.begin;
+    }
+    largest_key_ = std::max(largest_key_, tombstone.end);
+  }
+}
+
+std::string UncompressedTableReader::ReadLastKey() {
+  if (index_.empty()) {
+    return "";
+  }
+
+  // Walk the last block; its final key is the largest in the table. Sizes
+  // are checked against the block bounds so that a corrupted table doesn't
+  // fail here. Corruption is reported when the data is actually read.
+  size_t file_size{file_size_};
+  size_t block_loc{index_.rbegin()->second};
+  size_t block_size{ReadSize(block_loc)};
+  size_t pos{block_loc + sizeof(size_t)};
+  size_t block_end{block_size > file_size - pos ? file_size : pos + block_size};
+
+  std::string key;
+
+  while (block_end - pos >= sizeof(size_t)) {
+    size_t key_size{ReadSize(pos)};
     pos += sizeof(size_t);
+    if (key_size > block_end - pos) {
+      break;
+    }
 
-    std::string key{ReadString(key_size, block_loc + pos)};
+    key = ReadString(key_size, pos);
     pos += key_size;
 
-    size_t value_size{ReadSize(block_loc + pos)};
+    // Skip the sequence number.
+    if (block_end - pos < 2 * sizeof(size_t)) {
+      break;
+    }
     pos += sizeof(size_t);
 
-    if (key == key_to_find) {
-      return ReadString(value_size, block_loc + pos);
-    } else {
-      pos += value_size;
+    size_t value_size{ReadSize(pos)};
+    pos += sizeof(size_t);
+    if (value_size > block_end - pos) {
+      break;
     }
+    pos += value_size;
   }
 
-  if (pos > block_size) {
-    ThrowIOError();
-  }
-
-  return std::nullopt;
+  return key;
 }
 
 size_t UncompressedTableReader::ReadSize(size_t offset) {
   size_t size;
+  if (const char* mapped{file_->MappedData()}) {
+    if (offset > file_size_ || file_size_ - offset < sizeof(size_t)) {
+      ThrowIOError();
+    }
+    std::memcpy(&size, mapped + offset, sizeof(size_t));
+    return size;
+  }
+
   size_t bytes_read{
       file_->Read(reinterpret_cast<char*>(&size), sizeof(size_t), offset)};
   if (bytes_read != sizeof(size_t)) {
@@ -183,32 +624,75 @@ size_t UncompressedTableReader::ReadSize(size_t offset) {
 }
 
 std::string UncompressedTableReader::ReadString(size_t size, size_t offset) {
-  std::vector<char> buf;
-  buf.reserve(size);
+  if (const char* mapped{file_->MappedData()}) {
+    if (offset > file_size_ || size > file_size_ - offset) {
+      ThrowIOError();
+    }
+    return std::string{mapped + offset, size};
+  }
 
-  size_t bytes_read{file_->Read(buf.data(), size, offset)};
+  std::string str(size, '\0');
+  size_t bytes_read{file_->Read(str.data(), size, offset)};
   if (bytes_read != size) {
     ThrowIOError();
   }
-  return std::string{buf.data(), size};
+  return str;
+}
+
+UncompressedTableReader::Iterator UncompressedTableReader::NewIterator() {
+  return Iterator{*this};
+}
+
+UncompressedTableReader::Iterator UncompressedTableReader::NewIterator(
+    std::shared_ptr<ReadOnlyIO> file) {
+  return Iterator{*this, std::move(file)};
 }
 
 TableIterator UncompressedTableReader::Begin() {
+  auto it{NewIterator()};
+  it.SeekToFirst();
   return TableIterator(
-      std::make_shared<UncompressedTableIter>(*this, index_.cbegin()));
+      std::make_shared<UncompressedTableIter>(*this, std::move(it)));
 }
 
 TableIterator UncompressedTableReader::End() {
   return TableIterator(
-      std::make_shared<UncompressedTableIter>(*this, index_.cend()));
+      std::make_shared<UncompressedTableIter>(*this, NewIterator()));
 }
 
-size_t UncompressedTableReader::Size() const { return file_->Size(); }
+TableIterator UncompressedTableReader::Seek(std::string_view key) {
+  auto it{NewIterator()};
+  it.Seek(key);
+  return TableIterator(
+      std::make_shared<UncompressedTableIter>(*this, std::move(it)));
+}
+
+TableIterator UncompressedTableReader::SeekToLast() {
+  auto it{NewIterator()};
+  it.SeekToLast();
+  return TableIterator(
+      std::make_shared<UncompressedTableIter>(*this, std::move(it)));
+}
+
+size_t UncompressedTableReader::Size() const { return file_size_; }
 
 std::string UncompressedTableReader::GetFileName() const noexcept {
   return file_->GetFileName();
 }
 
+std::string_view UncompressedTableReader::SmallestKey() const noexcept {
+  return smallest_key_;
+}
+
+std::string_view UncompressedTableReader::LargestKey() const noexcept {
+  return largest_key_;
+}
+
+const RangeTombstoneList& UncompressedTableReader::RangeTombstones()
+    const noexcept {
+  return range_tombstones_;
+}
+
 size_t UncompressedTableReader::GetLevel() const {
   size_t level;
   file_->Read(reinterpret_cast<char*>(&level), sizeof(size_t), 0);
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "file.h"
 #include "iterator.h"
@@ -11,6 +13,31 @@ namespace mdb {
 
 class TableReader {
  public:
+  // A MultiValueOf() whose reads are left to the caller, so that the reads
+  // of several tables can go to Env::MultiRead() together. Perform
+  // Requests(), then call Finish().
+  class MultiLookup {
+   public:
+    MultiLookup() = default;
+
+    MultiLookup(const MultiLookup&) = delete;
+    MultiLookup& operator=(const MultiLookup&) = delete;
+
+    MultiLookup(MultiLookup&&) = delete;
+    MultiLookup& operator=(MultiLookup&&) = delete;
+
+    virtual ~MultiLookup() = default;
+
+    std::vector<ReadRequest>& Requests() noexcept { return requests_; }
+
+    // Fill in "values" like MultiValueOf(). Throws std::system_error if a
+    // read came up short or a block is corrupted.
+    virtual void Finish(std::vector<std::optional<std::string>>& values) = 0;
+
+   protected:
+    std::vector<ReadRequest> requests_;
+  };
+
   TableReader() = default;
 
   TableReader(const TableReader&) = delete;
@@ -21,49 +48,239 @@ class TableReader {
 
   virtual ~TableReader() = default;
 
-  virtual std::optional<std::string> ValueOf(std::string_view key) = 0;
+  // The newest version of the key that is visible at "snapshot". Returns an
+  // empty string if the key is deleted, either by a tombstone for the key
+  // itself or by one of the table's range tombstones.
+  virtual std::optional<std::string> ValueOf(std::string_view key,
+                                             SequenceNumber snapshot) = 0;
+
+  std::optional<std::string> ValueOf(std::string_view key) {
+    return ValueOf(key, kMaxSequenceNumber);
+  }
+
+  // Like ValueOf(), but the value isn't copied out of the table. The view
+  // points into memory that the reader owns, such as a mapped file, or into
+  // "scratch", and is valid for as long as both are.
+  virtual std::optional<std::string_view> ValueView(
+      std::string_view key, SequenceNumber snapshot,
+      std::vector<char>& scratch) {
+    auto value{ValueOf(key, snapshot)};
+    if (!value) {
+      return std::nullopt;
+    }
+    scratch.assign(value->cbegin(), value->cend());
+    return std::string_view{scratch.data(), scratch.size()};
+  }
+
+  // ValueOf() for each of the sorted "keys", into the matching "values".
+  // Tables that read blocks from disk read each block only once.
+  virtual void MultiValueOf(const std::vector<std::string_view>& keys,
+                            SequenceNumber snapshot,
+                            std::vector<std::optional<std::string>>& values) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      values[i] = ValueOf(keys[i], snapshot);
+    }
+  }
+
+  // "keys" must outlive the lookup. By default, nothing is left to the
+  // caller and Finish() calls MultiValueOf().
+  virtual std::unique_ptr<MultiLookup> StartMultiValueOf(
+      const std::vector<std::string_view>& keys, SequenceNumber snapshot);
 
   virtual TableIterator Begin() = 0;
   virtual TableIterator End() = 0;
 
+  // Same as calling Seek()/SeekToLast() on a new iterator.
+  virtual TableIterator Seek(std::string_view key) = 0;
+  virtual TableIterator SeekToLast() = 0;
+
   virtual size_t Size() const = 0;
 
   virtual std::string GetFileName() const noexcept { return ""; }
 
   virtual size_t GetLevel() const = 0;
+
+  // The range of keys stored in this table, including the ranges covered by
+  // its range tombstones. Both are empty if the table has no keys.
+  virtual std::string_view SmallestKey() const noexcept = 0;
+  virtual std::string_view LargestKey() const noexcept = 0;
+
+  // Iterators visit every version of every key, from the newest version to
+  // the oldest. They only visit point entries; range tombstones are exposed
+  // here.
+  virtual const RangeTombstoneList& RangeTombstones() const noexcept = 0;
 };
 
 class UncompressedTableReader : public TableReader {
  public:
+  // A move-only iterator that reads the table one block at a time. Keys and
+  // values are views into the current block, so they are only valid until
+  // the iterator moves. Nothing is allocated per entry, which makes this
+  // the iterator of choice for full scans and compaction. A new iterator is
+  // not positioned.
+  class Iterator {
+   public:
+    // Blocks are read through "file" if given, which must be another
+    // handle to the same table.
+    explicit Iterator(UncompressedTableReader& reader,
+                      std::shared_ptr<ReadOnlyIO> file = nullptr);
+
+    Iterator(const Iterator&) = delete;
+    Iterator& operator=(const Iterator&) = delete;
+
+    Iterator(Iterator&&) = default;
+    Iterator& operator=(Iterator&&) = default;
+
+    ~Iterator() = default;
+
+    // An independent iterator at the same position. This copies the
+    // current block unless the table is memory-mapped.
+    Iterator Clone() const;
+
+    bool Valid() const noexcept;
+
+    void SeekToFirst();
+    void Seek(std::string_view key);
+    void SeekToLast();
+
+    // These require Valid().
+    void Next();
+    std::string_view Key() const noexcept;
+    SequenceNumber Sequence() const noexcept;
+    std::string_view Value() const noexcept;
+
+    // The file offset of the current entry, or the file size if the
+    // iterator is not valid.
+    size_t Position() const;
+
+   private:
+    // Point data_ at the given block and move to its first entry. Throws
+    // std::system_error if the block is corrupted.
+    void LoadBlock(IndexT::const_iterator block);
+    void ParseEntry();
+    void SetDone();
+
+    UncompressedTableReader* reader_;
+    std::shared_ptr<ReadOnlyIO> own_file_;
+    ReadOnlyIO* file_;
+    IndexT::const_iterator block_;
+
+    // The current block. It points into the mapped file if there is one,
+    // and into buf_ otherwise.
+    std::string_view data_;
+    std::vector<char> buf_;
+    size_t pos_{0};
+    size_t entry_size_{0};
+
+    std::string_view key_;
+    SequenceNumber seq_{0};
+    std::string_view value_;
+  };
+
   // Construct the index by reading the file on disk.
   explicit UncompressedTableReader(std::unique_ptr<ReadOnlyIO>&& file);
 
   // Use the passed index instead of constructing it
   // More efficient than the other ctor, but more dangerous - the index
   // must actually reflect the contents on disk!!
-  UncompressedTableReader(std::unique_ptr<ReadOnlyIO>&& file, IndexT index)
-      : file_{std::move(file)}, index_{std::move(index)} {}
+  UncompressedTableReader(std::unique_ptr<ReadOnlyIO>&& file, IndexT index);
+
+  using TableReader::ValueOf;
+
+  std::optional<std::string> ValueOf(std::string_view key,
+                                     SequenceNumber snapshot) override;
+
+  // The block that holds the key is read into "scratch" unless the file is
+  // mapped.
+  std::optional<std::string_view> ValueView(
+      std::string_view key, SequenceNumber snapshot,
+      std::vector<char>& scratch) override;
+
+  // The blocks are read with a single MultiRead().
+  void MultiValueOf(const std::vector<std::string_view>& keys,
+                    SequenceNumber snapshot,
+                    std::vector<std::optional<std::string>>& values) override;
+
+  // One read for each block that holds any of the keys, with its size. No
+  // reads are needed if the file is mapped.
+  std::unique_ptr<MultiLookup> StartMultiValueOf(
+      const std::vector<std::string_view>& keys,
+      SequenceNumber snapshot) override;
+
+  Iterator NewIterator();
 
-  std::optional<std::string> ValueOf(std::string_view key) override;
+  // An iterator that reads blocks through its own handle to the table,
+  // e.g. one that bypasses the page cache.
+  Iterator NewIterator(std::shared_ptr<ReadOnlyIO> file);
 
   TableIterator Begin() override;
   TableIterator End() override;
 
+  TableIterator Seek(std::string_view key) override;
+  TableIterator SeekToLast() override;
+
   size_t Size() const override;
   size_t GetLevel() const override;
 
+  std::string_view SmallestKey() const noexcept override;
+  std::string_view LargestKey() const noexcept override;
+
+  const RangeTombstoneList& RangeTombstones() const noexcept override;
+
  private:
   class UncompressedTableIter;
+  class BlockMultiLookup;
+
+  // The value and sequence number of the newest version of the key that is
+  // visible at "snapshot".
+  // The value is a view into "block".
+  static std::optional<std::pair<std::string_view, SequenceNumber>>
+  SearchBlock(std::string_view block, std::string_view key_to_find,
+              SequenceNumber snapshot);
+
+  // What ValueView() returns, given the version found in the key's block.
+  std::optional<std::string_view> ApplyRangeTombstones(
+      std::string_view key,
+      std::optional<std::pair<std::string_view, SequenceNumber>> version,
+      SequenceNumber snapshot) const;
 
-  std::optional<std::string> SearchInBlock(size_t block_loc,
-                                           std::string_view key_to_find);
+  // Collect where every block starts, the range tombstone block included.
+  // Must be called while the index still holds that block.
+  void LoadBlockLocs();
 
+  // Move the range tombstone block out of the index and into
+  // range_tombstones_, then compute the key range.
+  void LoadRangeTombstones();
+  void ComputeKeyRange();
+
+  // Blocks are stored back to back, so a block ends where the next one
+  // starts, or at the end of the file. Excludes the size stored in front of
+  // the block. Throws std::system_error if the block runs past the file.
+  size_t BlockSize(size_t block_loc) const;
+
+  // The contents of the block at "block_loc" of "file", without its size.
+  // The view points into the mapped file, or into "scratch" if the file
+  // isn't mapped, in which case the block is read with a single pread.
+  // Throws std::system_error if the size stored in the block is wrong.
+  std::string_view ReadBlock(ReadOnlyIO& file, size_t block_loc,
+                             std::vector<char>& scratch) const;
+
+  std::string ReadLastKey();
   std::string ReadString(size_t size, size_t offset);
   size_t ReadSize(size_t offset);
   std::string GetFileName() const noexcept override;
 
   std::unique_ptr<ReadOnlyIO> file_;
+
+  // Tables never change, so this is only looked up once.
+  size_t file_size_;
   IndexT index_;
+
+  // Sorted.
+  std::vector<size_t> block_locs_;
+  RangeTombstoneList range_tombstones_;
+  std::string smallest_key_;
+  std::string largest_key_;
 };
 
 }  // namespace mdb
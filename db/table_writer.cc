@@ -1,5 +1,8 @@
 #include "table_writer.h"
 
+#include <cassert>
+#include <stdexcept>
+
 namespace mdb {
 
 UncompressedTableWriter::UncompressedTableWriter(
@@ -22,20 +25,28 @@ void UncompressedTableWriter::WriteMemtable(const MemTableT& memtable) {
 }
 
 void UncompressedTableWriter::Add(std::string_view key,
-                                  std::string_view value) {
+                                  std::string_view value, SequenceNumber seq) {
   assert(key.size() > 0);
 
-  if (last_key > key) {
+  bool same_key{num_keys_ > 0 && key == last_key};
+  if (last_key > key || (same_key && seq >= last_seq_)) {
     throw std::invalid_argument("Keys must be inserted in sorted order");
   }
 
+  // The index only knows the first key of each block, so all versions of a
+  // key have to stay in one block. A full block is written out once the
+  // next key comes along.
+  if (!same_key && buf_.size() >= block_size_) {
+    FlushBlock();
+  }
+
   last_key = key;
+  last_seq_ = seq;
   num_keys_++;
 
   // Placeholder bytes; we'll put the real size when we flush
   if (buf_.empty()) {
-    size_t size{0};
-    buf_.insert(buf_.end(), &size, &size + sizeof(size_t));
+    util::AddSizeToWritable(0, buf_);
   }
 
   if (!block_marked_) {
@@ -44,14 +55,31 @@ void UncompressedTableWriter::Add(std::string_view key,
   }
 
   util::AddStringToWritable(key, buf_);
+  util::AddSizeToWritable(seq, buf_);
   util::AddStringToWritable(value, buf_);
+}
+
+void UncompressedTableWriter::AddRangeTombstone(std::string_view begin,
+                                                std::string_view end,
+                                                SequenceNumber seq) {
+  assert(begin < end);
 
-  if (buf_.size() >= block_size_) {
-    Flush();
+  if (range_tombstones_written_) {
+    throw std::logic_error("Range tombstones were already written");
   }
+
+  range_tombstones_.push_back({std::string(begin), std::string(end), seq});
 }
 
 void UncompressedTableWriter::Flush() {
+  FlushBlock();
+  FlushRangeTombstones();
+  file_->Flush();
+}
+
+void UncompressedTableWriter::Sync() { file_->Sync(); }
+
+void UncompressedTableWriter::FlushBlock() {
   assert(file_ != nullptr);
 
   if (!buf_.empty()) {
@@ -65,19 +93,59 @@ void UncompressedTableWriter::Flush() {
     *reinterpret_cast<size_t*>(buf_.data()) = buf_.size() - sizeof(size_t);
 
     // Flush everything to disk
-    file_->Write(buf_.data(), buf_.size());
     if (sync_) {
-      file_->Sync();
+      file_->WriteAndSync(buf_.data(), buf_.size());
+    } else {
+      file_->Write(buf_.data(), buf_.size());
     }
 
     buf_.clear();
   }
 }
 
+void UncompressedTableWriter::FlushRangeTombstones() {
+  if (range_tombstones_.empty() || range_tombstones_written_) {
+    return;
+  }
+
+  // The tombstones are stored as the value of a single entry with an empty
+  // key. User keys are never empty, so the reader can tell the block apart
+  // from the data blocks by its first key.
+  std::vector<char> value;
+  for (const auto& tombstone : range_tombstones_) {
+    util::AddRangeTombstoneToWritable(tombstone, value);
+  }
+
+  std::vector<char> block;
+  util::AddSizeToWritable(0, block);
+  util::AddStringToWritable("", block);
+  util::AddSizeToWritable(0, block);
+  util::AddStringToWritable(std::string_view(value.data(), value.size()),
+                            block);
+  *reinterpret_cast<size_t*>(block.data()) = block.size() - sizeof(size_t);
+
+  index_.emplace("", cur_index_);
+  cur_index_ += block.size();
+
+  if (sync_) {
+    file_->WriteAndSync(block.data(), block.size());
+  } else {
+    file_->Write(block.data(), block.size());
+  }
+
+  range_tombstones_written_ = true;
+}
+
 std::string UncompressedTableWriter::GetFileName() const {
   return file_->GetFileName();
 }
 
 size_t UncompressedTableWriter::NumKeys() const noexcept { return num_keys_; }
 
+size_t UncompressedTableWriter::NumRangeTombstones() const noexcept {
+  return range_tombstones_.size();
+}
+
+size_t UncompressedTableWriter::Size() const noexcept { return cur_index_; }
+
 }  // namespace mdb
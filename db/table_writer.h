@@ -32,14 +32,38 @@ class TableWriter {
   // It is the responsibility of the caller to make sure
   // keys are added in SORTED order! The reader is depending
   // on this invariant. This function will throw std::invalid_argument
-  // if this condition is violated
-  virtual void Add(std::string_view key, std::string_view value) = 0;
+  // if this condition is violated. Several versions of a key may be added,
+  // from the highest sequence number to the lowest.
+  virtual void Add(std::string_view key, std::string_view value,
+                   SequenceNumber seq) = 0;
+
+  void Add(std::string_view key, std::string_view value) { Add(key, value, 0); }
+
+  // Range tombstones are buffered and written to a block of their own by the
+  // next call to Flush(), so they may be added in any order. All of them
+  // must be added before that call; std::logic_error is thrown otherwise.
+  virtual void AddRangeTombstone(std::string_view begin, std::string_view end,
+                                 SequenceNumber seq) = 0;
+
+  void AddRangeTombstone(std::string_view begin, std::string_view end) {
+    AddRangeTombstone(begin, end, 0);
+  }
 
   // Note: if you're adding keys manually via Add(), you'll want to call
   // Flush() when you're done to write the last block to disk.
   virtual void Flush() = 0;
 
+  // Make everything that was flushed durable. Needed unless the writer was
+  // made with Options::write_sync.
+  virtual void Sync() = 0;
+
   virtual size_t NumKeys() const noexcept = 0;
+
+  virtual size_t NumRangeTombstones() const noexcept = 0;
+
+  // Number of bytes written to the file so far. Keys that are still
+  // buffered in the current block are not counted.
+  virtual size_t Size() const noexcept = 0;
 };
 
 class UncompressedTableWriter : public TableWriter {
@@ -53,14 +77,31 @@ class UncompressedTableWriter : public TableWriter {
 
   std::string GetFileName() const override;
 
-  void Add(std::string_view key, std::string_view value) override;
+  using TableWriter::Add;
+  using TableWriter::AddRangeTombstone;
+
+  void Add(std::string_view key, std::string_view value,
+           SequenceNumber seq) override;
+
+  void AddRangeTombstone(std::string_view begin, std::string_view end,
+                         SequenceNumber seq) override;
 
   void Flush() override;
 
+  void Sync() override;
+
   size_t NumKeys() const noexcept override;
 
+  size_t NumRangeTombstones() const noexcept override;
+
+  size_t Size() const noexcept override;
+
  private:
+  void FlushBlock();
+  void FlushRangeTombstones();
+
   std::vector<char> buf_;
+  RangeTombstoneList range_tombstones_;
 
   std::unique_ptr<WriteOnlyIO> file_;
   IndexT index_;
@@ -71,8 +112,10 @@ class UncompressedTableWriter : public TableWriter {
   size_t cur_index_{sizeof(size_t)};
   size_t num_keys_{0};
   bool block_marked_{false};
+  bool range_tombstones_written_{false};
 
   std::string last_key = "";
+  SequenceNumber last_seq_{0};
 };
 
 }  // namespace mdb
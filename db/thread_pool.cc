@@ -0,0 +1,43 @@
+#include "thread_pool.h"
+
+#include <cassert>
+
+namespace mdb {
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  assert(num_threads > 0);
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&ThreadPool::Work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  std::unique_lock lk{mutex_};
+  stop_ = true;
+  lk.unlock();
+
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+size_t ThreadPool::NumThreads() const noexcept { return threads_.size(); }
+
+void ThreadPool::Work() {
+  while (true) {
+    std::unique_lock lk{mutex_};
+    cv_.wait(lk, [this] { return stop_ || !tasks_.empty(); });
+    if (tasks_.empty()) {
+      return;
+    }
+
+    auto task{std::move(tasks_.front())};
+    tasks_.pop();
+    lk.unlock();
+
+    task();
+  }
+}
+
+}  // namespace mdb
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mdb {
+
+// A fixed set of threads that run tasks in the order they are submitted.
+class ThreadPool {
+ public:
+  // "num_threads" must be positive.
+  explicit ThreadPool(size_t num_threads);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  // Runs the tasks that were already submitted, then joins the threads.
+  ~ThreadPool();
+
+  // Run "func" on one of the threads. Its result, or the exception it
+  // throws, is passed through the future.
+  template <typename Func>
+  std::future<std::invoke_result_t<std::decay_t<Func>>> Submit(Func&& func) {
+    using Result = std::invoke_result_t<std::decay_t<Func>>;
+
+    // std::function needs a copyable target.
+    auto task{std::make_shared<std::packaged_task<Result()>>(
+        std::forward<Func>(func))};
+    auto result{task->get_future()};
+
+    std::unique_lock lk{mutex_};
+    tasks_.push([task]() { (*task)(); });
+    lk.unlock();
+
+    cv_.notify_one();
+    return result;
+  }
+
+  size_t NumThreads() const noexcept;
+
+ private:
+  void Work();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::queue<std::function<void()>> tasks_;
+  bool stop_{false};
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace mdb
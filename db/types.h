@@ -1,7 +1,9 @@
 #pragma once
 
+#include <limits>
 #include <map>
 #include <string>
+#include <vector>
 
 // Helpful type aliases
 namespace mdb {
@@ -13,4 +15,27 @@ using MemTableT = std::map<std::string, std::string, std::less<>>;
 
 using IndexT = std::map<std::string, size_t, std::less<>>;
 
+// Every write to the DB gets the next sequence number. A read at sequence
+// number S only sees the writes numbered S or lower. Data written without
+// one, e.g. through MemTableT, has sequence number 0.
+using SequenceNumber = size_t;
+
+constexpr SequenceNumber kMaxSequenceNumber{
+    std::numeric_limits<SequenceNumber>::max()};
+
+// Deletes every key in [begin, end). Within a single memtable or table, a
+// tombstone only deletes the versions with a lower sequence number. It
+// deletes every version in older tables.
+struct RangeTombstone {
+  std::string begin;
+  std::string end;
+  SequenceNumber seq{0};
+
+  bool Covers(std::string_view key) const noexcept {
+    return begin <= key && key < end;
+  }
+};
+
+using RangeTombstoneList = std::vector<RangeTombstone>;
+
 };  // namespace mdb
@@ -1,13 +1,23 @@
 #pragma once
 
+#include <condition_variable>
+#include <future>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <thread>
 
+#include "db_iterator.h"
 #include "disk_storage_manager.h"
 #include "log_writer.h"
+#include "memtable.h"
 #include "options.h"
+#include "pinnable_value.h"
+#include "snapshot.h"
+#include "snapshot_list.h"
+#include "thread_pool.h"
 #include "types.h"
 
 namespace mdb {
@@ -16,11 +26,67 @@ class DB {
  public:
   DB(Options options);
 
-  void Put(std::string_view key, std::string_view value);
+  DB(const DB&) = delete;
+  DB& operator=(const DB&) = delete;
 
-  std::string Get(std::string_view key);
+  DB(DB&&) = delete;
+  DB& operator=(DB&&) = delete;
 
-  void Delete(std::string_view key);
+  // Finishes the async calls that were already made, and syncs the log if
+  // it is synced in the background.
+  ~DB();
+
+  void Put(std::string_view key, std::string_view value,
+           const WriteOptions& write_options = {});
+
+  std::string Get(std::string_view key, const ReadOptions& read_options = {});
+
+  // Get() into "value", reusing its capacity.
+  void Get(std::string_view key, std::string& value,
+           const ReadOptions& read_options = {});
+
+  // Get() without copying values out of memory-mapped tables. Values in
+  // the memtable are copied into the buffer of "value".
+  void Get(std::string_view key, PinnableValue& value,
+           const ReadOptions& read_options = {});
+
+  // Get() for every key. The memtable and every table are searched once for
+  // all of the keys, and each block of a table is read once.
+  std::vector<std::string> MultiGet(const std::vector<std::string_view>& keys,
+                                    const ReadOptions& read_options = {});
+
+  void Delete(std::string_view key, const WriteOptions& write_options = {});
+
+  // Like Put() and Get(), but run on Options::async_threads threads that
+  // belong to the DB, so that callers don't block. Calls are started in the
+  // order they are made. The future throws what the call would have thrown.
+  std::future<void> PutAsync(std::string key, std::string value,
+                             const WriteOptions& write_options = {});
+  std::future<std::string> GetAsync(std::string key,
+                                    const ReadOptions& read_options = {});
+
+  // Make every write that returned before this call durable, with
+  // fdatasync(). Writes are not blocked while the log is synced.
+  void SyncWAL();
+
+  // Delete every key in [begin, end). The range is stored as a single
+  // tombstone, so this costs the same as one Delete() no matter how many
+  // keys it covers. "begin" must be non-empty and less than "end".
+  void DeleteRange(std::string_view begin, std::string_view end,
+                   const WriteOptions& write_options = {});
+
+  // Iterate over a consistent view of the database as of this call, or as
+  // of the snapshot in "read_options". See db_iterator.h.
+  DBIterator NewIterator(const ReadOptions& read_options = {});
+
+  // Take a snapshot of the current state. Reads that pass it in ReadOptions
+  // see exactly what was written before this call, no matter what is
+  // written or compacted afterwards. Every snapshot must be released with
+  // ReleaseSnapshot() once it is no longer needed, since it keeps
+  // compactions from discarding the old versions it sees.
+  const Snapshot* GetSnapshot();
+
+  void ReleaseSnapshot(const Snapshot* snapshot);
 
   // Concurrent calls to WaitForOngoingCompaction and the other public
   // methods are safe. However, be aware that if a writer thread A
@@ -32,27 +98,75 @@ class DB {
   void WaitForOngoingCompactions();
 
  private:
-  void PutOrDelete(std::string_view key, std::string_view value);
-  void UpdateMemtable(std::string_view key, std::string_view value);
+  void PutOrDelete(std::string_view key, std::string_view value,
+                   const WriteOptions& write_options);
+  void UpdateMemtable(std::string_view key, std::string_view value,
+                      SequenceNumber seq);
+  void AddRangeTombstoneToMemtable(std::string_view begin,
+                                   std::string_view end, SequenceNumber seq);
+  void FlushMemtableIfFull();
   void ClearMemtable();
 
   void Recover();
-  void LoadLogFile(const std::vector<size_t>& indices);
+  void LoadLogFile(size_t log_number);
+
+  // Remove the log, or keep it for the next one if logs are recycled.
+  void RetireLog(const std::string& fname);
   void InitNextLogWriter();
 
+  // Called with write_mutex_ held after a write logged "size" bytes. Syncs
+  // the log if the write asks for it, or wakes up the background sync once
+  // wal_sync_interval_bytes were logged.
+  void SyncWALIfDue(size_t size, const WriteOptions& write_options);
+  void SyncWALInBackground();
+
+  // SyncWAL() with "durable" true. Otherwise the log is synced with
+  // Options::wal_sync_method.
+  void SyncWAL(bool durable);
+
+  // Called before a low-priority write takes the write mutex.
+  void ThrottleLowPriWrite();
+
+  ThreadPool& AsyncPool();
+
   Options options_;
 
   LogWriter logger_;
 
   std::mutex write_mutex_;
-  std::shared_mutex memtable_mutex_;
+  // Shared with the iterators, which read the memtable in place.
+  std::shared_ptr<std::shared_mutex> memtable_mutex_{
+      std::make_shared<std::shared_mutex>()};
 
   size_t next_log_{0};
+
+  // A retired log that InitNextLogWriter() reuses, if not empty.
+  std::string recycled_log_;
   size_t cache_size_{0};
 
-  MemTableT memtable_;
+  // The sequence number of the last write. Guarded by write_mutex_, and
+  // only changed with memtable_mutex_ held too.
+  SequenceNumber last_sequence_{0};
+
+  // Replaced, not cleared, once it is flushed. Guarded by memtable_mutex_.
+  std::shared_ptr<MemTable> memtable_{std::make_shared<MemTable>()};
+
+  // Bytes logged since the last sync. Guarded by write_mutex_.
+  size_t unsynced_wal_bytes_{0};
+
+  std::thread wal_sync_thread_;
+  std::mutex wal_sync_mutex_;
+  std::condition_variable wal_sync_cv_;
+  bool wal_sync_requested_{false};
+  bool stop_wal_sync_{false};
+
+  SnapshotList snapshots_;
+
+  DiskStorageManager disk_storage_manager_{&snapshots_};
 
-  DiskStorageManager disk_storage_manager_;
+  // Runs the async calls. Started by the first one.
+  std::once_flag async_pool_flag_;
+  std::unique_ptr<ThreadPool> async_pool_;
 };
 
 }  // namespace mdb
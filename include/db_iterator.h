@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "iterator.h"
+#include "table_reader.h"
+#include "types.h"
+
+namespace mdb {
+
+// Iterates over the live keys of the database in sorted order. Older
+// versions of a key, versions newer than the snapshot and deleted keys are
+// skipped.
+//
+// The iterator works on the memtable and tables as they were when it was
+// created. It holds on to those tables, so later writes and compactions
+// don't affect it. A new iterator is not positioned; call Seek() or
+// SeekToFirst() first.
+class DBIterator {
+ public:
+  // "sources" must be ordered from newest to oldest.
+  explicit DBIterator(std::vector<std::shared_ptr<TableReader>> sources,
+                      SequenceNumber snapshot = kMaxSequenceNumber);
+
+  DBIterator(const DBIterator&) = delete;
+  DBIterator& operator=(const DBIterator&) = delete;
+
+  DBIterator(DBIterator&&) = default;
+  DBIterator& operator=(DBIterator&&) = default;
+
+  ~DBIterator() = default;
+
+  // Position the iterator at the first key that is >= "key".
+  void Seek(std::string_view key);
+
+  void SeekToFirst();
+
+  bool Valid() const noexcept;
+
+  // These require Valid().
+  void Next();
+  std::string_view Key() const noexcept;
+  std::string_view Value() const noexcept;
+
+ private:
+  struct Source {
+    std::shared_ptr<TableReader> reader;
+    TableIterator cur;
+    TableIterator end;
+
+    // The keys of this source may be deleted by the first
+    // num_newer_tombstones entries of tombstones_, which come from the
+    // newer sources.
+    size_t num_newer_tombstones;
+  };
+
+  // Rebuild the heap after the sources were repositioned.
+  void Reset();
+
+  // Move the source past the versions that are newer than the snapshot.
+  void SkipInvisible(Source& source);
+
+  // Move to the newest version of the next key that is not deleted. All
+  // sources must already be past the current key.
+  void FindNextVisible();
+
+  // Advance every source that is positioned at "key".
+  void SkipKey(std::string_view key);
+
+  bool HeapGreater(size_t lhs, size_t rhs);
+
+  std::vector<Source> sources_;
+  RangeTombstoneList tombstones_;
+  SequenceNumber snapshot_;
+
+  // Min-heap of the sources that aren't done yet, ordered by their current
+  // key and then from the newest source to the oldest. Each source is at
+  // its newest visible version of the key.
+  std::vector<size_t> heap_;
+
+  bool valid_{false};
+  std::string key_;
+  std::string value_;
+};
+
+}  // namespace mdb
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <chrono>
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "file.h"
 
@@ -22,12 +24,71 @@ class Env {
 
   static std::shared_ptr<Env> CreateDefault();
 
+  // An env that does file IO through io_uring: reads of a MultiRead() batch
+  // share one submission, and WriteAndSync() queues the write and the
+  // fsync together. Returns CreateDefault() where io_uring is unavailable.
+  static std::shared_ptr<Env> CreateIoUring();
+
   virtual std::unique_ptr<WriteOnlyIO> MakeWriteOnlyIO(
       std::string filename) const = 0;
   virtual std::unique_ptr<ReadOnlyIO> MakeReadOnlyIO(
       std::string filename) const = 0;
 
+  // A ReadOnlyIO that memory-maps the file. The file must not change while
+  // it is open. Envs that can't map files return a regular ReadOnlyIO.
+  virtual std::unique_ptr<ReadOnlyIO> MakeMmapReadOnlyIO(
+      std::string filename) const {
+    return MakeReadOnlyIO(std::move(filename));
+  }
+
+  // Files that bypass the page cache (O_DIRECT), for flushes and
+  // compactions. The write-only file truncates what is already there. Envs
+  // without direct IO return regular files.
+  virtual std::unique_ptr<WriteOnlyIO> MakeDirectWriteOnlyIO(
+      std::string filename) const {
+    return MakeWriteOnlyIO(std::move(filename));
+  }
+  virtual std::unique_ptr<ReadOnlyIO> MakeDirectReadOnlyIO(
+      std::string filename) const {
+    return MakeReadOnlyIO(std::move(filename));
+  }
+
+  // Perform all reads, possibly in parallel. Throws std::system_error if
+  // any of them fails. DB::MultiGet() reads the blocks of every table in a
+  // level with one call.
+  virtual void MultiRead(std::vector<ReadRequest>& requests) const {
+    // Hand each run of requests on the same file to that file.
+    for (size_t begin = 0, end = 0; begin < requests.size(); begin = end) {
+      while (end < requests.size() &&
+             requests[end].file == requests[begin].file) {
+        ++end;
+      }
+      requests[begin].file->MultiRead(&requests[begin], end - begin);
+    }
+  }
+
+  // Rename "old_filename" to "filename" and open it for writing from the
+  // start. Old data past what is written is left in place, and writes over
+  // blocks that are already allocated don't change the file size. Envs that
+  // can't do this remove the old file and make a new one.
+  virtual std::unique_ptr<WriteOnlyIO> ReuseWriteOnlyIO(
+      const std::string& old_filename, std::string filename) {
+    RemoveFile(old_filename);
+    return MakeWriteOnlyIO(std::move(filename));
+  }
+
   virtual void RemoveFile(const std::string& filename) = 0;
+
+  // Atomically replace "to" with "from".
+  virtual void RenameFile(const std::string& from, const std::string& to) = 0;
+
+  // Make creations, renames and removals of files in "dirname" durable.
+  virtual void SyncDir(const std::string& dirname) = 0;
+
+  virtual bool FileExists(const std::string& filename) const = 0;
+
+  virtual std::chrono::system_clock::time_point ModificationTime(
+      const std::string& filename) const = 0;
 };
 
 }  // namespace mdb
@@ -1,9 +1,24 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 namespace mdb {
 
+class ReadOnlyIO;
+
+// One read of a batch passed to ReadOnlyIO::MultiRead() or
+// Env::MultiRead(). Only the latter looks at the file.
+struct ReadRequest {
+  ReadOnlyIO* file;
+  size_t offset;
+  size_t size;
+  char* output;
+
+  // Set by MultiRead(). Less than size only at the end of the file.
+  size_t bytes_read{0};
+};
+
 class WriteOnlyIO {
  public:
   WriteOnlyIO() = default;
@@ -17,7 +32,45 @@ class WriteOnlyIO {
   virtual ~WriteOnlyIO() = default;
 
   virtual void Write(const char* data, size_t size) = 0;
+
+  // Write the parts back to back, like a single Write() of all of them
+  // concatenated, but without copying them together first.
+  virtual void WriteV(const std::string_view* parts, size_t num_parts) {
+    std::string data;
+    for (size_t i = 0; i < num_parts; ++i) {
+      data.append(parts[i]);
+    }
+    Write(data.data(), data.size());
+  }
+
+  // Hand buffered writes to the OS, so that readers of the file see them.
+  // Sync() and Close() do this too. Unbuffered files don't need it.
+  virtual void Flush() {}
+
+  // Make the written data durable, along with the metadata needed to read
+  // it back, such as the file size (like fdatasync()). When a write doesn't
+  // grow the file, this needs no file system journal commit.
   virtual void Sync() = 0;
+
+  // Reserve disk space for the first "size" bytes of the file without
+  // changing its size, so that later writes don't have to allocate blocks.
+  // Does nothing where that isn't supported.
+  virtual void Allocate([[maybe_unused]] size_t size) {}
+
+  // Wait for the written pages in [offset, offset + size) to reach the
+  // disk, like sync_file_range(). Unlike Sync(), this flushes neither the
+  // file size nor the disk's write cache. A size of 0 means up to the end of
+  // the file. Defaults to Sync().
+  virtual void RangeSync([[maybe_unused]] size_t offset,
+                         [[maybe_unused]] size_t size) {
+    Sync();
+  }
+
+  // Write() followed by Sync(). Envs that can queue both at once do so.
+  virtual void WriteAndSync(const char* data, size_t size) {
+    Write(data, size);
+    Sync();
+  }
   virtual void Close() = 0;
 
   virtual std::string GetFileName() const noexcept { return ""; }
@@ -44,6 +97,14 @@ class ReadOnlyIO {
     return Read(output, size, offset);
   }
 
+  // Perform all reads. Throws std::system_error if any of them fails.
+  virtual void MultiRead(ReadRequest* requests, size_t num_requests) {
+    for (size_t i = 0; i < num_requests; ++i) {
+      auto& request{requests[i]};
+      request.bytes_read = Read(request.output, request.size, request.offset);
+    }
+  }
+
   virtual void Close() = 0;
 
   virtual std::string GetFileName() const noexcept { return ""; }
@@ -51,6 +112,11 @@ class ReadOnlyIO {
   virtual int GetID() const noexcept { return -1; }
 
   virtual size_t Size() const = 0;
+
+  // The whole file if it is memory-mapped, or nullptr. Reading through the
+  // pointer involves no syscall and no copy. It stays valid until Close()
+  // or destruction.
+  virtual const char* MappedData() const noexcept { return nullptr; }
 };
 
 }  // namespace mdb
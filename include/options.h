@@ -3,11 +3,27 @@
 #include <filesystem>
 #include <memory>
 
+#include "compaction_policy.h"
 #include "env.h"
+#include "row_cache.h"
 #include "table_factory.h"
 
 namespace mdb {
 
+class Snapshot;
+
+// How the log is synced in the background. See Options::wal_sync_method.
+enum class WALSyncMethod {
+  // fdatasync(): the records and the file size reach stable storage.
+  kFdatasync,
+
+  // sync_file_range(): waits for the records to be written out, but flushes
+  // neither the file size nor the disk's write cache. Cheaper, but records
+  // only survive a power loss if they overwrite a recycled log on a disk
+  // without a volatile cache, so it is not durable.
+  kSyncFileRange,
+};
+
 struct Options {
   std::shared_ptr<Env> env{Env::CreateDefault()};
 
@@ -35,6 +51,107 @@ struct Options {
 
   // When level 0 has this many tables, a compaction is triggered
   size_t trigger_compaction_at{4};
+
+  // Decides which tables get merged and when. See compaction_policy.h for
+  // the available styles.
+  std::shared_ptr<CompactionPolicy> compaction_policy{
+      std::make_shared<LeveledCompactionPolicy>()};
+
+  // Compactions into levels > 0 start a new table once the current one
+  // reaches this size. Tables are only split at block boundaries, so they
+  // may be slightly bigger. Level 0 outputs are never split since each
+  // table there is a sorted run of its own.
+  size_t target_file_size{2 * 1024 * 1024};
+
+  // Read tables through Env::MakeMmapReadOnlyIO(). Blocks are parsed in
+  // place, so reads of data in the page cache need no syscall and no copy.
+  // Each table takes up address space equal to its size.
+  bool use_mmap_reads{false};
+
+  // Write new tables and read compaction inputs with direct IO, so that
+  // background work doesn't evict the blocks that reads depend on.
+  bool use_direct_io_for_flush_and_compaction{false};
+
+  // At most this many tables are kept open, each with a file descriptor and
+  // an index in memory. Others are opened when they are read. Iterators
+  // keep the tables they read open until they are destroyed.
+  size_t max_open_tables{1000};
+
+  // Once the manifest grows past this size, it is replaced by a checkpoint
+  // that holds only the live tables.
+  size_t max_manifest_file_size{1024 * 1024};
+
+  // Open tables during recovery, on max_file_opening_threads threads, so
+  // that the first reads don't have to. Tables are opened in the order they
+  // are searched until max_open_tables are open.
+  bool open_tables_on_recovery{false};
+  size_t max_file_opening_threads{16};
+
+  // The checksums of the log are verified on this many threads during
+  // recovery.
+  size_t log_recovery_threads{4};
+
+  // Once a memtable is flushed, reuse its log file for the next log instead
+  // of removing it. Writes then go to blocks that are already allocated,
+  // so synced writes don't update file system metadata.
+  bool recycle_log_files{false};
+
+  // Without write_sync, the log is synced in the background every
+  // wal_sync_interval_ms milliseconds, and once wal_sync_interval_bytes
+  // have been logged since the last sync. 0 turns either trigger off. A
+  // crash loses at most the writes since the last sync. Flushed memtables
+  // are synced before their log is removed, so they never lose writes.
+  size_t wal_sync_interval_ms{0};
+  size_t wal_sync_interval_bytes{0};
+
+  // Used by the background syncs. Syncs that a write waits for, i.e.
+  // write_sync, WriteOptions::sync and DB::SyncWAL(), must be durable and
+  // always use fdatasync().
+  WALSyncMethod wal_sync_method{WALSyncMethod::kFdatasync};
+
+  // Once level 0 has this many tables, low-priority writes wait for the
+  // ongoing compaction before they go ahead. See WriteOptions::low_pri.
+  size_t slowdown_low_pri_writes_at{8};
+
+  // DB::PutAsync() and DB::GetAsync() run on this many threads, which are
+  // started by the first call.
+  size_t async_threads{4};
+
+  // The tables in the first parallel_probe_levels levels that may hold a
+  // key are probed at the same time by Get(), on parallel_probe_threads
+  // threads, so that a read that misses the page cache waits for one disk
+  // read per level rather than one per table. 0 turns this off, 1 probes
+  // level 0 and 2 also probes level 1.
+  size_t parallel_probe_levels{0};
+  size_t parallel_probe_threads{8};
+
+  // If set, Get() looks for keys that aren't in the memtable here before
+  // searching the tables. Reads with a snapshot bypass it.
+  std::shared_ptr<RowCache> row_cache{nullptr};
+};
+
+// Options for a single read.
+struct ReadOptions {
+  // Read as of this snapshot, which must come from DB::GetSnapshot() and
+  // must not be released yet. nullptr reads the latest data.
+  const Snapshot* snapshot{nullptr};
+};
+
+// Options for a single write.
+struct WriteOptions {
+  // Sync the log before the write returns, as if Options::write_sync was
+  // set. If the write fills the memtable, the flushed table is synced
+  // before the log goes away.
+  bool sync{false};
+
+  // Don't log the write. It is lost if the DB goes away before its memtable
+  // is flushed. Meant for loads that can be replayed.
+  bool disable_wal{false};
+
+  // Let compactions catch up before the write goes ahead, so that bulk
+  // writes don't add to the backlog that other writes have to live with.
+  // See Options::slowdown_low_pri_writes_at.
+  bool low_pri{false};
 };
 
 }  // namespace mdb
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace mdb {
+
+// The value that DB::Get() found. When a memory-mapped table holds the
+// value, the view points straight into the table, which is pinned until the
+// value is reset or destroyed. Otherwise the view points into a buffer that
+// is reused from one Get() to the next.
+class PinnableValue {
+ public:
+  PinnableValue() : buffer_{&own_buffer_} {}
+
+  // Use "buffer", which must outlive this object, instead of an internal
+  // one.
+  explicit PinnableValue(std::string* buffer) : buffer_{buffer} {}
+
+  PinnableValue(const PinnableValue&) = delete;
+  PinnableValue& operator=(const PinnableValue&) = delete;
+
+  PinnableValue(PinnableValue&&) = delete;
+  PinnableValue& operator=(PinnableValue&&) = delete;
+
+  ~PinnableValue() = default;
+
+  std::string_view View() const noexcept { return view_; }
+
+  // True if the view points into memory that something else owns, rather
+  // than into the buffer.
+  bool IsPinned() const noexcept { return owner_ != nullptr; }
+
+  // Point at "data", which stays valid for as long as "owner" is held.
+  void Pin(std::string_view data, std::shared_ptr<const void> owner) {
+    view_ = data;
+    owner_ = std::move(owner);
+  }
+
+  // Copy "data" into the buffer, keeping its capacity.
+  void PinSelf(std::string_view data) {
+    buffer_->assign(data);
+    PinSelf();
+  }
+
+  // Point at the buffer, as filled through GetSelf().
+  void PinSelf() {
+    owner_.reset();
+    view_ = *buffer_;
+  }
+
+  std::string* GetSelf() noexcept { return buffer_; }
+
+  void Reset() {
+    owner_.reset();
+    buffer_->clear();
+    view_ = {};
+  }
+
+ private:
+  std::string own_buffer_;
+  std::string* buffer_;
+  std::shared_ptr<const void> owner_;
+  std::string_view view_;
+};
+
+}  // namespace mdb
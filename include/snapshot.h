@@ -0,0 +1,22 @@
+#pragma once
+
+#include "types.h"
+
+namespace mdb {
+
+// A read-only view of the database as of the moment it was taken. Reads
+// that pass it through ReadOptions don't see any later writes. Compactions
+// keep the versions it can see until it is handed back with
+// DB::ReleaseSnapshot().
+class Snapshot {
+ public:
+  explicit Snapshot(SequenceNumber sequence) : sequence_{sequence} {}
+
+  // The sequence number of the last write the snapshot sees.
+  SequenceNumber Sequence() const noexcept { return sequence_; }
+
+ private:
+  SequenceNumber sequence_;
+};
+
+}  // namespace mdb
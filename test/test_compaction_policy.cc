@@ -0,0 +1,179 @@
+#include "compaction_policy.h"
+#include "options.h"
+#include "unit_test_include.h"
+#include "util.h"
+
+using namespace mdb;
+
+BOOST_AUTO_TEST_SUITE(TestCompactionPolicy)
+
+namespace {
+
+// Make a level out of table sizes given newest first. Table numbers count
+// down so that newer tables have higher numbers.
+std::vector<TableSummary> MakeLevel(const std::vector<size_t> &sizes,
+                                    size_t first_number = 100) {
+  std::vector<TableSummary> level;
+  for (size_t i = 0; i < sizes.size(); i++) {
+    level.push_back(
+        {first_number - i, sizes[i], std::chrono::system_clock::now()});
+  }
+  return level;
+}
+
+}  // namespace
+
+/**
+ * Leveled compaction merges all of level 0 into level 1 once enough tables
+ * have piled up.
+ */
+BOOST_AUTO_TEST_CASE(TestLeveledLevelZeroTrigger) {
+  Options opt{.trigger_compaction_at = 3};
+  LeveledCompactionPolicy policy;
+
+  LevelSummary levels{{0, MakeLevel({10, 10})}};
+  BOOST_REQUIRE(!policy.PickCompaction(levels, opt));
+
+  levels[0] = MakeLevel({10, 10, 10});
+  auto task{policy.PickCompaction(levels, opt)};
+
+  BOOST_REQUIRE(task);
+  BOOST_REQUIRE_EQUAL(task->level, 0);
+  BOOST_REQUIRE_EQUAL(task->output_level, 1);
+  BOOST_REQUIRE(task->drop_deletes);
+
+  std::vector<size_t> expected{100, 99, 98};
+  BOOST_TEST_REQUIRE(task->tables == expected,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * Deleted keys must be kept if an older level could still hold the key.
+ */
+BOOST_AUTO_TEST_CASE(TestLeveledKeepsDeletesAboveOlderData) {
+  Options opt{.trigger_compaction_at = 2};
+  LeveledCompactionPolicy policy;
+
+  LevelSummary levels{{0, MakeLevel({10, 10})}, {1, MakeLevel({10}, 50)}};
+  auto task{policy.PickCompaction(levels, opt)};
+
+  BOOST_REQUIRE(task);
+  BOOST_REQUIRE(!task->drop_deletes);
+}
+
+/**
+ * Runs of similar size are merged together, while a much bigger older run is
+ * left alone.
+ */
+BOOST_AUTO_TEST_CASE(TestUniversalSizeRatio) {
+  Options opt{.trigger_compaction_at = 3};
+  UniversalCompactionPolicy policy;
+
+  LevelSummary levels{{0, MakeLevel({10, 10, 20, 1000})}};
+  auto task{policy.PickCompaction(levels, opt)};
+
+  BOOST_REQUIRE(task);
+  BOOST_REQUIRE_EQUAL(task->level, 0);
+  BOOST_REQUIRE_EQUAL(task->output_level, 0);
+  BOOST_REQUIRE(!task->drop_deletes);
+
+  std::vector<size_t> expected{100, 99, 98};
+  BOOST_TEST_REQUIRE(task->tables == expected,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * Nothing happens until the number of sorted runs reaches the trigger.
+ */
+BOOST_AUTO_TEST_CASE(TestUniversalBelowTrigger) {
+  Options opt{.trigger_compaction_at = 4};
+  UniversalCompactionPolicy policy;
+
+  LevelSummary levels{{0, MakeLevel({10, 10, 1000})}};
+  BOOST_REQUIRE(!policy.PickCompaction(levels, opt));
+}
+
+/**
+ * When the newer runs take up too much space relative to the oldest one,
+ * everything is merged and deleted keys can be dropped.
+ */
+BOOST_AUTO_TEST_CASE(TestUniversalSpaceAmplification) {
+  Options opt{.trigger_compaction_at = 2};
+  UniversalCompactionPolicy policy{
+      UniversalCompactionOptions{.max_size_amplification_percent = 50}};
+
+  LevelSummary levels{{0, MakeLevel({30, 40, 100})}};
+  auto task{policy.PickCompaction(levels, opt)};
+
+  BOOST_REQUIRE(task);
+  BOOST_REQUIRE(task->drop_deletes);
+
+  std::vector<size_t> expected{100, 99, 98};
+  BOOST_TEST_REQUIRE(task->tables == expected,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * If no runs are similar in size but there are too many of them, the newest
+ * runs are merged to get back under the limit.
+ */
+BOOST_AUTO_TEST_CASE(TestUniversalTooManyRuns) {
+  Options opt{.trigger_compaction_at = 3};
+  UniversalCompactionPolicy policy;
+
+  LevelSummary levels{{0, MakeLevel({1, 10, 100, 1000, 10000})}};
+  auto task{policy.PickCompaction(levels, opt)};
+
+  BOOST_REQUIRE(task);
+
+  std::vector<size_t> expected{100, 99, 98};
+  BOOST_TEST_REQUIRE(task->tables == expected,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * FIFO compaction never merges. It drops the oldest tables once the total
+ * size goes over the limit.
+ */
+BOOST_AUTO_TEST_CASE(TestFIFOSizeLimit) {
+  Options opt;
+  FIFOCompactionPolicy policy{
+      FIFOCompactionOptions{.max_table_files_size = 100}};
+
+  LevelSummary levels{{0, MakeLevel({40, 40, 20})}};
+  BOOST_REQUIRE(!policy.PickCompaction(levels, opt));
+
+  levels[0] = MakeLevel({40, 40, 20, 30, 10});
+  auto task{policy.PickCompaction(levels, opt)};
+
+  BOOST_REQUIRE(task);
+  BOOST_REQUIRE(task->drop_tables);
+
+  std::vector<size_t> expected{97, 96};
+  BOOST_TEST_REQUIRE(task->tables == expected,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * FIFO compaction drops tables that are older than the TTL.
+ */
+BOOST_AUTO_TEST_CASE(TestFIFOTtl) {
+  Options opt;
+  FIFOCompactionPolicy policy{
+      FIFOCompactionOptions{.ttl = std::chrono::hours(24)}};
+
+  LevelSummary levels{{0, MakeLevel({10, 10, 10})}};
+  BOOST_REQUIRE(!policy.PickCompaction(levels, opt));
+
+  levels[0].back().creation_time -= std::chrono::hours(48);
+  auto task{policy.PickCompaction(levels, opt)};
+
+  BOOST_REQUIRE(task);
+  BOOST_REQUIRE(task->drop_tables);
+
+  std::vector<size_t> expected{98};
+  BOOST_TEST_REQUIRE(task->tables == expected,
+                     boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
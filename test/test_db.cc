@@ -1,4 +1,9 @@
+#include <fstream>
+#include <mutex>
+#include <unordered_set>
+
 #include "db.h"
+#include "helpers.h"
 #include "options.h"
 #include "unit_test_include.h"
 #include "util.h"
@@ -108,6 +113,154 @@ BOOST_AUTO_TEST_CASE(TestPutAndGetAfterCompaction) {
   BOOST_REQUIRE_EQUAL(db.Get("anotherkey"), "anothervalue");
 }
 
+/**
+ * Tables are read through memory-mapped files after flushes, compactions
+ * and recovery.
+ */
+BOOST_AUTO_TEST_CASE(TestMmapReads) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 16,
+              .trigger_compaction_at = 2,
+              .use_mmap_reads = true};
+
+  std::vector<std::pair<std::string, std::string>> key_values{
+      {"hello", "world"},     {"somekey", "somevalue"},
+      {"hello", "overwrite"}, {"anotherkey", "anothervalue"},
+      {"third", "flush"},
+  };
+
+  {
+    DB db{opt};
+    for (const auto& kv : key_values) {
+      db.Put(kv.first, kv.second);
+    }
+    db.Delete("somekey");
+    db.WaitForOngoingCompactions();
+
+    BOOST_REQUIRE_EQUAL(db.Get("hello"), "overwrite");
+    BOOST_REQUIRE_EQUAL(db.Get("somekey"), "");
+    BOOST_REQUIRE_EQUAL(db.Get("anotherkey"), "anothervalue");
+    BOOST_REQUIRE_EQUAL(db.Get("third"), "flush");
+  }
+
+  opt.recovery_mode = true;
+  DB db{std::move(opt)};
+
+  BOOST_REQUIRE_EQUAL(db.Get("hello"), "overwrite");
+  BOOST_REQUIRE_EQUAL(db.Get("somekey"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("anotherkey"), "anothervalue");
+  BOOST_REQUIRE_EQUAL(db.Get("third"), "flush");
+}
+
+/**
+ * Tables written and compacted with direct IO read back the same.
+ */
+BOOST_AUTO_TEST_CASE(TestDirectIO) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 16,
+              .trigger_compaction_at = 2,
+              .use_direct_io_for_flush_and_compaction = true};
+
+  std::vector<std::pair<std::string, std::string>> key_values{
+      {"hello", "world"},     {"somekey", "somevalue"},
+      {"hello", "overwrite"}, {"anotherkey", "anothervalue"},
+      {"third", "flush"},     {"fourth", "flush"},
+  };
+
+  {
+    DB db{opt};
+    for (const auto& kv : key_values) {
+      db.Put(kv.first, kv.second);
+    }
+    db.WaitForOngoingCompactions();
+
+    BOOST_REQUIRE_EQUAL(db.Get("hello"), "overwrite");
+    BOOST_REQUIRE_EQUAL(db.Get("somekey"), "somevalue");
+    BOOST_REQUIRE_EQUAL(db.Get("fourth"), "flush");
+  }
+
+  opt.recovery_mode = true;
+  DB db{std::move(opt)};
+
+  BOOST_REQUIRE_EQUAL(db.Get("hello"), "overwrite");
+  BOOST_REQUIRE_EQUAL(db.Get("anotherkey"), "anothervalue");
+  BOOST_REQUIRE_EQUAL(db.Get("third"), "flush");
+}
+
+/**
+ * The DB works the same on top of the io_uring env, with synced writes.
+ */
+BOOST_AUTO_TEST_CASE(TestIoUringEnv) {
+  Options opt{.env = Env::CreateIoUring(),
+              .write_sync = true,
+              .path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 16,
+              .trigger_compaction_at = 2};
+
+  std::vector<std::pair<std::string, std::string>> key_values{
+      {"hello", "world"},     {"somekey", "somevalue"},
+      {"hello", "overwrite"}, {"anotherkey", "anothervalue"},
+      {"inmemory", "key"},
+  };
+
+  {
+    DB db{opt};
+    for (const auto& kv : key_values) {
+      db.Put(kv.first, kv.second);
+    }
+    db.WaitForOngoingCompactions();
+
+    BOOST_REQUIRE_EQUAL(db.Get("hello"), "overwrite");
+    BOOST_REQUIRE_EQUAL(db.Get("somekey"), "somevalue");
+  }
+
+  opt.recovery_mode = true;
+  DB db{std::move(opt)};
+
+  BOOST_REQUIRE_EQUAL(db.Get("hello"), "overwrite");
+  BOOST_REQUIRE_EQUAL(db.Get("anotherkey"), "anothervalue");
+  BOOST_REQUIRE_EQUAL(db.Get("inmemory"), "key");
+}
+
+/**
+ * Recovery finds the tables and the live log through the manifest. Files
+ * that the DB didn't write are left alone.
+ */
+BOOST_AUTO_TEST_CASE(TestRecoveryFromManifest) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 16,
+              .trigger_compaction_at = 2};
+
+  {
+    DB db{opt};
+    for (int i = 0; i < 20; i++) {
+      db.Put("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    db.Put("inmemory", "key");
+    db.WaitForOngoingCompactions();
+  }
+
+  auto other_file{opt.path / "notes.txt"};
+  std::ofstream{other_file} << "not part of the DB";
+
+  opt.recovery_mode = true;
+  {
+    DB db{opt};
+    for (int i = 0; i < 20; i++) {
+      BOOST_REQUIRE_EQUAL(db.Get("key" + std::to_string(i)),
+                          "value" + std::to_string(i));
+    }
+    BOOST_REQUIRE_EQUAL(db.Get("inmemory"), "key");
+  }
+
+  BOOST_REQUIRE(std::filesystem::exists(other_file));
+  BOOST_REQUIRE(std::filesystem::exists(util::ManifestFileName(opt)));
+}
+
 /**
  * Test that the key/value pairs can be recovered when starting in recovery
  * mode.
@@ -142,4 +295,549 @@ BOOST_AUTO_TEST_CASE(TestRecoveryMode) {
   BOOST_REQUIRE_EQUAL(db.Get("inmemory"), "key");
 }
 
+/**
+ * DeleteRange deletes keys in memory and on disk. Keys written afterwards
+ * are visible again.
+ */
+BOOST_AUTO_TEST_CASE(TestDeleteRange) {
+  Options opt{
+      .path = "./db_e2e_test", .recovery_mode = false, .memtable_max_size = 16};
+  DB db{std::move(opt)};
+
+  db.Put("key1", "value1");
+  db.Put("key2", "value2");
+  db.Put("key3", "value3");
+  db.Put("key4", "value4");
+
+  db.DeleteRange("key2", "key4");
+
+  BOOST_REQUIRE_EQUAL(db.Get("key1"), "value1");
+  BOOST_REQUIRE_EQUAL(db.Get("key2"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("key3"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("key4"), "value4");
+
+  db.Put("key3", "again");
+  BOOST_REQUIRE_EQUAL(db.Get("key3"), "again");
+
+  BOOST_REQUIRE_THROW(db.DeleteRange("b", "a"), std::invalid_argument);
+  BOOST_REQUIRE_THROW(db.DeleteRange("", "a"), std::invalid_argument);
+}
+
+/**
+ * Range tombstones survive a restart, both from the log file and from
+ * tables.
+ */
+BOOST_AUTO_TEST_CASE(TestDeleteRangeRecovery) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 64};
+
+  {
+    DB db{opt};
+    db.Put("a1", "value");
+    db.Put("a2", "value");
+    db.Put("b1", "value");
+    db.Put("b2", "value");
+    // Flushed along with the keys above.
+    db.DeleteRange("a", "b");
+
+    db.Put("c1", "value");
+    db.Put("c2", "value");
+    // Only in the log file.
+    db.DeleteRange("b2", "c2");
+  }
+
+  opt.recovery_mode = true;
+  DB db{std::move(opt)};
+
+  BOOST_REQUIRE_EQUAL(db.Get("a1"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("a2"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("b1"), "value");
+  BOOST_REQUIRE_EQUAL(db.Get("b2"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("c1"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("c2"), "value");
+}
+
+/**
+ * A snapshot keeps seeing the values from when it was taken, through
+ * overwrites, deletes, flushes and compactions.
+ */
+BOOST_AUTO_TEST_CASE(TestSnapshot) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 64,
+              .trigger_compaction_at = 2};
+  DB db{std::move(opt)};
+
+  db.Put("key1", "old");
+  db.Put("key2", "old");
+  db.Put("key3", "old");
+
+  const auto *snapshot{db.GetSnapshot()};
+  ReadOptions read_options{.snapshot = snapshot};
+
+  db.Put("key1", "new");
+  db.Delete("key2");
+  db.DeleteRange("key3", "key4");
+  db.Put("key4", "new");
+
+  auto check{[&]() {
+    BOOST_REQUIRE_EQUAL(db.Get("key1", read_options), "old");
+    BOOST_REQUIRE_EQUAL(db.Get("key2", read_options), "old");
+    BOOST_REQUIRE_EQUAL(db.Get("key3", read_options), "old");
+    BOOST_REQUIRE_EQUAL(db.Get("key4", read_options), "");
+
+    BOOST_REQUIRE_EQUAL(db.Get("key1"), "new");
+    BOOST_REQUIRE_EQUAL(db.Get("key2"), "");
+    BOOST_REQUIRE_EQUAL(db.Get("key3"), "");
+    BOOST_REQUIRE_EQUAL(db.Get("key4"), "new");
+
+    auto it{db.NewIterator(read_options)};
+    std::vector<std::pair<std::string, std::string>> contents;
+    for (it.SeekToFirst(); it.Valid(); it.Next()) {
+      contents.emplace_back(it.Key(), it.Value());
+    }
+
+    std::vector<std::pair<std::string, std::string>> expected{
+        {"key1", "old"}, {"key2", "old"}, {"key3", "old"}};
+    BOOST_TEST_REQUIRE(contents == expected,
+                       boost::test_tools::per_element());
+  }};
+
+  check();
+
+  // Flush several times so that the old versions end up in tables that
+  // get compacted together.
+  for (int i = 0; i < 16; i++) {
+    db.Put("filler" + std::to_string(i), "value");
+  }
+  db.WaitForOngoingCompactions();
+
+  check();
+
+  db.ReleaseSnapshot(snapshot);
+}
+
+/**
+ * Sequence numbers keep growing after a restart, so a new snapshot doesn't
+ * see writes made after it.
+ */
+BOOST_AUTO_TEST_CASE(TestSnapshotAfterRecovery) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 64};
+
+  {
+    DB db{opt};
+    for (int i = 0; i < 8; i++) {
+      db.Put("key" + std::to_string(i), "old");
+    }
+  }
+
+  opt.recovery_mode = true;
+  DB db{std::move(opt)};
+
+  const auto *snapshot{db.GetSnapshot()};
+  for (int i = 0; i < 8; i++) {
+    db.Put("key" + std::to_string(i), "new");
+  }
+
+  for (int i = 0; i < 8; i++) {
+    auto key{"key" + std::to_string(i)};
+    BOOST_REQUIRE_EQUAL(db.Get(key, {.snapshot = snapshot}), "old");
+    BOOST_REQUIRE_EQUAL(db.Get(key), "new");
+  }
+
+  db.ReleaseSnapshot(snapshot);
+}
+
+/**
+ * With recycling, a single log file is reused across memtable flushes. What
+ * is left of older logs in it is not replayed on recovery.
+ */
+BOOST_AUTO_TEST_CASE(TestRecycleLogFiles) {
+  Options opt{.write_sync = true,
+              .path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 256,
+              .recycle_log_files = true};
+
+  auto num_logs{[&opt]() {
+    return std::count_if(
+        std::filesystem::directory_iterator{opt.path},
+        std::filesystem::directory_iterator{}, [](const auto &entry) {
+          return entry.path().filename().string().rfind("log", 0) == 0;
+        });
+  }};
+
+  {
+    DB db{opt};
+    for (int i = 0; i < 100; i++) {
+      db.Put("key" + std::to_string(i), std::string(50, 'a' + i % 26));
+    }
+    db.Put("deleted", "value");
+    db.Delete("deleted");
+    BOOST_REQUIRE_EQUAL(num_logs(), 1);
+  }
+
+  opt.recovery_mode = true;
+  {
+    DB db{opt};
+    for (int i = 0; i < 100; i++) {
+      BOOST_REQUIRE_EQUAL(db.Get("key" + std::to_string(i)),
+                          std::string(50, 'a' + i % 26));
+    }
+    BOOST_REQUIRE_EQUAL(db.Get("deleted"), "");
+
+    db.Put("after", "recovery");
+  }
+
+  {
+    DB db{opt};
+    BOOST_REQUIRE_EQUAL(db.Get("after"), "recovery");
+    BOOST_REQUIRE_EQUAL(db.Get("key99"), std::string(50, 'a' + 99 % 26));
+    BOOST_REQUIRE_EQUAL(num_logs(), 1);
+  }
+}
+
+/**
+ * Writes that are synced in the background, with fdatasync() or with
+ * sync_file_range(), are recovered like any other.
+ */
+BOOST_AUTO_TEST_CASE(TestWALSyncModes) {
+  std::vector<Options> modes{
+      {.path = "./db_e2e_test",
+       .recovery_mode = false,
+       .memtable_max_size = 512,
+       .wal_sync_interval_ms = 1,
+       .wal_sync_interval_bytes = 100},
+      {.path = "./db_e2e_test",
+       .recovery_mode = false,
+       .memtable_max_size = 512,
+       .recycle_log_files = true,
+       .wal_sync_interval_bytes = 100,
+       .wal_sync_method = WALSyncMethod::kSyncFileRange}};
+
+  for (auto opt : modes) {
+    {
+      DB db{opt};
+      for (int i = 0; i < 50; i++) {
+        db.Put("key" + std::to_string(i), "value" + std::to_string(i));
+        if (i % 10 == 0) {
+          db.SyncWAL();
+        }
+      }
+    }
+
+    opt.recovery_mode = true;
+    DB db{opt};
+    for (int i = 0; i < 50; i++) {
+      BOOST_REQUIRE_EQUAL(db.Get("key" + std::to_string(i)),
+                          "value" + std::to_string(i));
+    }
+  }
+}
+
+/**
+ * Writes that skip the log are only recovered once their memtable was
+ * flushed. Synced and low-priority writes are recovered like any other.
+ */
+BOOST_AUTO_TEST_CASE(TestWriteOptions) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 256,
+              .trigger_compaction_at = 2,
+              .slowdown_low_pri_writes_at = 1};
+
+  {
+    DB db{opt};
+    for (int i = 0; i < 50; i++) {
+      db.Put("lowpri" + std::to_string(i), "value", {.low_pri = true});
+    }
+    db.Put("synced", "value", {.sync = true});
+    db.Delete("lowpri0", {.sync = true, .low_pri = true});
+    db.DeleteRange("lowpri1", "lowpri2", {.disable_wal = true});
+    db.Put("unlogged", "value", {.disable_wal = true});
+    db.WaitForOngoingCompactions();
+  }
+
+  opt.recovery_mode = true;
+  DB db{opt};
+  BOOST_REQUIRE_EQUAL(db.Get("synced"), "value");
+  BOOST_REQUIRE_EQUAL(db.Get("lowpri0"), "");
+  BOOST_REQUIRE_EQUAL(db.Get("lowpri10"), "value");
+  BOOST_REQUIRE_EQUAL(db.Get("lowpri49"), "value");
+  BOOST_REQUIRE_EQUAL(db.Get("unlogged"), "");
+}
+
+/**
+ * Many async calls can be in flight on a few threads. Failures come out of
+ * the future.
+ */
+BOOST_AUTO_TEST_CASE(TestAsync) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 1024,
+              .async_threads = 2};
+  DB db{opt};
+
+  std::vector<std::future<void>> puts;
+  for (int i = 0; i < 1000; i++) {
+    puts.push_back(
+        db.PutAsync("key" + std::to_string(i), "value" + std::to_string(i)));
+  }
+  for (auto &put : puts) {
+    put.get();
+  }
+
+  std::vector<std::future<std::string>> gets;
+  for (int i = 0; i < 1000; i++) {
+    gets.push_back(db.GetAsync("key" + std::to_string(i)));
+  }
+  for (int i = 0; i < 1000; i++) {
+    BOOST_REQUIRE_EQUAL(gets[i].get(), "value" + std::to_string(i));
+  }
+
+  auto failed{db.PutAsync("", "value")};
+  BOOST_REQUIRE_THROW(failed.get(), std::invalid_argument);
+}
+
+/**
+ * MultiGet() returns what Get() returns for each key, in the order the keys
+ * were passed, for keys in the memtable and in tables alike. The io_uring
+ * env submits the block reads of each level together.
+ */
+BOOST_AUTO_TEST_CASE(TestMultiGet) {
+  for (const auto &env : {Env::CreateDefault(), Env::CreateIoUring()}) {
+    Options opt{.env = env,
+                .path = "./db_e2e_test",
+                .recovery_mode = false,
+                .memtable_max_size = 128};
+    DB db{opt};
+
+    for (int i = 0; i < 100; i++) {
+      db.Put("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    db.Delete("key5");
+    db.DeleteRange("key7", "key8");
+    db.Put("key99", "newest");
+
+    std::vector<std::string> key_strings{"key99", "key5",  "key1", "key70",
+                                         "key1",  "other", "key42"};
+    std::vector<std::string_view> keys{key_strings.cbegin(),
+                                       key_strings.cend()};
+
+    auto values{db.MultiGet(keys)};
+    BOOST_REQUIRE_EQUAL(values.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      BOOST_REQUIRE_EQUAL(values[i], db.Get(keys[i]));
+    }
+    BOOST_REQUIRE_EQUAL(values[0], "newest");
+    BOOST_REQUIRE_EQUAL(values[1], "");
+    BOOST_REQUIRE_EQUAL(values[3], "");
+    BOOST_REQUIRE_EQUAL(values[6], "value42");
+  }
+}
+
+/**
+ * Reads through the row cache see every write, whether the cached value
+ * came from a table or was not found.
+ */
+BOOST_AUTO_TEST_CASE(TestRowCache) {
+  auto row_cache{std::make_shared<RowCache>(1024 * 1024)};
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 64,
+              .trigger_compaction_at = 2,
+              .row_cache = row_cache};
+  DB db{opt};
+
+  for (int i = 0; i < 20; i++) {
+    db.Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  // A compaction clears the cache once it is done.
+  db.WaitForOngoingCompactions();
+
+  for (int round = 0; round < 2; round++) {
+    BOOST_REQUIRE_EQUAL(db.Get("key0"), "value0");
+    BOOST_REQUIRE_EQUAL(db.Get("missing"), "");
+  }
+  BOOST_REQUIRE_GT(row_cache->Charge(), 0);
+
+  db.Put("key0", "new");
+  db.Put("missing", "found");
+  for (int i = 0; i < 20; i++) {
+    db.Put("filler" + std::to_string(i), "value");
+  }
+  db.WaitForOngoingCompactions();
+  BOOST_REQUIRE_EQUAL(db.Get("key0"), "new");
+  BOOST_REQUIRE_EQUAL(db.Get("missing"), "found");
+
+  BOOST_REQUIRE_EQUAL(db.Get("key1"), "value1");
+  db.DeleteRange("key1", "key2");
+  for (int i = 0; i < 20; i++) {
+    db.Put("filler" + std::to_string(i), "other");
+  }
+  BOOST_REQUIRE_EQUAL(db.Get("key1"), "");
+}
+
+BOOST_AUTO_TEST_CASE(TestGetIntoBuffer) {
+  for (bool mmap : {false, true}) {
+    Options opt{.path = "./db_e2e_test",
+                .recovery_mode = false,
+                .memtable_max_size = 64,
+                .trigger_compaction_at = 2,
+                .use_mmap_reads = mmap};
+    DB db{opt};
+
+    std::string large(4096, 'x');
+    db.Put("large", large);
+    for (int i = 0; i < 20; i++) {
+      db.Put("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    db.WaitForOngoingCompactions();
+    db.Put("memtable", "hit");
+
+    std::string value;
+    db.Get("large", value);
+    BOOST_REQUIRE_EQUAL(value, large);
+
+    /** The buffer keeps its capacity from one call to the next. */
+    auto* data{value.data()};
+    db.Get("key1", value);
+    BOOST_REQUIRE_EQUAL(value, "value1");
+    db.Get("memtable", value);
+    BOOST_REQUIRE_EQUAL(value, "hit");
+    BOOST_REQUIRE_EQUAL(static_cast<void*>(value.data()), data);
+    db.Get("missing", value);
+    BOOST_REQUIRE_EQUAL(value, "");
+
+    PinnableValue pinned;
+    db.Get("large", pinned);
+    BOOST_REQUIRE_EQUAL(pinned.View(), large);
+    BOOST_REQUIRE_EQUAL(pinned.IsPinned(), true);
+    db.Get("memtable", pinned);
+    BOOST_REQUIRE_EQUAL(pinned.View(), "hit");
+    BOOST_REQUIRE_EQUAL(pinned.IsPinned(), false);
+
+    /** A pinned value outlives the table it points into. */
+    db.Get("large", pinned);
+    db.Delete("large");
+    for (int i = 0; i < 40; i++) {
+      db.Put("filler" + std::to_string(i), "value");
+    }
+    db.WaitForOngoingCompactions();
+    BOOST_REQUIRE_EQUAL(pinned.View(), large);
+    BOOST_REQUIRE_EQUAL(db.Get("large"), "");
+  }
+}
+
+/**
+ * A flushed memtable's table and manifest edit are synced before its log is
+ * removed. Without that, the log is never synced in the first case, and in
+ * the second a synced write that fills the memtable would lose the log it
+ * was synced to.
+ */
+BOOST_AUTO_TEST_CASE(TestFlushSyncsBeforeRemovingLog) {
+  for (bool sync : {false, true}) {
+    auto env{std::make_shared<EnvMock>()};
+    std::mutex mutex;
+    std::vector<std::string> events;
+    env->on_event = [&mutex, &events](const std::string &event) {
+      std::scoped_lock lk{mutex};
+      events.push_back(event);
+    };
+
+    Options opt{.env = env,
+                .path = "./db_e2e_test",
+                .recovery_mode = false,
+                .memtable_max_size = 64,
+                .trigger_compaction_at = 100};
+    {
+      DB db{opt};
+      for (int i = 0; i < 20; i++) {
+        db.Put("key" + std::to_string(i), "value" + std::to_string(i),
+               {.sync = sync});
+      }
+    }
+
+    std::scoped_lock lk{mutex};
+    size_t num_removed_logs{0};
+    bool log_synced{false};
+    bool table_synced{false};
+    bool manifest_synced{false};
+    for (const auto &event : events) {
+      auto is{[&event](std::string_view action, std::string_view file) {
+        return event.rfind(action, 0) == 0 &&
+               event.find(file) != std::string::npos;
+      }};
+      if (is("sync", "log")) {
+        log_synced = true;
+      } else if (is("sync", ".mdb")) {
+        table_synced = true;
+      } else if (is("sync", "manifest")) {
+        manifest_synced = table_synced;
+      } else if (is("remove", "log")) {
+        BOOST_REQUIRE(table_synced && manifest_synced);
+        BOOST_REQUIRE_EQUAL(log_synced, sync);
+        log_synced = table_synced = manifest_synced = false;
+        num_removed_logs++;
+      }
+    }
+    BOOST_REQUIRE_GE(num_removed_logs, 2);
+  }
+}
+
+/**
+ * Compaction outputs and the edit that replaces the inputs are synced before
+ * any input table is removed.
+ */
+BOOST_AUTO_TEST_CASE(TestCompactionSyncsBeforeRemovingInputs) {
+  auto env{std::make_shared<EnvMock>()};
+  std::mutex mutex;
+  std::vector<std::string> events;
+  env->on_event = [&mutex, &events](const std::string &event) {
+    std::scoped_lock lk{mutex};
+    events.push_back(event);
+  };
+
+  Options opt{.env = env,
+              .path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 64,
+              .trigger_compaction_at = 2};
+  DB db{opt};
+  for (int i = 0; i < 40; i++) {
+    db.Put("key" + std::to_string(i % 10), "value" + std::to_string(i));
+    // Flushes must not sync tables in the middle of a compaction.
+    db.WaitForOngoingCompactions();
+  }
+
+  std::scoped_lock lk{mutex};
+  std::unordered_set<std::string> synced_tables;
+  size_t num_removed_tables{0};
+  bool manifest_synced{false};
+  for (const auto &event : events) {
+    auto is{[&event](std::string_view action, std::string_view file) {
+      return event.rfind(action, 0) == 0 &&
+             event.find(file) != std::string::npos;
+    }};
+    if (is("sync", ".mdb")) {
+      synced_tables.insert(event.substr(event.find(' ') + 1));
+      manifest_synced = false;
+    } else if (is("sync", "manifest")) {
+      manifest_synced = true;
+    } else if (is("remove", ".mdb")) {
+      BOOST_REQUIRE(manifest_synced);
+      num_removed_tables++;
+    }
+  }
+  BOOST_REQUIRE_GE(num_removed_tables, 2);
+  for (const auto &[filename, contents] : env->files) {
+    if (filename.find(".mdb") != std::string::npos) {
+      BOOST_REQUIRE(synced_tables.count(filename));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
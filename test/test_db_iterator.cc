@@ -0,0 +1,152 @@
+#include <thread>
+
+#include "db.h"
+#include "db_iterator.h"
+#include "memtable_reader.h"
+#include "unit_test_include.h"
+#include "util.h"
+
+using namespace mdb;
+
+BOOST_AUTO_TEST_SUITE(TestDBIterator)
+
+namespace {
+
+using KeyValues = std::vector<std::pair<std::string, std::string>>;
+
+KeyValues ReadAll(DBIterator &it) {
+  KeyValues key_values;
+  for (; it.Valid(); it.Next()) {
+    key_values.emplace_back(it.Key(), it.Value());
+  }
+  return key_values;
+}
+
+}  // namespace
+
+/**
+ * Newer sources shadow older ones, and deleted keys are skipped. A range
+ * tombstone deletes keys in older sources but not the keys stored next to
+ * it.
+ */
+BOOST_AUTO_TEST_CASE(TestMergeSources) {
+  std::vector<std::shared_ptr<TableReader>> sources{
+      std::make_shared<MemTableReader>(
+          MemTableT{{"b", "new"}, {"c", ""}, {"f", "new"}},
+          RangeTombstoneList{{"e", "g"}}),
+      std::make_shared<MemTableReader>(
+          MemTableT{{"a", "1"}, {"b", "2"}, {"c", "3"}, {"e", "5"}},
+          RangeTombstoneList{}),
+  };
+
+  DBIterator it{std::move(sources)};
+  BOOST_REQUIRE(!it.Valid());
+
+  it.SeekToFirst();
+  KeyValues expected{{"a", "1"}, {"b", "new"}, {"f", "new"}};
+  BOOST_TEST_REQUIRE(ReadAll(it) == expected,
+                     boost::test_tools::per_element());
+
+  it.Seek("bb");
+  expected = {{"f", "new"}};
+  BOOST_TEST_REQUIRE(ReadAll(it) == expected,
+                     boost::test_tools::per_element());
+
+  it.Seek("g");
+  BOOST_REQUIRE(!it.Valid());
+}
+
+/**
+ * The iterator merges the memtable with tables in every level.
+ */
+BOOST_AUTO_TEST_CASE(TestScanAfterCompaction) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 16,
+              .trigger_compaction_at = 2};
+  DB db{std::move(opt)};
+
+  db.Put("key1", "value1");
+  db.Put("key2", "value2");
+  db.Put("key3", "value3");
+  db.WaitForOngoingCompactions();
+
+  db.Put("key2", "overwrite");
+  db.Delete("key3");
+  db.Put("key4", "value4");
+
+  auto it{db.NewIterator()};
+  it.Seek("key2");
+
+  KeyValues expected{{"key2", "overwrite"}, {"key4", "value4"}};
+  BOOST_TEST_REQUIRE(ReadAll(it) == expected,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * Writes, flushes and compactions that happen after the iterator is created
+ * are not visible through it.
+ */
+BOOST_AUTO_TEST_CASE(TestPinnedView) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 16,
+              .trigger_compaction_at = 2};
+  DB db{std::move(opt)};
+
+  db.Put("key1", "value1");
+  db.Put("key2", "value2");
+
+  auto it{db.NewIterator()};
+
+  db.Put("key1", "overwrite");
+  db.DeleteRange("key2", "key3");
+  db.Put("key3", "value3");
+  db.Put("key4", "value4");
+  db.WaitForOngoingCompactions();
+
+  it.SeekToFirst();
+  KeyValues expected{{"key1", "value1"}, {"key2", "value2"}};
+  BOOST_TEST_REQUIRE(ReadAll(it) == expected,
+                     boost::test_tools::per_element());
+
+  auto new_it{db.NewIterator()};
+  new_it.SeekToFirst();
+  expected = {{"key1", "overwrite"}, {"key3", "value3"}, {"key4", "value4"}};
+  BOOST_TEST_REQUIRE(ReadAll(new_it) == expected,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * The iterator reads the memtable in place. Writes made by another thread
+ * while it is read don't show up in it, and it can still be read once the
+ * memtable is flushed.
+ */
+BOOST_AUTO_TEST_CASE(TestScanWhileWriting) {
+  Options opt{.path = "./db_e2e_test",
+              .recovery_mode = false,
+              .memtable_max_size = 4096};
+  DB db{std::move(opt)};
+
+  KeyValues expected;
+  for (int i = 100; i < 200; i++) {
+    expected.emplace_back("key" + std::to_string(i), "value");
+    db.Put(expected.back().first, expected.back().second);
+  }
+
+  auto it{db.NewIterator()};
+  it.SeekToFirst();
+
+  std::thread writer{[&db] {
+    for (int i = 0; i < 2000; i++) {
+      db.Put("key" + std::to_string(100 + i % 150), "new");
+    }
+  }};
+  auto key_values{ReadAll(it)};
+  writer.join();
+
+  BOOST_TEST_REQUIRE(key_values == expected,
+                     boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
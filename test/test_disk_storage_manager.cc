@@ -1,4 +1,5 @@
 #include "disk_storage_manager.h"
+#include "helpers.h"
 #include "unit_test_include.h"
 #include "util.h"
 
@@ -50,7 +51,7 @@ BOOST_AUTO_TEST_CASE(TestDiskStorageManagerCompactionTwoTables) {
   BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "");
 
   size_t expected_num_files{1};
-  BOOST_REQUIRE_EQUAL(env->files.size(), expected_num_files);
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
 }
 
 /**
@@ -91,7 +92,7 @@ BOOST_AUTO_TEST_CASE(TestDiskStorageManagerCompactionThreeTables) {
   BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "5");
 
   size_t expected_num_files{1};
-  BOOST_REQUIRE_EQUAL(env->files.size(), expected_num_files);
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
 }
 
 /**
@@ -118,7 +119,394 @@ BOOST_AUTO_TEST_CASE(TestDiskStorageManagerNoCompaction) {
   BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "");
 
   size_t expected_num_files{2};
-  BOOST_REQUIRE_EQUAL(env->files.size(), expected_num_files);
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+}
+
+/**
+ * Compaction output is split into tables of roughly target_file_size bytes.
+ * All of them are installed and every key is still readable.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerSplitCompactionOutput) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 2;
+  opt.block_size = 1;
+  opt.target_file_size = 1;
+
+  DiskStorageManager storage_manager;
+
+  MemTableT memtable1{{"1", "10"}, {"2", "10"}, {"3", "10"}};
+  MemTableT memtable2{{"3", "30"}, {"4", "40"}};
+
+  storage_manager.WriteMemtable(opt, memtable1);
+  storage_manager.WriteMemtable(opt, memtable2);
+  storage_manager.WaitForOngoingCompactions();
+
+  // One key per block and one block per table.
+  size_t expected_num_files{4};
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "10");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("2"), "10");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("3"), "30");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("4"), "40");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("5"), "");
+}
+
+/**
+ * With universal compaction, similarly sized runs are merged back into
+ * level 0 and the most recent values win.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerUniversalCompaction) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 2;
+  opt.compaction_policy = std::make_shared<UniversalCompactionPolicy>();
+
+  DiskStorageManager storage_manager;
+
+  MemTableT memtable1{{"1", "10"}, {"2", "10"}, {"3", "10"}};
+
+  storage_manager.WriteMemtable(opt, memtable1);
+
+  MemTableT memtable2{{"1", ""}, {"2", "20"}, {"3", "30"}};
+
+  storage_manager.WriteMemtable(opt, memtable2);
+
+  storage_manager.WaitForOngoingCompactions();
+
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("2"), "20");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("3"), "30");
+
+  size_t expected_num_files{1};
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+}
+
+/**
+ * With FIFO compaction, tables are never merged. The oldest table is deleted
+ * once the size limit is hit.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerFIFOCompaction) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+
+  MemTableT memtable1{{"1", "10"}, {"2", "10"}};
+  MemTableT memtable2{{"2", "20"}, {"3", "20"}};
+  MemTableT memtable3{{"3", "30"}, {"4", "30"}};
+
+  // Room for exactly two of the tables above.
+  DiskStorageManager sizer;
+  sizer.WriteMemtable(opt, memtable1);
+  size_t table_size{env->files.at(util::TableFileName(opt, 0)).size()};
+  env->files.clear();
+
+  opt.compaction_policy = std::make_shared<FIFOCompactionPolicy>(
+      FIFOCompactionOptions{.max_table_files_size = 2 * table_size});
+
+  DiskStorageManager storage_manager;
+  storage_manager.WriteMemtable(opt, memtable1);
+  storage_manager.WriteMemtable(opt, memtable2);
+  storage_manager.WaitForOngoingCompactions();
+
+  size_t expected_num_files{2};
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+
+  storage_manager.WriteMemtable(opt, memtable3);
+  storage_manager.WaitForOngoingCompactions();
+
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("2"), "20");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("3"), "30");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("4"), "30");
+}
+
+/**
+ * Tables that don't overlap anything are moved to the next level without
+ * being rewritten.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerTrivialMove) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 2;
+
+  DiskStorageManager storage_manager;
+
+  MemTableT memtable1{{"1", "10"}, {"2", "10"}};
+  MemTableT memtable2{{"3", "30"}, {"4", "40"}};
+
+  storage_manager.WriteMemtable(opt, memtable1);
+  storage_manager.WriteMemtable(opt, memtable2);
+  storage_manager.WaitForOngoingCompactions();
+
+  // The original tables are still there and no new table was written.
+  size_t expected_num_files{2};
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+  BOOST_REQUIRE(env->FileExists(util::TableFileName(opt, 0)));
+  BOOST_REQUIRE(env->FileExists(util::TableFileName(opt, 1)));
+
+  // Another flush doesn't trigger a compaction since level 0 was emptied.
+  MemTableT memtable3{{"1", "overwrite"}};
+  storage_manager.WriteMemtable(opt, memtable3);
+  storage_manager.WaitForOngoingCompactions();
+
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files + 1);
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "overwrite");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("4"), "40");
+}
+
+/**
+ * Loading tables uses the levels and key ranges recorded in the manifest
+ * without opening any table. Tables that a compaction replaced but didn't get
+ * to remove are deleted, and so are tables that were still being written.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerLoadFromManifest) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 2;
+
+  {
+    DiskStorageManager storage_manager;
+
+    MemTableT memtable1{{"1", "10"}, {"2", "10"}};
+    MemTableT memtable2{{"2", "20"}, {"3", "30"}};
+
+    storage_manager.WriteMemtable(opt, memtable1);
+    auto stale_table{env->files.at(util::TableFileName(opt, 0))};
+
+    storage_manager.WriteMemtable(opt, memtable2);
+    storage_manager.WaitForOngoingCompactions();
+
+    // Pretend we crashed before the compaction removed its first input.
+    env->files[util::TableFileName(opt, 0)] = stale_table;
+
+    // Tables 0 and 1 were compacted into table 2. Table 3 holds memtable3.
+    MemTableT memtable3{{"1", "overwrite"}};
+    storage_manager.WriteMemtable(opt, memtable3);
+
+    // Pretend we crashed while flushing another memtable.
+    env->files[util::TableFileName(opt, 4)] = stale_table;
+  }
+
+  DiskStorageManager storage_manager;
+  storage_manager.LoadIndices(opt);
+
+  size_t expected_open_tables{0};
+  BOOST_REQUIRE_EQUAL(storage_manager.NumOpenTables(), expected_open_tables);
+
+  BOOST_REQUIRE(!env->FileExists(util::TableFileName(opt, 0)));
+  BOOST_REQUIRE(!env->FileExists(util::TableFileName(opt, 4)));
+  size_t expected_num_files{2};
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "overwrite");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("2"), "20");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("3"), "30");
+}
+
+/**
+ * Compaction drops keys that are deleted by a newer range tombstone. The
+ * tombstone itself is dropped too since nothing older is left.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerCompactionRangeTombstone) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 2;
+
+  DiskStorageManager storage_manager;
+
+  MemTableT memtable1{{"1", "10"}, {"2", "10"}, {"3", "10"}, {"5", "10"}};
+  MemTableT memtable2{{"4", "40"}};
+
+  storage_manager.WriteMemtable(opt, memtable1);
+  storage_manager.WriteMemtable(opt, memtable2, {{"2", "4"}});
+  storage_manager.WaitForOngoingCompactions();
+
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("1"), "10");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("2"), "");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("3"), "");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("4"), "40");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("5"), "10");
+
+  size_t expected_num_files{1};
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+
+  auto reader{opt.table_factory->MakeTableReader(2, opt)};
+  BOOST_REQUIRE(reader->RangeTombstones().empty());
+
+  std::vector<std::string> keys;
+  for (auto it = reader->Begin(); it != reader->End(); ++it) {
+    keys.push_back(it->first);
+  }
+
+  std::vector<std::string> expected_keys{"1", "4", "5"};
+  BOOST_TEST_REQUIRE(keys == expected_keys, boost::test_tools::per_element());
+}
+
+/**
+ * Tables that are entirely inside a newer range tombstone are dropped without
+ * being compacted.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerDropCoveredTable) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 10;
+
+  DiskStorageManager storage_manager;
+
+  MemTableT memtable1{{"4", "40"}, {"6", "60"}};
+  MemTableT memtable2{{"2", "20"}, {"3", "30"}};
+
+  storage_manager.WriteMemtable(opt, memtable1);
+  storage_manager.WriteMemtable(opt, memtable2);
+  storage_manager.WriteMemtable(opt, {}, {{"1", "5"}});
+  storage_manager.WaitForOngoingCompactions();
+
+  // Only the second table is fully covered.
+  size_t expected_num_files{2};
+  BOOST_REQUIRE_EQUAL(NumTableFiles(*env), expected_num_files);
+  BOOST_REQUIRE(!env->FileExists(util::TableFileName(opt, 1)));
+
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("2"), "");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("4"), "");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("6"), "60");
+}
+
+/**
+ * No more tables than Options::max_open_tables stay open. Evicted tables are
+ * reopened when they are read again, including after a restart.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerMaxOpenTables) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 10;
+  opt.max_open_tables = 2;
+
+  {
+    DiskStorageManager storage_manager;
+    for (size_t i = 0; i < 5; i++) {
+      auto key{std::to_string(i)};
+      storage_manager.WriteMemtable(opt, {{key, key + "0"}, {"shared", key}});
+    }
+    storage_manager.WaitForOngoingCompactions();
+
+    size_t expected_open_tables{2};
+    BOOST_REQUIRE_EQUAL(storage_manager.NumOpenTables(),
+                        expected_open_tables);
+
+    for (size_t i = 0; i < 5; i++) {
+      auto key{std::to_string(i)};
+      BOOST_REQUIRE_EQUAL(storage_manager.ValueOf(key), key + "0");
+      BOOST_REQUIRE_LE(storage_manager.NumOpenTables(), expected_open_tables);
+    }
+    BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("shared"), "4");
+
+    // Readers that are handed out outlive their eviction.
+    auto tables{storage_manager.Tables()};
+    BOOST_REQUIRE_EQUAL(storage_manager.NumOpenTables(),
+                        expected_open_tables);
+    for (const auto &table : tables) {
+      BOOST_REQUIRE(table->ValueOf("shared").has_value());
+    }
+  }
+
+  DiskStorageManager storage_manager;
+  storage_manager.LoadIndices(opt);
+
+  BOOST_REQUIRE_LE(storage_manager.NumOpenTables(), opt.max_open_tables);
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("0"), "00");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("shared"), "4");
+}
+
+/**
+ * With Options::open_tables_on_recovery, the tables that are searched first
+ * are opened while loading, up to the size of the table cache.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerOpenTablesOnRecovery) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 10;
+  opt.max_open_tables = 3;
+  opt.open_tables_on_recovery = true;
+  opt.max_file_opening_threads = 2;
+
+  {
+    DiskStorageManager storage_manager;
+    for (size_t i = 0; i < 5; i++) {
+      auto key{std::to_string(i)};
+      storage_manager.WriteMemtable(opt, {{key, key + "0"}});
+    }
+  }
+
+  DiskStorageManager storage_manager;
+  storage_manager.LoadIndices(opt);
+
+  BOOST_REQUIRE_EQUAL(storage_manager.NumOpenTables(), opt.max_open_tables);
+
+  for (size_t i = 0; i < 5; i++) {
+    auto key{std::to_string(i)};
+    BOOST_REQUIRE_EQUAL(storage_manager.ValueOf(key), key + "0");
+  }
+}
+
+/**
+ * Probing level 0 in parallel finds the newest version of each key, and
+ * deletes still hide older versions.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerParallelProbe) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 100;
+  opt.parallel_probe_levels = 1;
+  opt.parallel_probe_threads = 3;
+
+  DiskStorageManager storage_manager;
+
+  for (int i = 0; i < 8; i++) {
+    MemTableT memtable{{"common", std::to_string(i)},
+                       {"only" + std::to_string(i), "value"}};
+    if (i == 6) {
+      memtable.insert_or_assign("only2", "");
+    }
+    storage_manager.WriteMemtable(opt, memtable);
+  }
+  BOOST_REQUIRE_EQUAL(storage_manager.NumTables(0), 8);
+
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("common"), "7");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("only0"), "value");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("only7"), "value");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("only2"), "");
+  BOOST_REQUIRE_EQUAL(storage_manager.ValueOf("missing"), "");
+}
+
+/**
+ * MultiValueOf() reads the blocks of every table in a level with a single
+ * Env::MultiRead(), and the newest table still wins.
+ */
+BOOST_AUTO_TEST_CASE(TestDiskStorageManagerMultiValueOf) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.trigger_compaction_at = 100;
+
+  DiskStorageManager storage_manager;
+  for (int i = 0; i < 4; i++) {
+    storage_manager.WriteMemtable(opt, {{"common", std::to_string(i)},
+                                        {"only" + std::to_string(i), "value"}});
+  }
+
+  std::vector<std::string_view> keys{"common", "missing", "only0", "only3"};
+  std::vector<std::optional<std::string>> values(keys.size());
+  env->num_multi_reads = 0;
+  env->num_read_requests = 0;
+  storage_manager.MultiValueOf(keys, kMaxSequenceNumber, values);
+
+  BOOST_REQUIRE_EQUAL(env->num_multi_reads, 1);
+  BOOST_REQUIRE_EQUAL(env->num_read_requests, 4);
+  BOOST_REQUIRE(values[0] == "3");
+  BOOST_REQUIRE(!values[1]);
+  BOOST_REQUIRE(values[2] == "value");
+  BOOST_REQUIRE(values[3] == "value");
 }
 
 BOOST_AUTO_TEST_SUITE_END()
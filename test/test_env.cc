@@ -0,0 +1,242 @@
+#include "env.h"
+#include "unit_test_include.h"
+#include "util.h"
+
+using namespace mdb;
+
+BOOST_AUTO_TEST_SUITE(TestEnv)
+
+namespace {
+
+std::vector<char> MakeContents(size_t size) {
+  std::vector<char> contents(size);
+  for (size_t i = 0; i < size; ++i) {
+    contents[i] = static_cast<char>(i * 31 + i / 4096);
+  }
+  return contents;
+}
+
+std::vector<char> ReadAll(ReadOnlyIO &file) {
+  std::vector<char> contents(file.Size());
+  BOOST_REQUIRE_EQUAL(file.Read(contents.data(), contents.size(), 0),
+                      contents.size());
+  return contents;
+}
+
+}  // namespace
+
+/**
+ * WriteV() writes its parts back to back. MultiRead() fills every request,
+ * whether it is adjacent to another one, out of order or past the end of
+ * the file.
+ */
+BOOST_AUTO_TEST_CASE(TestWriteVAndMultiRead) {
+  for (const auto &env : {Env::CreateDefault(), Env::CreateIoUring()}) {
+    std::string filename{"./env_multi_read_test"};
+
+    auto contents{MakeContents(10000)};
+    {
+      auto file{env->MakeWriteOnlyIO(filename)};
+      std::vector<std::string_view> parts{{contents.data(), 100},
+                                          {contents.data() + 100, 0},
+                                          {contents.data() + 100, 9900}};
+      file->WriteV(parts.data(), parts.size());
+      file->Close();
+    }
+
+    auto file{env->MakeReadOnlyIO(filename)};
+    BOOST_REQUIRE(ReadAll(*file) == contents);
+
+    std::vector<std::pair<size_t, size_t>> ranges{
+        {5000, 100}, {0, 10}, {10, 20}, {30, 1}, {9990, 100}, {20000, 5}};
+    std::vector<std::vector<char>> outputs;
+    std::vector<ReadRequest> requests;
+    for (const auto &[offset, size] : ranges) {
+      outputs.emplace_back(size);
+    }
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      requests.push_back(
+          {nullptr, ranges[i].first, ranges[i].second, outputs[i].data()});
+    }
+    file->MultiRead(requests.data(), requests.size());
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+      size_t offset{std::min(ranges[i].first, contents.size())};
+      size_t expected_size{
+          std::min(ranges[i].second, contents.size() - offset)};
+      BOOST_REQUIRE_EQUAL(requests[i].bytes_read, expected_size);
+      BOOST_REQUIRE(std::equal(outputs[i].begin(),
+                               outputs[i].begin() + expected_size,
+                               contents.begin() + offset));
+    }
+
+    env->RemoveFile(filename);
+  }
+}
+
+/**
+ * Direct writes keep the exact file size even though the device only takes
+ * aligned blocks, including when the tail is synced and then appended to.
+ */
+BOOST_AUTO_TEST_CASE(TestDirectIO) {
+  auto env{Env::CreateDefault()};
+  std::string filename{"./env_direct_io_test"};
+
+  // Bigger than one buffer, and not a multiple of the alignment.
+  auto contents{MakeContents(3 * 1024 * 1024 + 123)};
+  size_t first_part{5000};
+
+  {
+    auto file{env->MakeDirectWriteOnlyIO(filename)};
+    file->Write(contents.data(), first_part);
+    file->Sync();
+    file->Write(contents.data() + first_part, contents.size() - first_part);
+    file->Close();
+  }
+
+  auto file{env->MakeReadOnlyIO(filename)};
+  BOOST_REQUIRE(ReadAll(*file) == contents);
+
+  auto direct_file{env->MakeDirectReadOnlyIO(filename)};
+  BOOST_REQUIRE(ReadAll(*direct_file) == contents);
+
+  // Small unaligned reads, some of which cross a buffer boundary.
+  for (size_t offset : {size_t{1}, size_t{4095}, size_t{1024 * 1024 - 3},
+                        contents.size() - 10}) {
+    std::vector<char> buf(10);
+    BOOST_REQUIRE_EQUAL(direct_file->Read(buf.data(), buf.size(), offset),
+                        buf.size());
+    BOOST_REQUIRE(std::equal(buf.begin(), buf.end(),
+                             contents.begin() + offset));
+  }
+
+  // Reads stop at the end of the file.
+  std::vector<char> buf(10);
+  BOOST_REQUIRE_EQUAL(
+      direct_file->Read(buf.data(), buf.size(), contents.size() - 4), 4);
+  BOOST_REQUIRE_EQUAL(direct_file->Read(buf.data(), buf.size(),
+                                        contents.size()),
+                      0);
+
+  env->RemoveFile(filename);
+}
+
+/**
+ * A mapped file exposes its contents and can still be read with Read().
+ */
+BOOST_AUTO_TEST_CASE(TestMmapIO) {
+  auto env{Env::CreateDefault()};
+  std::string filename{"./env_mmap_io_test"};
+
+  auto contents{MakeContents(10000)};
+  {
+    auto file{env->MakeWriteOnlyIO(filename)};
+    file->Write(contents.data(), contents.size());
+    file->Close();
+  }
+
+  auto file{env->MakeMmapReadOnlyIO(filename)};
+  BOOST_REQUIRE_EQUAL(file->Size(), contents.size());
+  BOOST_REQUIRE(file->MappedData() != nullptr);
+  BOOST_REQUIRE(std::equal(contents.begin(), contents.end(),
+                           file->MappedData()));
+  BOOST_REQUIRE(ReadAll(*file) == contents);
+
+  file->Close();
+  BOOST_REQUIRE(file->MappedData() == nullptr);
+
+  env->RemoveFile(filename);
+}
+
+/**
+ * A reused file is written from the start. What is past the new data is
+ * left in place, and neither preallocating nor syncing a range changes the
+ * file size.
+ */
+BOOST_AUTO_TEST_CASE(TestReuseWriteOnlyIO) {
+  for (const auto &env : {Env::CreateDefault(), Env::CreateIoUring()}) {
+    std::string old_filename{"./env_reuse_old_test"};
+    std::string filename{"./env_reuse_test"};
+
+    auto contents{MakeContents(10000)};
+    {
+      auto file{env->MakeWriteOnlyIO(old_filename)};
+      file->Allocate(1024 * 1024);
+      file->Write(contents.data(), contents.size());
+      file->Close();
+    }
+
+    std::vector<char> update(100, 'x');
+    {
+      auto file{env->ReuseWriteOnlyIO(old_filename, filename)};
+      file->Allocate(1024 * 1024);
+      file->Write(update.data(), update.size());
+      file->RangeSync(0, update.size());
+      file->Close();
+    }
+    BOOST_REQUIRE(!env->FileExists(old_filename));
+
+    std::copy(update.cbegin(), update.cend(), contents.begin());
+    auto file{env->MakeReadOnlyIO(filename)};
+    BOOST_REQUIRE(ReadAll(*file) == contents);
+
+    env->RemoveFile(filename);
+  }
+}
+
+/**
+ * The io_uring env reads back what it writes, and a MultiRead() bigger than
+ * a single submission fills every request.
+ */
+BOOST_AUTO_TEST_CASE(TestIoUringIO) {
+  auto env{Env::CreateIoUring()};
+  std::string filename{"./env_io_uring_test"};
+
+  auto contents{MakeContents(100000)};
+  size_t first_part{777};
+  {
+    auto file{env->MakeWriteOnlyIO(filename)};
+    file->Write(contents.data(), first_part);
+    file->WriteAndSync(contents.data() + first_part,
+                       contents.size() - first_part);
+    file->Close();
+  }
+
+  auto file{env->MakeReadOnlyIO(filename)};
+  BOOST_REQUIRE_EQUAL(file->Size(), contents.size());
+  BOOST_REQUIRE(ReadAll(*file) == contents);
+
+  // Requests on a file from another env are read one by one.
+  auto default_file{Env::CreateDefault()->MakeReadOnlyIO(filename)};
+
+  size_t request_size{1000};
+  std::vector<std::vector<char>> outputs(200, std::vector<char>(1000));
+  std::vector<ReadRequest> requests;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    requests.push_back({i % 3 == 0 ? default_file.get() : file.get(),
+                        i * 499, request_size, outputs[i].data()});
+  }
+  env->MultiRead(requests);
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    size_t expected_size{
+        std::min(request_size, contents.size() - requests[i].offset)};
+    BOOST_REQUIRE_EQUAL(requests[i].bytes_read, expected_size);
+    BOOST_REQUIRE(std::equal(outputs[i].begin(),
+                             outputs[i].begin() + expected_size,
+                             contents.begin() + requests[i].offset));
+  }
+
+  env->RemoveFile(filename);
+}
+
+/**
+ * Directories can be synced. Syncing one that doesn't exist fails.
+ */
+BOOST_AUTO_TEST_CASE(TestSyncDir) {
+  auto env{Env::CreateDefault()};
+  env->SyncDir(".");
+  BOOST_REQUIRE_THROW(env->SyncDir("./env_missing_dir"), std::system_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
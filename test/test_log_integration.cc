@@ -36,4 +36,69 @@ BOOST_AUTO_TEST_CASE(TestLogReaderReadsLogWriterOutput) {
   }
 }
 
+/**
+ * A range tombstone is logged as a single record. Replaying it deletes the
+ * keys logged before it, but not the ones logged after.
+ */
+BOOST_AUTO_TEST_CASE(TestLogReaderReplaysRangeTombstones) {
+  std::vector<char> output;
+  auto io{std::make_unique<WriteOnlyIOMock>(output)};
+
+  LogWriter writer{std::move(io), false};
+
+  writer.Add("a", "1");
+  writer.Add("b", "2");
+  writer.Add("c", "3");
+  writer.Add("d", "4");
+  writer.AddRangeTombstone("b", "d");
+  writer.Add("c", "new");
+  writer.FlushBuffer();
+
+  auto io_read{std::make_unique<ReadOnlyIOMock>(std::move(output))};
+  LogReader reader{std::move(io_read)};
+
+  MemTableT memtable{reader.ReadMemTable()};
+  MemTableT expected{{"a", "1"}, {"c", "new"}, {"d", "4"}};
+  BOOST_TEST_REQUIRE(memtable == expected, boost::test_tools::per_element());
+
+  const auto &tombstones{reader.RangeTombstones()};
+  size_t expected_num_tombstones{1};
+  BOOST_REQUIRE_EQUAL(tombstones.size(), expected_num_tombstones);
+  BOOST_REQUIRE_EQUAL(tombstones[0].begin, "b");
+  BOOST_REQUIRE_EQUAL(tombstones[0].end, "d");
+}
+
+/**
+ * ReadVersions() keeps every write along with its sequence number.
+ */
+BOOST_AUTO_TEST_CASE(TestLogReaderReadsVersions) {
+  std::vector<char> output;
+  auto io{std::make_unique<WriteOnlyIOMock>(output)};
+
+  LogWriter writer{std::move(io), false};
+
+  writer.Add("a", "1", 1);
+  writer.Add("a", "2", 2);
+  writer.Add("b", "", 3);
+  writer.AddRangeTombstone("a", "c", 4);
+  writer.FlushBuffer();
+
+  auto io_read{std::make_unique<ReadOnlyIOMock>(std::move(output))};
+  LogReader reader{std::move(io_read)};
+
+  auto memtable{reader.ReadVersions()};
+
+  MemTable::EntriesT expected{
+      {{"a", 2}, "2"}, {{"a", 1}, "1"}, {{"b", 3}, ""}};
+  BOOST_REQUIRE(memtable.Entries() == expected);
+
+  size_t expected_last_sequence{4};
+  BOOST_REQUIRE_EQUAL(memtable.LastSequence(), expected_last_sequence);
+
+  BOOST_REQUIRE_EQUAL(*memtable.Get("a", 1), "1");
+  BOOST_REQUIRE_EQUAL(*memtable.Get("a", 3), "2");
+  BOOST_REQUIRE_EQUAL(*memtable.Get("a", 4), "");
+  BOOST_REQUIRE(!memtable.Get("b", 2));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
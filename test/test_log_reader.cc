@@ -1,8 +1,8 @@
-#include <limits>
 #include <map>
 #include <vector>
 
 #include "log_reader.h"
+#include "log_writer.h"
 #include "unit_test_include.h"
 #include "util.h"
 
@@ -14,26 +14,37 @@ namespace {
 
 using SequenceT = std::vector<std::pair<std::string, std::string>>;
 
-size_t PairSize(const std::pair<std::string, std::string> &pair) {
-  return pair.first.size() + pair.second.size();
+// The size of the record of "pair" when it fits in a single fragment.
+size_t RecordSize(const std::pair<std::string, std::string> &pair) {
+  return kLogHeaderSize + 3 * sizeof(size_t) + pair.first.size() +
+         pair.second.size();
 }
 
-std::vector<char> ConstructInput(const SequenceT &seq) {
+std::vector<char> ConstructInput(const SequenceT &seq,
+                                 size_t log_number = 0) {
   std::vector<char> buf;
 
-  for (auto &kv : seq) {
-    WriteSizeT(buf, kv.first.size());
-    WriteString(buf, kv.first);
-
-    WriteSizeT(buf, kv.second.size());
-    if (kv.second.size() > 0) {
-      WriteString(buf, kv.second);
-    }
+  LogWriter writer{std::make_unique<WriteOnlyIOMock>(buf), false,
+                   log_number};
+  size_t sequence{1};
+  for (const auto &kv : seq) {
+    writer.Add(kv.first, kv.second, sequence++);
   }
+  writer.FlushBuffer();
 
   return buf;
 }
 
+// A file whose reads always fail.
+class FailingReadOnlyIOMock : public ReadOnlyIOMock {
+ public:
+  using ReadOnlyIOMock::ReadOnlyIOMock;
+
+  size_t Read(char *, size_t, size_t) override {
+    throw std::system_error(EIO, std::generic_category());
+  }
+};
+
 }  // namespace
 
 /**
@@ -86,10 +97,10 @@ BOOST_AUTO_TEST_CASE(TestLogReaderWithDeletes) {
  */
 
 /**
- * Test reading a logfile with corrupted string sizes (huge number, bigger
- * than the available file space)
+ * A record whose checksum doesn't match is not replayed, and neither is
+ * anything after it.
  */
-BOOST_AUTO_TEST_CASE(TestLogReaderCorruptionHugeKeySize) {
+BOOST_AUTO_TEST_CASE(TestLogReaderCorruptedRecord) {
   SequenceT input_seq{{"abc", "def"},
                       {"notdeleted", "val"},
                       {"notdeleted", ""},
@@ -97,16 +108,12 @@ BOOST_AUTO_TEST_CASE(TestLogReaderCorruptionHugeKeySize) {
 
   std::vector<char> input{ConstructInput(input_seq)};
 
-  // Insert after first 2 keys
-  size_t insert_at{4 * sizeof(size_t) + PairSize(input_seq[0]) +
-                   PairSize(input_seq[1])};
-
-  size_t corrupted_size{input.size() - insert_at + 1};
-
-  *reinterpret_cast<size_t *>(input.data() + insert_at) = corrupted_size;
-  auto io{std::make_unique<ReadOnlyIOMock>(std::move(input))};
+  // Flip a bit in the key of the third record.
+  size_t corrupt_at{RecordSize(input_seq[0]) + RecordSize(input_seq[1]) +
+                    kLogHeaderSize + 2 * sizeof(size_t)};
+  input[corrupt_at] ^= 1;
 
-  LogReader reader{std::move(io)};
+  LogReader reader{std::make_unique<ReadOnlyIOMock>(std::move(input))};
 
   MemTableT memtable{reader.ReadMemTable()};
   MemTableT expected{{"abc", "def"}, {"notdeleted", "val"}};
@@ -115,30 +122,24 @@ BOOST_AUTO_TEST_CASE(TestLogReaderCorruptionHugeKeySize) {
 }
 
 /**
- * Like TestLogReaderCorruputionHugeValueSize, but puts
- * the problematic size bytes before a key.
+ * A header that claims more data than the block holds is treated like a
+ * corrupted record.
  */
-BOOST_AUTO_TEST_CASE(TestLogReaderCorruptionHugeValueSize) {
-  SequenceT input_seq{{"abc", "def"},
-                      {"notdeleted", "val"},
-                      {"notdeleted", ""},
-                      {"notadded", "val"}};
+BOOST_AUTO_TEST_CASE(TestLogReaderCorruptionHugeLength) {
+  SequenceT input_seq{{"abc", "def"}, {"notadded", "val"}};
 
   std::vector<char> input{ConstructInput(input_seq)};
 
-  // Insert after first 2 keys
-  size_t insert_at{5 * sizeof(size_t) + PairSize(input_seq[0]) +
-                   PairSize(input_seq[1]) + input_seq[2].first.size()};
-
-  size_t corrupted_size{input.size() - insert_at + 1};
+  auto header{DecodeLogHeader(input.data() + RecordSize(input_seq[0]))};
+  auto corrupted{EncodeLogHeader(header.checksum, 60000, header.type,
+                                  header.log_number)};
+  std::copy(corrupted.cbegin(), corrupted.cend(),
+            input.begin() + RecordSize(input_seq[0]));
 
-  *reinterpret_cast<size_t *>(input.data() + insert_at) = corrupted_size;
-  auto io{std::make_unique<ReadOnlyIOMock>(std::move(input))};
-
-  LogReader reader{std::move(io)};
+  LogReader reader{std::make_unique<ReadOnlyIOMock>(std::move(input))};
 
   MemTableT memtable{reader.ReadMemTable()};
-  MemTableT expected{{"abc", "def"}, {"notdeleted", "val"}};
+  MemTableT expected{{"abc", "def"}};
 
   BOOST_TEST_REQUIRE(expected == memtable, boost::test_tools::per_element());
 }
@@ -163,4 +164,91 @@ BOOST_AUTO_TEST_CASE(TestLogReaderCorruptionKeyWithNoValue) {
   BOOST_TEST_REQUIRE(expected == memtable, boost::test_tools::per_element());
 }
 
+/**
+ * A record that spans blocks is dropped if the log ends before its last
+ * fragment.
+ */
+BOOST_AUTO_TEST_CASE(TestLogReaderTornRecordSpanningBlocks) {
+  SequenceT input_seq{{"abc", "def"}, {"large", std::string(50000, 'a')}};
+
+  std::vector<char> input{ConstructInput(input_seq)};
+  input.resize(kLogBlockSize + 100);
+
+  LogReader reader{std::make_unique<ReadOnlyIOMock>(std::move(input))};
+
+  MemTableT memtable{reader.ReadMemTable()};
+  MemTableT expected{{"abc", "def"}};
+
+  BOOST_TEST_REQUIRE(expected == memtable, boost::test_tools::per_element());
+}
+
+/**
+ * Logs that take several chunks are replayed the same way when their blocks
+ * are verified on several threads.
+ */
+BOOST_AUTO_TEST_CASE(TestLogReaderParallelVerification) {
+  SequenceT input_seq;
+  for (size_t i = 0; i < 3000; i++) {
+    input_seq.emplace_back("key" + std::to_string(i % 2000),
+                           std::string(1000, 'a' + i % 26));
+  }
+
+  std::vector<char> input{ConstructInput(input_seq)};
+  BOOST_REQUIRE_GT(input.size(), 2 * 1024 * 1024);
+
+  MemTableT expected;
+  for (const auto &kv : input_seq) {
+    expected.insert_or_assign(kv.first, kv.second);
+  }
+
+  for (size_t num_threads : {1, 4}) {
+    LogReader reader{std::make_unique<ReadOnlyIOMock>(input), 0, num_threads};
+    MemTableT memtable{reader.ReadMemTable()};
+    BOOST_TEST_REQUIRE(expected == memtable,
+                       boost::test_tools::per_element());
+  }
+
+  // Corruption in a later chunk keeps everything before it.
+  input[2 * 1024 * 1024 + 100] ^= 1;
+  LogReader reader{std::make_unique<ReadOnlyIOMock>(std::move(input)), 0, 4};
+  auto memtable{reader.ReadMemTable()};
+  BOOST_REQUIRE_EQUAL(memtable.at("key0"), input_seq[2000].second);
+  BOOST_REQUIRE_EQUAL(memtable.at("key999"), input_seq[999].second);
+}
+
+/**
+ * A reused log file still holds the records of its previous log past the
+ * new ones. They are not replayed, even where they line up with the new
+ * fragments.
+ */
+BOOST_AUTO_TEST_CASE(TestLogReaderStaleRecordsOfReusedFile) {
+  SequenceT old_seq;
+  for (size_t i = 0; i < 100; i++) {
+    old_seq.emplace_back("old" + std::to_string(i), "value");
+  }
+  SequenceT new_seq{{"new0", "value"}, {"new1", "value"}};
+
+  auto input{ConstructInput(old_seq, 1)};
+  auto overwrite{ConstructInput(new_seq, 2)};
+  std::copy(overwrite.cbegin(), overwrite.cend(), input.begin());
+
+  LogReader reader{std::make_unique<ReadOnlyIOMock>(input), 2};
+  MemTableT expected{{"new0", "value"}, {"new1", "value"}};
+  BOOST_TEST_REQUIRE(expected == reader.ReadMemTable(),
+                     boost::test_tools::per_element());
+
+  LogReader old_reader{std::make_unique<ReadOnlyIOMock>(std::move(input)),
+                       1};
+  BOOST_REQUIRE(old_reader.ReadMemTable().empty());
+}
+
+/**
+ * A read error is not mistaken for the end of the log.
+ */
+BOOST_AUTO_TEST_CASE(TestLogReaderReadError) {
+  LogReader reader{std::make_unique<FailingReadOnlyIOMock>(
+      ConstructInput({{"abc", "def"}}))};
+  BOOST_REQUIRE_THROW(reader.ReadMemTable(), std::system_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,5 +1,7 @@
+#include <boost/crc.hpp>
 #include <string>
 
+#include "log_format.h"
 #include "log_writer.h"
 #include "unit_test_include.h"
 #include "util.h"
@@ -8,38 +10,99 @@ using namespace mdb;
 
 BOOST_AUTO_TEST_SUITE(TestLogWriter)
 
+namespace {
+
+// Put the records back together from their fragments, checking every
+// header on the way.
+std::vector<std::vector<char>> ReadRecords(const std::vector<char> &output,
+                                           uint32_t log_number = 0) {
+  std::vector<std::vector<char>> records;
+  std::vector<char> record;
+
+  size_t pos{0};
+  while (pos < output.size()) {
+    size_t block_left{kLogBlockSize - pos % kLogBlockSize};
+    if (block_left < kLogHeaderSize) {
+      pos += block_left;
+      continue;
+    }
+
+    BOOST_TEST_REQUIRE(output.size() - pos >= kLogHeaderSize);
+    auto header{DecodeLogHeader(output.data() + pos)};
+    pos += kLogHeaderSize;
+
+    BOOST_TEST_REQUIRE(header.length <= block_left - kLogHeaderSize);
+    BOOST_TEST_REQUIRE(output.size() - pos >= header.length);
+    BOOST_REQUIRE_EQUAL(header.log_number, log_number);
+
+    boost::crc_32_type crc;
+    crc.process_byte(static_cast<unsigned char>(header.type));
+    crc.process_bytes(&header.log_number, sizeof(header.log_number));
+    crc.process_bytes(output.data() + pos, header.length);
+    BOOST_REQUIRE_EQUAL(crc.checksum(), header.checksum);
+
+    bool first{header.type == LogRecordType::kFull ||
+               header.type == LogRecordType::kFirst};
+    BOOST_REQUIRE_EQUAL(first, record.empty());
+
+    record.insert(record.end(), output.data() + pos,
+                  output.data() + pos + header.length);
+    pos += header.length;
+
+    if (header.type == LogRecordType::kFull ||
+        header.type == LogRecordType::kLast) {
+      records.push_back(std::move(record));
+      record.clear();
+    }
+  }
+
+  BOOST_REQUIRE(record.empty());
+  return records;
+}
+
+}  // namespace
+
 void CompareKvToOutput(
     const std::vector<char> &write_dest,
     const std::vector<std::pair<std::string, std::string>> &pairs) {
-  size_t cur{0};
-  for (const auto &kv : pairs) {
-    BOOST_TEST_REQUIRE(write_dest.size() - cur >= sizeof(size_t));
+  auto records{ReadRecords(write_dest)};
+  BOOST_REQUIRE_EQUAL(records.size(), pairs.size());
+
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const auto &kv{pairs[i]};
+    const auto &record{records[i]};
+    size_t cur{0};
+
+    // Skip the sequence number
+    BOOST_TEST_REQUIRE(record.size() - cur >= sizeof(size_t));
+    cur += sizeof(size_t);
+
+    BOOST_TEST_REQUIRE(record.size() - cur >= sizeof(size_t));
 
-    size_t key_size{ReadSizeT(write_dest, cur)};
+    size_t key_size{ReadSizeT(record, cur)};
     cur += sizeof(size_t);
 
     BOOST_REQUIRE_EQUAL(key_size, kv.first.size());
 
-    BOOST_TEST_REQUIRE(write_dest.size() - cur >= key_size);
-    std::string key{ReadString(write_dest, cur, key_size)};
+    BOOST_TEST_REQUIRE(record.size() - cur >= key_size);
+    std::string key{ReadString(record, cur, key_size)};
     cur += key.size();
 
     BOOST_REQUIRE_EQUAL(key, kv.first);
 
-    BOOST_TEST_REQUIRE(write_dest.size() - cur >= sizeof(size_t));
-    size_t value_size{ReadSizeT(write_dest, cur)};
+    BOOST_TEST_REQUIRE(record.size() - cur >= sizeof(size_t));
+    size_t value_size{ReadSizeT(record, cur)};
     cur += sizeof(size_t);
 
     BOOST_REQUIRE_EQUAL(value_size, kv.second.size());
 
-    BOOST_TEST_REQUIRE(write_dest.size() - cur >= value_size);
-    std::string value{ReadString(write_dest, cur, value_size)};
+    BOOST_TEST_REQUIRE(record.size() - cur >= value_size);
+    std::string value{ReadString(record, cur, value_size)};
     cur += value.size();
 
     BOOST_REQUIRE_EQUAL(value, kv.second);
+    BOOST_REQUIRE_EQUAL(cur, record.size());
   }
-
-  BOOST_REQUIRE_EQUAL(cur, write_dest.size());
 }
 
 /**
@@ -109,6 +172,66 @@ BOOST_AUTO_TEST_CASE(TestLogfileFormatManySmallRecords) {
   CompareKvToOutput(buf, pairs);
 }
 
+/**
+ * Records that don't fit in the buffer are written together with what is
+ * buffered, keeping the records in order.
+ */
+BOOST_AUTO_TEST_CASE(TestLogfileFormatLargeRecords) {
+  std::vector<char> buf;
+
+  auto io{std::make_unique<WriteOnlyIOMock>(buf)};
+  auto log{LogWriter(std::move(io), false)};
+
+  std::vector<std::pair<std::string, std::string>> pairs{
+      {"small", "value"},
+      {"large", std::string(1000, 'a')},
+      {std::string(600, 'k'), "v"},
+      {"another", "small"},
+      {"medium", std::string(400, 'b')},
+      {"last", "one"}};
+
+  for (const auto &kv : pairs) {
+    log.Add(kv.first, kv.second);
+  }
+
+  log.FlushBuffer();
+  CompareKvToOutput(buf, pairs);
+}
+
+/**
+ * Records that don't fit in the rest of a block are split into fragments,
+ * and blocks with no room for another header are padded.
+ */
+BOOST_AUTO_TEST_CASE(TestLogfileFormatSpansBlocks) {
+  std::vector<char> buf;
+
+  auto io{std::make_unique<WriteOnlyIOMock>(buf)};
+  auto log{LogWriter(std::move(io), false)};
+
+  // The first record leaves three bytes in the first block.
+  std::vector<std::pair<std::string, std::string>> pairs{
+      {"padding", std::string(kLogBlockSize - 3 - kLogHeaderSize -
+                                  3 * sizeof(size_t) - 7,
+                              'p')},
+      {"first", std::string(20000, 'a')},
+      {"second", std::string(20000, 'b')},
+      {"huge", std::string(3 * kLogBlockSize, 'c')},
+      {"small", "value"}};
+
+  for (const auto &kv : pairs) {
+    log.Add(kv.first, kv.second);
+  }
+
+  log.FlushBuffer();
+  CompareKvToOutput(buf, pairs);
+
+  std::vector<char> expected_padding(3, 0);
+  std::vector<char> padding(buf.begin() + kLogBlockSize - 3,
+                            buf.begin() + kLogBlockSize);
+  BOOST_TEST_REQUIRE(padding == expected_padding,
+                     boost::test_tools::per_element());
+}
+
 /**
  * Test that automatic syncing happens for all records when
  * the user passes sync == true
@@ -137,4 +260,72 @@ BOOST_AUTO_TEST_CASE(TestLogfileAutoSync) {
   }
 }
 
+/**
+ * FlushForSync() writes out the buffer right away, and syncs only when the
+ * function it returns is called, even after the writer is gone.
+ */
+BOOST_AUTO_TEST_CASE(TestLogfileFlushForSync) {
+  std::vector<char> buf;
+
+  int num_syncs{0};
+  auto io{std::make_unique<WriteOnlyIOMock>(buf)};
+  io->SetOnSync([&num_syncs] { num_syncs += 1; });
+
+  std::vector<std::pair<std::string, std::string>> pairs{
+      {"abc", "def"}, {"ghi", "jkl"}};
+
+  std::function<void()> sync;
+  {
+    auto log{LogWriter(std::move(io), false)};
+    for (const auto &kv : pairs) {
+      log.Add(kv.first, kv.second);
+    }
+    BOOST_REQUIRE(buf.empty());
+
+    sync = log.FlushForSync();
+    CompareKvToOutput(buf, pairs);
+    BOOST_REQUIRE_EQUAL(num_syncs, 0);
+  }
+
+  sync();
+  BOOST_REQUIRE_EQUAL(num_syncs, 1);
+}
+
+/**
+ * sync_file_range() is not durable, so only non-durable syncs use it. Synced
+ * writes and durable syncs fall back to a full sync.
+ */
+BOOST_AUTO_TEST_CASE(TestLogfileSyncFileRangeFallback) {
+  // Counts the syncs that go through RangeSync().
+  class RangeSyncIOMock : public WriteOnlyIOMock {
+   public:
+    RangeSyncIOMock(std::vector<char> &record, int &num_range_syncs)
+        : WriteOnlyIOMock{record}, num_range_syncs_{num_range_syncs} {}
+
+    void RangeSync(size_t, size_t) override { num_range_syncs_ += 1; }
+
+   private:
+    int &num_range_syncs_;
+  };
+
+  for (bool sync : {false, true}) {
+    std::vector<char> buf;
+    int num_syncs{0};
+    int num_range_syncs{0};
+    auto io{std::make_unique<RangeSyncIOMock>(buf, num_range_syncs)};
+    io->SetOnSync([&num_syncs] { num_syncs += 1; });
+
+    LogWriter log{std::move(io), sync, 0, WALSyncMethod::kSyncFileRange};
+    log.Add("abc", "def");
+    BOOST_REQUIRE_EQUAL(num_syncs, sync ? 1 : 0);
+
+    log.FlushForSync(/*durable=*/false)();
+    BOOST_REQUIRE_EQUAL(num_range_syncs, 1);
+
+    log.FlushForSync()();
+    BOOST_REQUIRE_EQUAL(num_syncs, sync ? 2 : 1);
+    BOOST_REQUIRE_EQUAL(num_range_syncs, 1);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
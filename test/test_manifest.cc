@@ -0,0 +1,174 @@
+#include "helpers.h"
+#include "manifest.h"
+#include "unit_test_include.h"
+#include "util.h"
+
+using namespace mdb;
+
+BOOST_AUTO_TEST_SUITE(TestManifest)
+
+/**
+ * Test that replaying the manifest produces the latest level of every live
+ * table.
+ */
+BOOST_AUTO_TEST_CASE(TestManifestReplay) {
+  std::vector<char> output;
+
+  ManifestWriter writer{std::make_unique<WriteOnlyIOMock>(output), false};
+  writer.Add({.added_tables = {{0, 0, 0}}, .next_table = 1});
+  writer.Add({.added_tables = {{1, 0, 1}}, .next_table = 2});
+  writer.Add({.added_tables = {{2, 1, 1}},
+              .removed_tables = {0, 1},
+              .next_table = 3});
+  // Moved without being rewritten
+  writer.Add(
+      {.added_tables = {{2, 2, 1}}, .next_table = 3, .last_sequence = 42});
+
+  ManifestReader reader{std::make_unique<ReadOnlyIOMock>(std::move(output))};
+  auto state{reader.ReadState()};
+
+  size_t expected_next_table{3};
+  BOOST_REQUIRE_EQUAL(state.next_table, expected_next_table);
+
+  SequenceNumber expected_last_sequence{42};
+  BOOST_REQUIRE_EQUAL(state.last_sequence, expected_last_sequence);
+
+  size_t expected_num_tables{1};
+  BOOST_REQUIRE_EQUAL(state.tables.size(), expected_num_tables);
+
+  const auto &table{state.tables.at(2)};
+  size_t expected_level{2};
+  size_t expected_recency{1};
+  BOOST_REQUIRE_EQUAL(table.level, expected_level);
+  BOOST_REQUIRE_EQUAL(table.recency, expected_recency);
+  BOOST_REQUIRE(table.smallest_key.empty());
+
+  std::set<size_t> expected_removed{0, 1};
+  BOOST_TEST_REQUIRE(state.removed_tables == expected_removed,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * A record that was only partially written is ignored, but everything before
+ * it is kept.
+ */
+BOOST_AUTO_TEST_CASE(TestManifestTornRecord) {
+  std::vector<char> output;
+
+  ManifestWriter writer{std::make_unique<WriteOnlyIOMock>(output), false};
+  writer.Add({.added_tables = {{0, 0, 0}}, .next_table = 1});
+  writer.Add({.added_tables = {{1, 0, 1}}, .next_table = 2});
+
+  output.pop_back();
+
+  ManifestReader reader{std::make_unique<ReadOnlyIOMock>(std::move(output))};
+  auto state{reader.ReadState()};
+
+  size_t expected_next_table{1};
+  BOOST_REQUIRE_EQUAL(state.next_table, expected_next_table);
+
+  size_t expected_num_tables{1};
+  BOOST_REQUIRE_EQUAL(state.tables.size(), expected_num_tables);
+  BOOST_REQUIRE(state.tables.count(0) == 1);
+}
+
+/**
+ * Everything recovery needs to know about a table is recorded, so that the
+ * table doesn't have to be opened.
+ */
+BOOST_AUTO_TEST_CASE(TestManifestTableMetadata) {
+  std::vector<char> output;
+
+  auto creation_time{std::chrono::system_clock::time_point{
+      std::chrono::seconds{1234567}}};
+  TableMetadata table{.number = 7,
+                      .level = 1,
+                      .recency = 5,
+                      .smallest_key = "apple",
+                      .largest_key = "pear",
+                      .size = 4096,
+                      .range_tombstones = {{"b", "c", 3}, {"d", "f", 4}},
+                      .creation_time = creation_time};
+
+  ManifestWriter writer{std::make_unique<WriteOnlyIOMock>(output), false};
+  writer.Add({.added_tables = {table},
+              .next_table = 8,
+              .log_number = 3,
+              .pending_tables = {8, 9}});
+
+  ManifestReader reader{std::make_unique<ReadOnlyIOMock>(std::move(output))};
+  auto state{reader.ReadState()};
+
+  size_t expected_log_number{3};
+  BOOST_REQUIRE_EQUAL(state.log_number, expected_log_number);
+
+  std::vector<size_t> expected_pending{8, 9};
+  BOOST_TEST_REQUIRE(state.pending_tables == expected_pending,
+                     boost::test_tools::per_element());
+
+  const auto &read_table{state.tables.at(7)};
+  BOOST_REQUIRE_EQUAL(read_table.smallest_key, "apple");
+  BOOST_REQUIRE_EQUAL(read_table.largest_key, "pear");
+  BOOST_REQUIRE_EQUAL(read_table.size, table.size);
+  BOOST_REQUIRE(read_table.creation_time == creation_time);
+
+  const auto &tombstones{read_table.range_tombstones};
+  size_t expected_num_tombstones{2};
+  BOOST_REQUIRE_EQUAL(tombstones.size(), expected_num_tombstones);
+  BOOST_REQUIRE_EQUAL(tombstones[1].begin, "d");
+  BOOST_REQUIRE_EQUAL(tombstones[1].end, "f");
+  BOOST_REQUIRE_EQUAL(tombstones[1].seq, 4);
+}
+
+/**
+ * Once the manifest grows too big, it is replaced by a checkpoint that only
+ * holds the live tables, and later edits are appended to the checkpoint.
+ */
+BOOST_AUTO_TEST_CASE(TestManifestCheckpoint) {
+  auto env{std::make_shared<EnvMock>()};
+  Options opt{.env = env};
+  opt.max_manifest_file_size = 512;
+
+  auto manifest_size{[&env, &opt]() {
+    return env->files.at(util::ManifestFileName(opt)).size();
+  }};
+
+  // A checkpoint's directory is synced once it is renamed into place.
+  size_t num_synced_dirs{0};
+  env->on_event = [&env, &opt, &num_synced_dirs](const std::string &event) {
+    if (event.rfind("syncdir ", 0) == 0) {
+      BOOST_REQUIRE_EQUAL(event.substr(8), opt.path.string());
+      BOOST_REQUIRE(!env->FileExists(util::ManifestFileName(opt) + ".tmp"));
+      num_synced_dirs++;
+    }
+  };
+
+  ManifestWriter writer{opt};
+
+  // Every table replaces the one before it.
+  for (size_t i = 1; i < 100; i++) {
+    writer.Add({.added_tables = {{.number = i, .level = 0, .recency = i}},
+                .removed_tables = {i - 1},
+                .next_table = i + 1});
+    BOOST_REQUIRE_LT(manifest_size(), 2 * opt.max_manifest_file_size);
+  }
+  BOOST_REQUIRE_GT(num_synced_dirs, 0);
+
+  BOOST_REQUIRE(!env->FileExists(util::ManifestFileName(opt) + ".tmp"));
+
+  auto state{ManifestReader{opt}.ReadState()};
+
+  size_t expected_next_table{100};
+  BOOST_REQUIRE_EQUAL(state.next_table, expected_next_table);
+
+  size_t expected_num_tables{1};
+  BOOST_REQUIRE_EQUAL(state.tables.size(), expected_num_tables);
+  BOOST_REQUIRE(state.tables.count(99) == 1);
+
+  // The last table that was removed may still have to be deleted, but the
+  // ones before it are forgotten.
+  BOOST_REQUIRE(state.removed_tables.count(98) == 1);
+  BOOST_REQUIRE(state.removed_tables.count(0) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
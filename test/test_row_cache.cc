@@ -0,0 +1,60 @@
+#include "row_cache.h"
+#include "unit_test_include.h"
+
+using namespace mdb;
+
+BOOST_AUTO_TEST_SUITE(TestRowCache)
+
+/**
+ * Entries are evicted from the least recently used one once the keys and
+ * values pass the capacity.
+ */
+BOOST_AUTO_TEST_CASE(TestRowCacheEvictsLeastRecentlyUsed) {
+  RowCache cache{20};
+
+  cache.Insert("a", "123456789", cache.GetTicket("a"));
+  cache.Insert("b", "123456789", cache.GetTicket("b"));
+  BOOST_REQUIRE_EQUAL(cache.Charge(), 20);
+
+  BOOST_REQUIRE_EQUAL(cache.Get("a").value(), "123456789");
+  cache.Insert("c", "", cache.GetTicket("c"));
+
+  BOOST_REQUIRE(!cache.Get("b"));
+  BOOST_REQUIRE_EQUAL(cache.Get("a").value(), "123456789");
+  BOOST_REQUIRE_EQUAL(cache.Get("c").value(), "");
+  BOOST_REQUIRE_EQUAL(cache.Charge(), 11);
+
+  // Too big to be cached at all.
+  cache.Insert("d", std::string(20, 'd'), cache.GetTicket("d"));
+  BOOST_REQUIRE(!cache.Get("d"));
+  BOOST_REQUIRE(cache.Get("a"));
+}
+
+/**
+ * A value read before the key was erased, or before the cache was cleared,
+ * is not inserted.
+ */
+BOOST_AUTO_TEST_CASE(TestRowCacheTickets) {
+  RowCache cache{1024};
+
+  auto ticket{cache.GetTicket("key")};
+  cache.Erase("key");
+  cache.Insert("key", "stale", ticket);
+  BOOST_REQUIRE(!cache.Get("key"));
+
+  ticket = cache.GetTicket("key");
+  auto other_ticket{cache.GetTicket("other")};
+  cache.Clear();
+  cache.Insert("key", "stale", ticket);
+  cache.Insert("other", "stale", other_ticket);
+  BOOST_REQUIRE(!cache.Get("key"));
+  BOOST_REQUIRE(!cache.Get("other"));
+
+  cache.Insert("key", "fresh", cache.GetTicket("key"));
+  BOOST_REQUIRE_EQUAL(cache.Get("key").value(), "fresh");
+  cache.Erase("key");
+  BOOST_REQUIRE(!cache.Get("key"));
+  BOOST_REQUIRE_EQUAL(cache.Charge(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
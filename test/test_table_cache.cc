@@ -0,0 +1,80 @@
+#include "helpers.h"
+#include "table_cache.h"
+#include "table_writer.h"
+#include "unit_test_include.h"
+#include "util.h"
+
+using namespace mdb;
+
+BOOST_AUTO_TEST_SUITE(TestTableCache)
+
+namespace {
+
+void WriteTable(size_t table_number, const MemTableT &memtable,
+                const Options &options) {
+  auto writer{
+      options.table_factory->MakeTableWriter(table_number, options, 0)};
+  writer->WriteMemtable(memtable);
+}
+
+}  // namespace
+
+/**
+ * The least recently used reader is closed when the cache is full, and is
+ * reopened on the next access.
+ */
+BOOST_AUTO_TEST_CASE(TestTableCacheEvictsLeastRecentlyUsed) {
+  Options opt{MakeMockOptions()};
+  opt.max_open_tables = 2;
+
+  for (size_t i = 0; i < 3; i++) {
+    WriteTable(i, {{"key", std::to_string(i)}}, opt);
+  }
+
+  TableCache cache;
+  auto reader0{cache.Get(0, opt)};
+  auto reader1{cache.Get(1, opt)};
+
+  // Cached readers are handed out again.
+  BOOST_REQUIRE(cache.Get(0, opt) == reader0);
+
+  // Table 1 is the least recently used.
+  auto reader2{cache.Get(2, opt)};
+  size_t expected_size{2};
+  BOOST_REQUIRE_EQUAL(cache.Size(), expected_size);
+  BOOST_REQUIRE(cache.Get(0, opt) == reader0);
+
+  // Still usable after being evicted.
+  BOOST_REQUIRE(reader1->ValueOf("key") == "1");
+
+  auto reopened1{cache.Get(1, opt)};
+  BOOST_REQUIRE(reopened1 != reader1);
+  BOOST_REQUIRE(reopened1->ValueOf("key") == "1");
+  BOOST_REQUIRE_EQUAL(cache.Size(), expected_size);
+
+  cache.Erase(1);
+  cache.Erase(1);
+  size_t expected_size_after_erase{1};
+  BOOST_REQUIRE_EQUAL(cache.Size(), expected_size_after_erase);
+}
+
+/**
+ * Inserting a reader replaces the cached one.
+ */
+BOOST_AUTO_TEST_CASE(TestTableCacheInsert) {
+  Options opt{MakeMockOptions()};
+  WriteTable(0, {{"key", "value"}}, opt);
+
+  TableCache cache;
+  auto opened{cache.Get(0, opt)};
+
+  std::shared_ptr<TableReader> inserted{
+      opt.table_factory->MakeTableReader(0, opt)};
+  cache.Insert(0, inserted, opt);
+
+  BOOST_REQUIRE(cache.Get(0, opt) == inserted);
+  size_t expected_size{1};
+  BOOST_REQUIRE_EQUAL(cache.Size(), expected_size);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -38,4 +38,138 @@ BOOST_AUTO_TEST_CASE(TestUncompressedTableIntegration) {
   BOOST_REQUIRE_EQUAL(reader.GetLevel(), level);
 }
 
+/**
+ * Range tombstones are read back by both reader constructors. They delete
+ * keys in other tables, but not the keys stored alongside them.
+ */
+BOOST_AUTO_TEST_CASE(TestUncompressedTableRangeTombstones) {
+  std::vector<char> output;
+  auto io{std::make_unique<WriteOnlyIOMock>(output)};
+
+  MemTableT memtable{{"a", "1"}, {"c", "3"}, {"e", "5"}, {"g", "7"}};
+
+  UncompressedTableWriter writer{std::move(io), false, 16 + 2 * sizeof(size_t),
+                                 0};
+
+  writer.AddRangeTombstone("x", "z");
+  writer.AddRangeTombstone("b", "f");
+  writer.WriteMemtable(memtable);
+
+  BOOST_REQUIRE_THROW(writer.AddRangeTombstone("h", "i"), std::logic_error);
+
+  size_t expected_num_keys{4};
+  BOOST_REQUIRE_EQUAL(writer.NumKeys(), expected_num_keys);
+
+  std::vector<std::unique_ptr<TableReader>> readers;
+  readers.push_back(std::make_unique<UncompressedTableReader>(
+      std::make_unique<ReadOnlyIOMock>(output), writer.GetIndex()));
+  readers.push_back(std::make_unique<UncompressedTableReader>(
+      std::make_unique<ReadOnlyIOMock>(output)));
+
+  for (const auto &reader : readers) {
+    size_t expected_num_tombstones{2};
+    BOOST_REQUIRE_EQUAL(reader->RangeTombstones().size(),
+                        expected_num_tombstones);
+
+    BOOST_REQUIRE(reader->ValueOf("a") == "1");
+    BOOST_REQUIRE(reader->ValueOf("c") == "3");
+    BOOST_REQUIRE(reader->ValueOf("d") == "");
+    BOOST_REQUIRE(reader->ValueOf("f") == std::nullopt);
+    BOOST_REQUIRE(reader->ValueOf("y") == "");
+
+    BOOST_REQUIRE_EQUAL(reader->SmallestKey(), "a");
+    BOOST_REQUIRE_EQUAL(reader->LargestKey(), "z");
+
+    // Iteration only visits the point entries.
+    MemTableT contents{reader->Begin(), reader->End()};
+    BOOST_TEST_REQUIRE(contents == memtable, boost::test_tools::per_element());
+  }
+}
+
+/**
+ * Several versions of a key stay in the same block, and reads only see the
+ * versions and range tombstones at or below their snapshot.
+ */
+BOOST_AUTO_TEST_CASE(TestUncompressedTableVersions) {
+  std::vector<char> output;
+  auto io{std::make_unique<WriteOnlyIOMock>(output)};
+
+  // Every block is full after a single entry.
+  UncompressedTableWriter writer{std::move(io), false, 1, 0};
+
+  writer.Add("a", "a5", 5);
+  writer.Add("a", "a3", 3);
+  writer.Add("a", "a1", 1);
+  writer.Add("b", "b2", 2);
+  writer.AddRangeTombstone("b", "c", 4);
+  BOOST_REQUIRE_THROW(writer.Add("b", "b2", 2), std::invalid_argument);
+  writer.Flush();
+
+  // One block per key, plus the range tombstones.
+  size_t expected_num_blocks{3};
+  BOOST_REQUIRE_EQUAL(writer.GetIndex().size(), expected_num_blocks);
+
+  auto io_read{std::make_unique<ReadOnlyIOMock>(std::move(output))};
+  UncompressedTableReader reader{std::move(io_read)};
+
+  BOOST_REQUIRE(reader.ValueOf("a") == "a5");
+  BOOST_REQUIRE(reader.ValueOf("a", 4) == "a3");
+  BOOST_REQUIRE(reader.ValueOf("a", 1) == "a1");
+  BOOST_REQUIRE(reader.ValueOf("a", 0) == std::nullopt);
+
+  BOOST_REQUIRE(reader.ValueOf("b") == "");
+  BOOST_REQUIRE(reader.ValueOf("b", 3) == "b2");
+  BOOST_REQUIRE(reader.ValueOf("b", 1) == std::nullopt);
+
+  std::vector<SequenceNumber> sequences;
+  for (auto it = reader.Begin(); it != reader.End(); ++it) {
+    sequences.push_back(it.Sequence());
+  }
+
+  std::vector<SequenceNumber> expected_sequences{5, 3, 1, 2};
+  BOOST_TEST_REQUIRE(sequences == expected_sequences,
+                     boost::test_tools::per_element());
+}
+
+/**
+ * A memory-mapped table is parsed in place and reads the same as one that
+ * is read with pread.
+ */
+BOOST_AUTO_TEST_CASE(TestUncompressedTableMapped) {
+  std::vector<char> output;
+  auto io{std::make_unique<WriteOnlyIOMock>(output)};
+
+  MemTableT memtable{{"a", "1"}, {"c", "3"}, {"e", ""}, {"g", "7"}};
+
+  UncompressedTableWriter writer{std::move(io), false, 16 + 2 * sizeof(size_t),
+                                 0};
+  writer.AddRangeTombstone("b", "c", 1);
+  writer.WriteMemtable(memtable);
+
+  auto io_read{std::make_unique<ReadOnlyIOMock>(std::move(output))};
+  io_read->SetMapped();
+  UncompressedTableReader reader{std::move(io_read)};
+
+  BOOST_REQUIRE(reader.ValueOf("a") == "1");
+  BOOST_REQUIRE(reader.ValueOf("b") == "");
+  BOOST_REQUIRE(reader.ValueOf("c") == "3");
+  BOOST_REQUIRE(reader.ValueOf("e") == "");
+  BOOST_REQUIRE(reader.ValueOf("f") == std::nullopt);
+  BOOST_REQUIRE(reader.ValueOf("g") == "7");
+
+  BOOST_REQUIRE_EQUAL(reader.SmallestKey(), "a");
+  BOOST_REQUIRE_EQUAL(reader.LargestKey(), "g");
+
+  MemTableT contents{reader.Begin(), reader.End()};
+  BOOST_TEST_REQUIRE(contents == memtable, boost::test_tools::per_element());
+
+  auto it{reader.NewIterator()};
+  it.Seek("c");
+  auto copy{it.Clone()};
+  it.Next();
+  BOOST_REQUIRE_EQUAL(copy.Key(), "c");
+  BOOST_REQUIRE_EQUAL(copy.Value(), "3");
+  BOOST_REQUIRE_EQUAL(it.Key(), "e");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -19,6 +19,9 @@ BlockT ConstructBlock(const std::map<std::string, std::string> &pairs) {
     WriteSizeT(block.data, kv.first.size());
     WriteString(block.data, kv.first);
 
+    // Sequence number
+    WriteSizeT(block.data, 0);
+
     WriteSizeT(block.data, kv.second.size());
     WriteString(block.data, kv.second);
   }
@@ -281,13 +284,41 @@ BOOST_AUTO_TEST_CASE(TestTableCorruptionHugeValueSize) {
   std::vector<char> buf{ConstructTable(blocks, 0)};
 
   auto index{ConstructIndex(buf)};
-  *reinterpret_cast<size_t *>(buf.data() + 3 * sizeof(size_t) + sizeof("abc")) =
+  *reinterpret_cast<size_t *>(buf.data() + 4 * sizeof(size_t) + sizeof("abc")) =
+      100000000000000;
+  auto io{std::make_unique<ReadOnlyIOMock>(std::move(buf))};
+
+  auto reader{UncompressedTableReader(std::move(io), std::move(index))};
+
+  BOOST_REQUIRE_THROW(reader.ValueOf("abc"), std::system_error);
+}
+
+/**
+ * Entries are bounds-checked when a memory-mapped block is parsed in place.
+ */
+BOOST_AUTO_TEST_CASE(TestTableCorruptionMapped) {
+  std::vector<std::map<std::string, std::string>> key_values{
+      {{"abc", "def"}, {"a", "helloworld"}}};
+
+  std::vector<BlockT> blocks;
+  for (const auto &kv_map : key_values) {
+    blocks.push_back(ConstructBlock(kv_map));
+  }
+
+  std::vector<char> buf{ConstructTable(blocks, 0)};
+
+  auto index{ConstructIndex(buf)};
+  *reinterpret_cast<size_t *>(buf.data() + 4 * sizeof(size_t) + sizeof("abc")) =
       100000000000000;
   auto io{std::make_unique<ReadOnlyIOMock>(std::move(buf))};
+  io->SetMapped();
 
   auto reader{UncompressedTableReader(std::move(io), std::move(index))};
 
   BOOST_REQUIRE_THROW(reader.ValueOf("abc"), std::system_error);
+
+  auto it{reader.NewIterator()};
+  BOOST_REQUIRE_THROW(it.SeekToFirst(), std::system_error);
 }
 
 /**
@@ -377,6 +408,30 @@ BOOST_AUTO_TEST_CASE(TestGetLevel) {
   BOOST_REQUIRE_EQUAL(reader.GetLevel(), level);
 }
 
+/**
+ * Test that the smallest and largest keys span all blocks of the table.
+ */
+BOOST_AUTO_TEST_CASE(TestKeyRange) {
+  std::vector<std::map<std::string, std::string>> key_values{
+      {{"abc", "def"}, {"a", "helloworld"}},
+      {{"b12", "123451251512"}, {"bbb", "bbbbbbbbbbbbbbbbbbb"}}};
+
+  std::vector<BlockT> blocks;
+  for (const auto &kv_map : key_values) {
+    blocks.push_back(ConstructBlock(kv_map));
+  }
+
+  std::vector<char> buf{ConstructTable(blocks, 0)};
+
+  auto index{ConstructIndex(buf)};
+  auto io{std::make_unique<ReadOnlyIOMock>(std::move(buf))};
+
+  auto reader{UncompressedTableReader(std::move(io), std::move(index))};
+
+  BOOST_REQUIRE_EQUAL(reader.SmallestKey(), "a");
+  BOOST_REQUIRE_EQUAL(reader.LargestKey(), "bbb");
+}
+
 /**
  * Test that the LogReader can recover the correct index/level given only
  * an on-disk file
@@ -411,4 +466,201 @@ BOOST_AUTO_TEST_CASE(TestConstructFromFileOnly) {
   }
 }
 
+/**
+ * Seek jumps to the first key that is >= the target, which may be in a later
+ * block than the one the index points to.
+ */
+BOOST_AUTO_TEST_CASE(TestTableIterSeek) {
+  std::vector<std::map<std::string, std::string>> key_values{
+      {{"abc", "def"}, {"a", "helloworld"}},
+      {{"b12", "123451251512"}, {"bbb", "bbbbbbbbbbbbbbbbbbb"}},
+      {{"xyz", "hello"}}};
+
+  std::vector<BlockT> blocks;
+  for (const auto &kv_map : key_values) {
+    blocks.push_back(ConstructBlock(kv_map));
+  }
+
+  std::vector<char> buf{ConstructTable(blocks, 0)};
+
+  auto index{ConstructIndex(buf)};
+  auto io{std::make_unique<ReadOnlyIOMock>(std::move(buf))};
+
+  auto reader{UncompressedTableReader(std::move(io), std::move(index))};
+
+  std::vector<std::pair<std::string, std::string>> targets{
+      {"0", "a"}, {"a", "a"}, {"ab", "abc"}, {"b2", "bbb"}, {"c", "xyz"},
+      {"xyz", "xyz"}};
+
+  for (const auto &[target, expected_key] : targets) {
+    auto it{reader.Seek(target)};
+    BOOST_REQUIRE(it != reader.End());
+    BOOST_REQUIRE_EQUAL(it->first, expected_key);
+  }
+
+  BOOST_REQUIRE(reader.Seek("z") == reader.End());
+
+  auto it{reader.Begin()};
+  it.Seek("b12");
+  BOOST_REQUIRE_EQUAL(it->second, "123451251512");
+  ++it;
+  BOOST_REQUIRE_EQUAL(it->first, "bbb");
+
+  auto last{reader.SeekToLast()};
+  BOOST_REQUIRE_EQUAL(last->first, "xyz");
+  ++last;
+  BOOST_REQUIRE(last == reader.End());
+}
+
+/**
+ * Seeking in a table without keys gives the end iterator.
+ */
+BOOST_AUTO_TEST_CASE(TestTableIterSeekEmpty) {
+  std::vector<char> buf{ConstructTable({}, 0)};
+  auto index{ConstructIndex(buf)};
+  auto io{std::make_unique<ReadOnlyIOMock>(std::move(buf))};
+
+  auto reader{UncompressedTableReader(std::move(io), std::move(index))};
+  BOOST_REQUIRE(reader.Seek("a") == reader.End());
+  BOOST_REQUIRE(reader.SeekToLast() == reader.End());
+}
+
+/**
+ * The block iterator hands out views into its current block. Views stay
+ * valid when the iterator is moved, and clones are independent.
+ */
+BOOST_AUTO_TEST_CASE(TestBlockIterator) {
+  std::vector<std::map<std::string, std::string>> key_values{
+      {{"abc", "def"}, {"a", "helloworld"}},
+      {{"b12", "123451251512"}, {"bbb", "bbbbbbbbbbbbbbbbbbb"}},
+      {{"xyz", "hello"}}};
+
+  std::vector<BlockT> blocks;
+  for (const auto &kv_map : key_values) {
+    blocks.push_back(ConstructBlock(kv_map));
+  }
+
+  std::vector<char> buf{ConstructTable(blocks, 0)};
+  auto io{std::make_unique<ReadOnlyIOMock>(std::move(buf))};
+
+  UncompressedTableReader reader{std::move(io)};
+
+  auto it{reader.NewIterator()};
+  BOOST_REQUIRE(!it.Valid());
+
+  it.SeekToFirst();
+  for (const auto &kv_map : key_values) {
+    for (const auto &kv : kv_map) {
+      BOOST_REQUIRE(it.Valid());
+      BOOST_REQUIRE_EQUAL(it.Key(), kv.first);
+      BOOST_REQUIRE_EQUAL(it.Value(), kv.second);
+      it.Next();
+    }
+  }
+  BOOST_REQUIRE(!it.Valid());
+
+  it.Seek("b");
+  auto key{it.Key()};
+  auto moved{std::move(it)};
+  BOOST_REQUIRE_EQUAL(key, "b12");
+  BOOST_REQUIRE_EQUAL(moved.Key(), "b12");
+
+  auto clone{moved.Clone()};
+  moved.Next();
+  BOOST_REQUIRE_EQUAL(moved.Key(), "bbb");
+  BOOST_REQUIRE_EQUAL(clone.Key(), "b12");
+
+  clone.SeekToLast();
+  BOOST_REQUIRE_EQUAL(clone.Key(), "xyz");
+  BOOST_REQUIRE_EQUAL(clone.Value(), "hello");
+}
+
+/**
+ * MultiValueOf() finds the same values as ValueOf(), whether the keys share
+ * a block, are in blocks of their own or are missing, and whether or not
+ * the table is mapped.
+ */
+BOOST_AUTO_TEST_CASE(TestMultiValueOf) {
+  std::vector<std::map<std::string, std::string>> key_values{
+      {{"abc", "def"}, {"a", "helloworld"}},
+      {{"b12", "123451251512"}, {"bbb", "bbbbbbbbbbbbbbbbbbb"}},
+      {{"xyz", "hello"}}};
+
+  std::vector<BlockT> blocks;
+  for (const auto &kv_map : key_values) {
+    blocks.push_back(ConstructBlock(kv_map));
+  }
+  std::vector<char> buf{ConstructTable(blocks, 0)};
+
+  std::vector<std::string_view> keys{"0",   "a",   "abc", "abd", "b12",
+                                     "bbb", "xyz", "zzz"};
+
+  for (bool mapped : {false, true}) {
+    auto io{std::make_unique<ReadOnlyIOMock>(buf)};
+    if (mapped) {
+      io->SetMapped();
+    }
+    UncompressedTableReader reader{std::move(io)};
+
+    std::vector<std::optional<std::string>> values(keys.size());
+    reader.MultiValueOf(keys, kMaxSequenceNumber, values);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      BOOST_REQUIRE(values[i] == reader.ValueOf(keys[i]));
+    }
+    BOOST_REQUIRE(values[2] == "def");
+    BOOST_REQUIRE(!values[3]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestValueView) {
+  std::vector<BlockT> blocks{
+      ConstructBlock({{"abc", "def"}, {"a", "helloworld"}}),
+      ConstructBlock({{"xyz", "hello"}})};
+  std::vector<char> buf{ConstructTable(blocks, 0)};
+
+  for (bool mapped : {false, true}) {
+    auto io{std::make_unique<ReadOnlyIOMock>(buf)};
+    if (mapped) {
+      io->SetMapped();
+    }
+    UncompressedTableReader reader{std::move(io)};
+
+    for (std::string_view key : {"0", "a", "abc", "abd", "xyz", "zzz"}) {
+      std::vector<char> scratch;
+      auto view{reader.ValueView(key, kMaxSequenceNumber, scratch)};
+      auto value{reader.ValueOf(key)};
+      BOOST_REQUIRE_EQUAL(view.has_value(), value.has_value());
+      if (view) {
+        BOOST_REQUIRE_EQUAL(*view, *value);
+      }
+
+      /** Mapped tables are not read into the scratch buffer. */
+      BOOST_REQUIRE_EQUAL(scratch.empty(), mapped || key == "0");
+    }
+  }
+}
+
+/**
+ * Block sizes come from the index, and the file size is looked up once, so
+ * a lookup reads its block with a single Read() and nothing else.
+ */
+BOOST_AUTO_TEST_CASE(TestValueOfReadsOnce) {
+  std::vector<BlockT> blocks{
+      ConstructBlock({{"abc", "def"}, {"a", "helloworld"}}),
+      ConstructBlock({{"xyz", "hello"}})};
+  std::vector<char> buf{ConstructTable(blocks, 0)};
+
+  auto io{std::make_unique<ReadOnlyIOMock>(buf)};
+  auto *io_ptr{io.get()};
+  UncompressedTableReader reader{std::move(io)};
+
+  for (std::string_view key : {"abc", "xyz"}) {
+    io_ptr->num_reads = 0;
+    io_ptr->num_size_calls = 0;
+    BOOST_REQUIRE(reader.ValueOf(key));
+    BOOST_REQUIRE_EQUAL(io_ptr->num_reads, 1);
+    BOOST_REQUIRE_EQUAL(io_ptr->num_size_calls, 0);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -44,6 +44,10 @@ void ReadUncompressedBlock(const std::vector<char> &buf, size_t pos,
     std::string key{ReadString(buf, pos + i, key_size)};
     i += key_size;
 
+    // Skip the sequence number
+    BOOST_TEST_REQUIRE(buf.size() - (pos + i) >= sizeof(size_t));
+    i += sizeof(size_t);
+
     BOOST_TEST_REQUIRE(buf.size() - (pos + i) >= sizeof(size_t));
     size_t value_size{ReadSizeT(buf, pos + i)};
     i += sizeof(size_t);
@@ -158,9 +162,9 @@ BOOST_AUTO_TEST_CASE(TestIndex) {
   UncompressedTableWriter writer{std::move(io), sync, block_size, 0};
 
   size_t first_block_size =
-      2 + to_write["1"].size() + to_write["2"].size() + 4 * sizeof(size_t);
+      2 + to_write["1"].size() + to_write["2"].size() + 6 * sizeof(size_t);
 
-  size_t second_block_size = 1 + to_write["3"].size() + 2 * sizeof(size_t);
+  size_t second_block_size = 1 + to_write["3"].size() + 3 * sizeof(size_t);
 
   IndexT expected{
       {"1", sizeof(size_t)},
@@ -0,0 +1,48 @@
+#include <atomic>
+#include <stdexcept>
+
+#include "thread_pool.h"
+#include "unit_test_include.h"
+
+using namespace mdb;
+
+BOOST_AUTO_TEST_SUITE(TestThreadPool)
+
+/**
+ * Results of the tasks are passed back through their futures, and so are
+ * the exceptions they throw.
+ */
+BOOST_AUTO_TEST_CASE(TestThreadPoolSubmit) {
+  ThreadPool pool{4};
+
+  std::vector<std::future<size_t>> results;
+  for (size_t i = 0; i < 100; i++) {
+    results.push_back(pool.Submit([i]() { return i * i; }));
+  }
+
+  for (size_t i = 0; i < results.size(); i++) {
+    BOOST_REQUIRE_EQUAL(results[i].get(), i * i);
+  }
+
+  auto failed{pool.Submit([]() { throw std::runtime_error("failed"); })};
+  BOOST_REQUIRE_THROW(failed.get(), std::runtime_error);
+}
+
+/**
+ * Tasks that were submitted before the pool is destroyed still run.
+ */
+BOOST_AUTO_TEST_CASE(TestThreadPoolDestructorRunsTasks) {
+  std::atomic<size_t> num_run{0};
+
+  {
+    ThreadPool pool{2};
+    for (size_t i = 0; i < 100; i++) {
+      pool.Submit([&num_run]() { ++num_run; });
+    }
+  }
+
+  size_t expected_num_run{100};
+  BOOST_REQUIRE_EQUAL(num_run.load(), expected_num_run);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
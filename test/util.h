@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
 #include <vector>
 
@@ -28,14 +30,21 @@ inline void WriteString(std::vector<char> &buf, const std::string &str) {
   buf.insert(buf.end(), str.cbegin(), str.cend());
 }
 
+// Without "append", writes start at the beginning of "output" and overwrite
+// what is there.
 class WriteOnlyIOMock : public mdb::WriteOnlyIO {
  public:
-  WriteOnlyIOMock(std::vector<char> &output, std::string filename = "")
-      : filename_{std::move(filename)}, record_{output} {}
+  WriteOnlyIOMock(std::vector<char> &output, std::string filename = "",
+                  bool append = true)
+      : filename_{std::move(filename)}, record_{output}, append_{append} {}
 
   void Write(const char *data, size_t size) override {
     if (!closed_) {
-      record_.insert(record_.end(), data, data + size);
+      size_t pos{append_ ? record_.size() : pos_};
+      size_t overwritten{std::min(size, record_.size() - pos)};
+      std::copy_n(data, overwritten, record_.begin() + pos);
+      record_.insert(record_.end(), data + overwritten, data + size);
+      pos_ = pos + size;
     }
   }
 
@@ -59,6 +68,8 @@ class WriteOnlyIOMock : public mdb::WriteOnlyIO {
   bool closed_{false};
   std::string filename_;
   std::vector<char> &record_;
+  bool append_;
+  size_t pos_{0};
   std::vector<std::function<void(void)>> on_sync_;
 };
 
@@ -69,6 +80,7 @@ class ReadOnlyIOMock : public mdb::ReadOnlyIO {
 
   size_t Read(char *output, size_t size, size_t offset) override {
     assert(offset <= input_.size());
+    ++num_reads;
     if (!closed_) {
       size_t read_size = std::min(input_.size() - offset, size);
 
@@ -85,10 +97,25 @@ class ReadOnlyIOMock : public mdb::ReadOnlyIO {
 
   void Close() override { closed_ = true; }
 
-  size_t Size() const override { return input_.size(); }
+  size_t Size() const override {
+    ++num_size_calls;
+    return input_.size();
+  }
+
+  // Expose the input through MappedData(), like a memory-mapped file.
+  void SetMapped() { mapped_ = true; }
+
+  const char *MappedData() const noexcept override {
+    return mapped_ && !closed_ && !input_.empty() ? input_.data() : nullptr;
+  }
+
+  // Calls to Read() and Size() so far.
+  size_t num_reads{0};
+  mutable size_t num_size_calls{0};
 
  private:
   bool closed_{false};
+  bool mapped_{false};
   std::vector<char> input_;
   std::string filename_;
 };
@@ -100,7 +127,11 @@ class EnvMock : public mdb::Env {
     auto ret{files.insert_or_assign(filename, BufType{})};
     auto it{ret.first};
 
-    return std::make_unique<WriteOnlyIOMock>(it->second, std::move(filename));
+    auto file{std::make_unique<WriteOnlyIOMock>(it->second, filename)};
+    if (on_event) {
+      file->SetOnSync([this, filename] { on_event("sync " + filename); });
+    }
+    return file;
   }
 
   std::unique_ptr<mdb::ReadOnlyIO> MakeReadOnlyIO(
@@ -111,14 +142,74 @@ class EnvMock : public mdb::Env {
                                             std::move(filename));
   }
 
+  std::unique_ptr<mdb::WriteOnlyIO> ReuseWriteOnlyIO(
+      const std::string &old_filename, std::string filename) override {
+    RenameFile(old_filename, filename);
+    return std::make_unique<WriteOnlyIOMock>(files[filename], filename,
+                                             /*append=*/false);
+  }
+
   void RemoveFile(const std::string &filename) override {
+    if (on_event) {
+      on_event("remove " + filename);
+    }
     assert(files.erase(filename));
   }
 
+  // Open files keep writing to the renamed buffer.
+  void RenameFile(const std::string &from, const std::string &to) override {
+    auto node{files.extract(from)};
+    assert(!node.empty());
+    node.key() = to;
+    files.erase(to);
+    files.insert(std::move(node));
+  }
+
+  void SyncDir(const std::string &dirname) override {
+    if (on_event) {
+      on_event("syncdir " + dirname);
+    }
+  }
+
+  bool FileExists(const std::string &filename) const override {
+    return files.find(filename) != files.end();
+  }
+
+  void MultiRead(std::vector<mdb::ReadRequest> &requests) const override {
+    ++num_multi_reads;
+    num_read_requests += requests.size();
+    Env::MultiRead(requests);
+  }
+
+  std::chrono::system_clock::time_point ModificationTime(
+      const std::string &) const override {
+    return std::chrono::system_clock::now();
+  }
+
   using BufType = std::vector<char>;
   mutable std::unordered_map<std::string, BufType> files;
+
+  // Called with "sync <filename>" when a file made by MakeWriteOnlyIO() is
+  // synced, with "remove <filename>" when a file is removed and with
+  // "syncdir <dirname>" when a directory is synced. Files keep the name they
+  // were made with.
+  std::function<void(const std::string &)> on_event;
+
+  mutable size_t num_multi_reads{0};
+  mutable size_t num_read_requests{0};
 };
 
+// Number of table files in the mock environment, ignoring logs and the
+// manifest.
+inline size_t NumTableFiles(const EnvMock &env) {
+  return std::count_if(env.files.cbegin(), env.files.cend(),
+                       [](const auto &file) {
+                         return file.first.size() >= 4 &&
+                                file.first.substr(file.first.size() - 4) ==
+                                    ".mdb";
+                       });
+}
+
 inline mdb::Options MakeMockOptions() {
   return mdb::Options{.env = std::make_shared<EnvMock>()};
 }